@@ -6,16 +6,26 @@ package main
 import "C"
 import (
 	"encoding/json"
+	"errors"
+	"math"
+	"runtime"
 	"runtime/debug"
+	"sync"
 	"unsafe"
 )
 
-// ReleaseUnusedMemory forces the embedded Go runtime to return unused heap
-// pages after an unusually large subscription parse.
+// SetMemoryLimit configures the Go runtime soft memory limit in bytes. A
+// non-positive value removes the limit. The collector and scavenger keep the
+// embedded heap near the limit on their own, so the request path never has to
+// force a full collection. The previous limit is returned.
 //
-//export ReleaseUnusedMemory
-func ReleaseUnusedMemory() {
-	debug.FreeOSMemory()
+//export SetMemoryLimit
+func SetMemoryLimit(limit C.longlong) C.longlong {
+	value := int64(limit)
+	if value <= 0 {
+		value = math.MaxInt64
+	}
+	return C.longlong(debug.SetMemoryLimit(value))
 }
 
 // ResolveAgeRecipient validates one Age public or secret key and returns a
@@ -85,6 +95,107 @@ func ConvertSubscription(data *C.char) *C.char {
 	return C.CString(string(result))
 }
 
+// subscriptionBatchItem is one per-body result of ConvertSubscriptions. A
+// failed body reports Error and never aborts the rest of the batch.
+type subscriptionBatchItem struct {
+	Proxies []map[string]any `json:"proxies"`
+	Error   string           `json:"error,omitempty"`
+}
+
+// convertSubscriptionBatch parses every body on a bounded set of goroutines
+// and returns the results in input order.
+func convertSubscriptionBatch(subscriptions []string) []subscriptionBatchItem {
+	results := make([]subscriptionBatchItem, len(subscriptions))
+	workers := runtime.GOMAXPROCS(0)
+	if workers > len(subscriptions) {
+		workers = len(subscriptions)
+	}
+
+	var next sync.Mutex
+	index := 0
+	var wg sync.WaitGroup
+	for worker := 0; worker < workers; worker++ {
+		wg.Add(1)
+		go func() {
+			defer wg.Done()
+			for {
+				next.Lock()
+				current := index
+				index++
+				next.Unlock()
+				if current >= len(subscriptions) {
+					return
+				}
+				proxies, err := parseSubscriptionWithMihomo(subscriptions[current])
+				if err != nil {
+					results[current].Error = err.Error()
+					continue
+				}
+				if proxies == nil {
+					proxies = []map[string]any{}
+				}
+				results[current].Proxies = proxies
+			}
+		}()
+	}
+	wg.Wait()
+	return results
+}
+
+// ConvertSubscriptions parses a JSON array of subscription bodies in one cgo
+// call. The result is a JSON array in input order where every element is
+// either {"proxies": [...]} or {"error": "..."}; malformed input yields a
+// top-level {"error": "..."} object like ConvertSubscription.
+//
+//export ConvertSubscriptions
+func ConvertSubscriptions(data *C.char) *C.char {
+	if data == nil {
+		return C.CString(`{"error": "null input"}`)
+	}
+
+	var subscriptions []string
+	if err := json.Unmarshal([]byte(C.GoString(data)), &subscriptions); err != nil {
+		errJSON, _ := json.Marshal(map[string]string{
+			"error": "invalid batch input: " + err.Error(),
+		})
+		return C.CString(string(errJSON))
+	}
+
+	result, err := json.Marshal(convertSubscriptionBatch(subscriptions))
+	if err != nil {
+		errJSON, _ := json.Marshal(map[string]string{
+			"error": "failed to marshal result: " + err.Error(),
+		})
+		return C.CString(string(errJSON))
+	}
+	return C.CString(string(result))
+}
+
+// ConvertRulesetToMrs encodes a domain or ipcidr rule-provider YAML payload
+// as mrs. The result is binary, so its size is stored in *length; like
+// EncryptAgeArmored it starts with "OK\n" followed by the mrs bytes, or
+// "ERROR\n" followed by the reason. A payload without any valid rule gives
+// just "EMPTY\n", so the caller can answer it like any other empty ruleset.
+//
+//export ConvertRulesetToMrs
+func ConvertRulesetToMrs(data *C.char, behavior *C.char, length *C.longlong) *C.char {
+	result := []byte("ERROR\ninvalid mrs conversion input")
+	if data != nil && behavior != nil {
+		encoded, err := convertRulesetToMrs([]byte(C.GoString(data)), C.GoString(behavior))
+		if errors.Is(err, errEmptyMrsRuleset) {
+			result = []byte("EMPTY\n")
+		} else if err != nil {
+			result = []byte("ERROR\n" + err.Error())
+		} else {
+			result = append([]byte("OK\n"), encoded...)
+		}
+	}
+	if length != nil {
+		*length = C.longlong(len(result))
+	}
+	return (*C.char)(C.CBytes(result))
+}
+
 // FreeString frees memory allocated by Go (must be called from C++ after using the result)
 //
 //export FreeString
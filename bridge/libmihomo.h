@@ -87,10 +87,12 @@ typedef struct { void *data; GoInt len; GoInt cap; } GoSlice;
 extern "C" {
 #endif
 
-extern void ReleaseUnusedMemory(void);
+extern long long int SetMemoryLimit(long long int limit);
 extern char* ResolveAgeRecipient(char* key);
 extern char* EncryptAgeArmored(char* data, char* recipient);
 extern char* ConvertSubscription(char* data);
+extern char* ConvertSubscriptions(char* data);
+extern char* ConvertRulesetToMrs(char* data, char* behavior, long long int* length);
 extern void FreeString(char* s);
 
 #ifdef __cplusplus
@@ -571,3 +571,48 @@ func TestMieruExpansionLeavesUnrelatedInputByteForByte(t *testing.T) {
 		t.Fatalf("unrelated input changed:\nwant %q\n got %q", input, got)
 	}
 }
+
+func TestConvertSubscriptionBatchKeepsOrderAndIsolatesErrors(t *testing.T) {
+	valid := func(name string) string {
+		return strings.Join([]string{
+			"proxies:",
+			"  - name: " + name,
+			"    type: ss",
+			"    server: batch.example.com",
+			"    port: 8388",
+			"    cipher: aes-128-gcm",
+			"    password: password",
+		}, "\n")
+	}
+	invalid := strings.Join([]string{
+		"proxies:",
+		"  - name: Invalid",
+		"    type: unsupported-protocol",
+		"    server: invalid.example.com",
+		"    port: 443",
+	}, "\n")
+
+	inputs := []string{valid("First"), invalid, valid("Third")}
+	for i := 0; i < 16; i++ {
+		inputs = append(inputs, valid("Extra"))
+	}
+
+	results := convertSubscriptionBatch(inputs)
+	if len(results) != len(inputs) {
+		t.Fatalf("got %d results for %d inputs", len(results), len(inputs))
+	}
+	if results[0].Error != "" || len(results[0].Proxies) != 1 ||
+		results[0].Proxies[0]["name"] != "First" {
+		t.Fatalf("unexpected first result: %#v", results[0])
+	}
+	if results[1].Error == "" {
+		t.Fatal("expected the invalid body to report an error")
+	}
+	if results[2].Error != "" || len(results[2].Proxies) != 1 ||
+		results[2].Proxies[0]["name"] != "Third" {
+		t.Fatalf("a failed body affected its neighbour: %#v", results[2])
+	}
+	if len(convertSubscriptionBatch(nil)) != 0 {
+		t.Fatal("expected an empty batch to return no results")
+	}
+}
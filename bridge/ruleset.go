@@ -0,0 +1,98 @@
+package main
+
+import (
+	"bytes"
+	"encoding/binary"
+	"errors"
+	"fmt"
+	"io"
+	"strings"
+
+	"github.com/klauspost/compress/zstd"
+	"github.com/metacubex/mihomo/common/yaml"
+	"github.com/metacubex/mihomo/component/cidr"
+	"github.com/metacubex/mihomo/component/trie"
+	P "github.com/metacubex/mihomo/constant/provider"
+)
+
+// mrsMagic starts every mrs file (Mihomo's rules/provider.MrsMagicBytes).
+var mrsMagic = [4]byte{'M', 'R', 'S', 1}
+
+// errEmptyMrsRuleset is returned when no rule of the payload survives
+// conversion; such a file would load as a valid but empty rule provider.
+var errEmptyMrsRuleset = errors.New("no valid rules in ruleset payload")
+
+type rulesetPayload struct {
+	Payload []string `yaml:"payload"`
+}
+
+// convertRulesetToMrs encodes a domain or ipcidr rule-provider YAML payload
+// in Mihomo's binary mrs format, the way `mihomo convert-ruleset` does. It
+// builds the same succinct sets as Mihomo's rule providers, but only imports
+// the set packages: rules/provider would pull the GeoIP, GeoSite and resolver
+// modules into the bridge. A payload without a single valid rule is rejected
+// with errEmptyMrsRuleset.
+func convertRulesetToMrs(payload []byte, behavior string) ([]byte, error) {
+	schema := &rulesetPayload{}
+	if err := yaml.Unmarshal(payload, schema); err != nil {
+		return nil, fmt.Errorf("invalid ruleset payload: %w", err)
+	}
+
+	var ruleBehavior P.RuleBehavior
+	var count int64
+	var writeSet func(io.Writer) error
+	switch behavior {
+	case "domain":
+		ruleBehavior = P.Domain
+		domains := trie.New[struct{}]()
+		for _, rule := range schema.Payload {
+			if rule = strings.TrimSpace(rule); rule != "" && domains.Insert(rule, struct{}{}) == nil {
+				count++
+			}
+		}
+		if count == 0 {
+			return nil, errEmptyMrsRuleset
+		}
+		writeSet = domains.NewDomainSet().WriteBin
+	case "ipcidr":
+		ruleBehavior = P.IPCIDR
+		cidrs := cidr.NewIpCidrSet()
+		for _, rule := range schema.Payload {
+			if rule = strings.TrimSpace(rule); rule != "" && cidrs.AddIpCidrForString(rule) == nil {
+				count++
+			}
+		}
+		if count == 0 {
+			return nil, errEmptyMrsRuleset
+		}
+		if err := cidrs.Merge(); err != nil {
+			return nil, fmt.Errorf("mrs conversion failed: %w", err)
+		}
+		writeSet = cidrs.WriteBin
+	default:
+		return nil, fmt.Errorf("unsupported mrs behavior %q", behavior)
+	}
+
+	var encoded bytes.Buffer
+	encoder, err := zstd.NewWriter(&encoded, zstd.WithEncoderLevel(zstd.SpeedBestCompression))
+	if err != nil {
+		return nil, fmt.Errorf("mrs conversion failed: %w", err)
+	}
+	// Header: magic, behavior, rule count and an empty extra block, all ahead
+	// of the set itself.
+	header := make([]byte, 0, len(mrsMagic)+1+16)
+	header = append(header, mrsMagic[:]...)
+	header = append(header, ruleBehavior.Byte())
+	header = binary.BigEndian.AppendUint64(header, uint64(count))
+	header = binary.BigEndian.AppendUint64(header, 0)
+	if _, err = encoder.Write(header); err == nil {
+		err = writeSet(encoder)
+	}
+	if closeErr := encoder.Close(); err == nil {
+		err = closeErr
+	}
+	if err != nil {
+		return nil, fmt.Errorf("mrs conversion failed: %w", err)
+	}
+	return encoded.Bytes(), nil
+}
@@ -0,0 +1,137 @@
+package main
+
+import (
+	"bytes"
+	"encoding/binary"
+	"errors"
+	"io"
+	"net/netip"
+	"testing"
+
+	"github.com/klauspost/compress/zstd"
+	"github.com/metacubex/mihomo/component/cidr"
+	"github.com/metacubex/mihomo/component/trie"
+)
+
+// loadMrs reads an mrs file the way Mihomo's rule providers do: the header
+// (magic, behavior, rule count, extra block) and then the set through the
+// trie and cidr readers. Exactly one of the returned sets is non-nil.
+func loadMrs(t *testing.T, encoded []byte) (byte, int64, *trie.DomainSet, *cidr.IpCidrSet) {
+	t.Helper()
+	decoder, err := zstd.NewReader(bytes.NewReader(encoded))
+	if err != nil {
+		t.Fatalf("zstd reader: %v", err)
+	}
+	defer decoder.Close()
+
+	var magic [4]byte
+	if _, err := io.ReadFull(decoder, magic[:]); err != nil || magic != mrsMagic {
+		t.Fatalf("mrs magic: %v %v", magic, err)
+	}
+	var behavior [1]byte
+	if _, err := io.ReadFull(decoder, behavior[:]); err != nil {
+		t.Fatalf("mrs behavior: %v", err)
+	}
+	var count, extraLength int64
+	if err := binary.Read(decoder, binary.BigEndian, &count); err != nil {
+		t.Fatalf("mrs count: %v", err)
+	}
+	if err := binary.Read(decoder, binary.BigEndian, &extraLength); err != nil || extraLength < 0 {
+		t.Fatalf("mrs extra length: %d %v", extraLength, err)
+	}
+	if _, err := io.CopyN(io.Discard, decoder, extraLength); err != nil {
+		t.Fatalf("mrs extra: %v", err)
+	}
+
+	switch behavior[0] {
+	case 0:
+		domains, err := trie.ReadDomainSetBin(decoder)
+		if err != nil {
+			t.Fatalf("domain set: %v", err)
+		}
+		return behavior[0], count, domains, nil
+	case 1:
+		cidrs, err := cidr.ReadIpCidrSet(decoder)
+		if err != nil {
+			t.Fatalf("ipcidr set: %v", err)
+		}
+		return behavior[0], count, nil, cidrs
+	}
+	t.Fatalf("unexpected mrs behavior %d", behavior[0])
+	return 0, 0, nil, nil
+}
+
+func TestConvertRulesetToMrs(t *testing.T) {
+	domain, err := convertRulesetToMrs([]byte("payload:\n  - '+.example.com'\n  - 'example.org'\n"), "domain")
+	if err != nil || len(domain) == 0 {
+		t.Fatalf("domain conversion: %v", err)
+	}
+	again, err := convertRulesetToMrs([]byte("payload:\n  - '+.example.com'\n  - 'example.org'\n"), "domain")
+	if err != nil || !bytes.Equal(domain, again) {
+		t.Fatalf("domain conversion is not deterministic: %v", err)
+	}
+	behavior, count, domains, _ := loadMrs(t, domain)
+	if behavior != 0 || count != 2 || domains == nil {
+		t.Fatalf("domain header: %d %d", behavior, count)
+	}
+	for host, want := range map[string]bool{
+		"example.com":     true,
+		"www.example.com": true,
+		"example.org":     true,
+		"www.example.org": false,
+		"example.net":     false,
+	} {
+		if domains.Has(host) != want {
+			t.Errorf("domain set Has(%q) = %v, want %v", host, !want, want)
+		}
+	}
+
+	ipcidr, err := convertRulesetToMrs([]byte("payload:\n  - '10.0.0.0/8'\n  - '2001:db8::/32'\n"), "ipcidr")
+	if err != nil || len(ipcidr) == 0 {
+		t.Fatalf("ipcidr conversion: %v", err)
+	}
+	behavior, count, _, cidrs := loadMrs(t, ipcidr)
+	if behavior != 1 || count != 2 || cidrs == nil {
+		t.Fatalf("ipcidr header: %d %d", behavior, count)
+	}
+	for addr, want := range map[string]bool{
+		"10.1.2.3":    true,
+		"11.0.0.1":    false,
+		"2001:db8::1": true,
+		"2001:db9::1": false,
+	} {
+		if cidrs.IsContain(netip.MustParseAddr(addr)) != want {
+			t.Errorf("ipcidr set IsContain(%s) = %v, want %v", addr, !want, want)
+		}
+	}
+
+	if _, err := convertRulesetToMrs([]byte("payload:\n  - 'DOMAIN,example.com'\n"), "classical"); err == nil {
+		t.Fatalf("classical behavior must be rejected")
+	}
+}
+
+func TestConvertRulesetToMrsRejectsEmptyPayload(t *testing.T) {
+	for _, tc := range []struct {
+		payload, behavior string
+	}{
+		{"payload: []\n", "domain"},
+		{"payload: []\n", "ipcidr"},
+		{"proxies: []\n", "domain"},
+		{"payload:\n  - ''\n  - '  '\n", "domain"},
+		{"payload:\n  - 'not-a-cidr'\n  - '10.0.0.0/33'\n  - ''\n", "ipcidr"},
+	} {
+		encoded, err := convertRulesetToMrs([]byte(tc.payload), tc.behavior)
+		if !errors.Is(err, errEmptyMrsRuleset) || encoded != nil {
+			t.Errorf("%s %q: got %d bytes, err %v; want errEmptyMrsRuleset", tc.behavior, tc.payload, len(encoded), err)
+		}
+	}
+
+	// One surviving rule is enough.
+	encoded, err := convertRulesetToMrs([]byte("payload:\n  - 'not-a-cidr'\n  - '10.0.0.0/8'\n"), "ipcidr")
+	if err != nil {
+		t.Fatalf("partially valid ipcidr payload: %v", err)
+	}
+	if _, count, _, _ := loadMrs(t, encoded); count != 1 {
+		t.Fatalf("partially valid ipcidr count: %d", count)
+	}
+}
@@ -30,15 +30,6 @@ std::string lowerAscii(std::string value)
     return value;
 }
 
-std::string upperAscii(std::string value)
-{
-    std::transform(value.begin(), value.end(), value.begin(),
-                   [](unsigned char c) {
-                       return static_cast<char>(std::toupper(c));
-                   });
-    return value;
-}
-
 StrArray splitOptions(std::string_view value)
 {
     StrArray result;
@@ -56,18 +47,41 @@ StrArray splitOptions(std::string_view value)
     return result;
 }
 
-bool hasNoResolveOption(const std::string &rule)
+bool isAsciiSpace(unsigned char c)
+{
+    return std::isspace(c) != 0;
+}
+
+std::string_view trimAsciiView(std::string_view value)
+{
+    while(!value.empty() && isAsciiSpace(value.front()))
+        value.remove_prefix(1);
+    while(!value.empty() && isAsciiSpace(value.back()))
+        value.remove_suffix(1);
+    return value;
+}
+
+bool equalsUpperAscii(std::string_view value, std::string_view upper)
+{
+    return value.size() == upper.size() &&
+           std::equal(value.begin(), value.end(), upper.begin(),
+                      [](unsigned char c, char expected) {
+                          return std::toupper(c) == expected;
+                      });
+}
+
+bool hasNoResolveOption(std::string_view rule)
 {
     size_t begin = 0;
     while(begin <= rule.size())
     {
         const size_t end = rule.find(',', begin);
-        const std::string token = lowerAscii(trimAscii(std::string_view(rule).substr(
-            begin, end == std::string::npos ? rule.size() - begin
-                                            : end - begin)));
-        if(token == "no-resolve")
+        const std::string_view token = trimAsciiView(rule.substr(
+            begin, end == std::string_view::npos ? rule.size() - begin
+                                                 : end - begin));
+        if(equalsUpperAscii(token, "NO-RESOLVE"))
             return true;
-        if(end == std::string::npos)
+        if(end == std::string_view::npos)
             break;
         begin = end + 1;
     }
@@ -76,6 +90,23 @@ bool hasNoResolveOption(const std::string &rule)
 
 } // namespace
 
+const std::string &RulesetBody::text() const
+{
+    static const std::string empty;
+    return content ? *content : empty;
+}
+
+bool nextRulesetLine(std::string_view &body, char delimiter,
+                     std::string_view &line)
+{
+    if(body.empty())
+        return false;
+    const std::string_view::size_type end = body.find(delimiter);
+    line = body.substr(0, end);
+    body.remove_prefix(end == std::string_view::npos ? body.size() : end + 1);
+    return true;
+}
+
 RulesetOptions parseRulesetOptions(const StrArray &raw_options,
                                    StrArray *unknown_options)
 {
@@ -90,6 +121,11 @@ RulesetOptions parseRulesetOptions(const StrArray &raw_options,
             result.no_resolve = true;
             continue;
         }
+        if(option == "aggregate-cidr")
+        {
+            result.aggregate_cidr = true;
+            continue;
+        }
         constexpr std::string_view stash_format_prefix = "stash-format=";
         if(option.rfind(stash_format_prefix, 0) == 0)
         {
@@ -176,19 +212,25 @@ std::string buildClashRuleSetReference(const std::string &provider_name,
     return result;
 }
 
+bool clashRuleNeedsNoResolve(std::string_view rule, ruleset_type type,
+                             const RulesetOptions &options)
+{
+    if(type != RULESET_CLASH_IPCIDR || !options.no_resolve)
+        return false;
+
+    const std::string_view rule_type =
+        trimAsciiView(rule.substr(0, rule.find(',')));
+    if(!equalsUpperAscii(rule_type, "IP-CIDR") &&
+       !equalsUpperAscii(rule_type, "IP-CIDR6"))
+        return false;
+    return !hasNoResolveOption(rule);
+}
+
 std::string appendClashIpCidrNoResolve(const std::string &rule,
                                       ruleset_type type,
                                       const RulesetOptions &options)
 {
-    if(type != RULESET_CLASH_IPCIDR || !options.no_resolve)
-        return rule;
-
-    const size_t separator = rule.find(',');
-    const std::string rule_type =
-        upperAscii(trimAscii(rule.substr(0, separator)));
-    if(rule_type != "IP-CIDR" && rule_type != "IP-CIDR6")
-        return rule;
-    if(hasNoResolveOption(rule))
+    if(!clashRuleNeedsNoResolve(rule, type, options))
         return rule;
     return rule + ",no-resolve";
 }
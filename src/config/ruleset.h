@@ -1,6 +1,9 @@
 #ifndef RULESET_H_INCLUDED
 #define RULESET_H_INCLUDED
 
+#include <memory>
+#include <string_view>
+
 #include "def.h"
 
 enum ruleset_type
@@ -15,14 +18,34 @@ enum ruleset_type
 struct RulesetOptions
 {
     bool no_resolve = false;
+    bool aggregate_cidr = false;
     String stash_format;
 
     bool operator==(const RulesetOptions &r) const
     {
-        return no_resolve == r.no_resolve && stash_format == r.stash_format;
+        return no_resolve == r.no_resolve &&
+               aggregate_cidr == r.aggregate_cidr &&
+               stash_format == r.stash_format;
     }
 };
 
+// Ruleset text is immutable once fetched or converted, so the fetched
+// rulesets, the conversion cache and the emitters share one buffer.
+using RulesetText = std::shared_ptr<const std::string>;
+
+// A fetched ruleset body and its getContentDigest(), computed once on the
+// thread that fetched it so content-keyed caches never hash the body again.
+// Bodies served from the download cache keep theirs in memory alongside the
+// shared buffer, so a cache hit is not hashed either.
+struct RulesetBody
+{
+    RulesetText content;
+    String digest;
+
+    // The body, or an empty string when there is none.
+    const std::string &text() const;
+};
+
 struct ParsedRulesetInterval
 {
     Integer interval = 0;
@@ -51,10 +74,19 @@ ParsedRulesetInterval parseRulesetInterval(const String &raw_interval);
 bool parseRulesetConfigLine(const String &line, RulesetConfig &config,
                             StrArray *unknown_options = nullptr);
 
+// Splits the next delimiter-separated line off the front of body into line,
+// as getline() would. Returns false once body is used up.
+bool nextRulesetLine(std::string_view &body, char delimiter,
+                     std::string_view &line);
+
 std::string buildClashRuleSetReference(const std::string &provider_name,
                                        const std::string &group,
                                        ruleset_type type,
                                        const RulesetOptions &options);
+// True when `rule`, a Clash rule with its policy already attached, comes from
+// an ipcidr ruleset marked no-resolve and still lacks the no-resolve option.
+bool clashRuleNeedsNoResolve(std::string_view rule, ruleset_type type,
+                             const RulesetOptions &options);
 std::string appendClashIpCidrNoResolve(const std::string &rule,
                                       ruleset_type type,
                                       const RulesetOptions &options);
@@ -0,0 +1,243 @@
+#include "cidr_aggregation.h"
+
+#include <algorithm>
+#include <bit>
+#include <cctype>
+#include <charconv>
+#include <vector>
+
+namespace {
+
+bool isSpace(char ch) {
+  return ch == ' ' || ch == '\t' || ch == '\r' || ch == '\n';
+}
+
+std::string_view trim(std::string_view text) {
+  while (!text.empty() && isSpace(text.front()))
+    text.remove_prefix(1);
+  while (!text.empty() && isSpace(text.back()))
+    text.remove_suffix(1);
+  return text;
+}
+
+bool equalsUpper(std::string_view text, std::string_view upper) {
+  if (text.size() != upper.size())
+    return false;
+  for (size_t i = 0; i < text.size(); i++)
+    if (std::toupper(static_cast<unsigned char>(text[i])) != upper[i])
+      return false;
+  return true;
+}
+
+// An address as a 128-bit number; IPv4 addresses only use the low word.
+struct Value {
+  uint64_t high = 0, low = 0;
+
+  bool operator==(const Value &other) const = default;
+  bool operator<(const Value &other) const {
+    return high != other.high ? high < other.high : low < other.low;
+  }
+};
+
+uint64_t lowBits(unsigned count) {
+  return count >= 64 ? ~0ull : (1ull << count) - 1;
+}
+
+// value with its lowest host_bits bits cleared, or set when fill is true.
+Value withHostBits(Value value, unsigned host_bits, bool fill) {
+  const uint64_t high_mask = host_bits > 64 ? lowBits(host_bits - 64) : 0;
+  const uint64_t low_mask = lowBits(host_bits);
+  if (fill) {
+    value.high |= high_mask;
+    value.low |= low_mask;
+  } else {
+    value.high &= ~high_mask;
+    value.low &= ~low_mask;
+  }
+  return value;
+}
+
+Value next(Value value) {
+  if (++value.low == 0)
+    value.high++;
+  return value;
+}
+
+unsigned trailingZeros(const Value &value) {
+  if (value.low)
+    return std::countr_zero(value.low);
+  if (value.high)
+    return 64 + std::countr_zero(value.high);
+  return 128;
+}
+
+Value toValue(const client_ip::Address &address) {
+  Value value;
+  if (address.family == client_ip::Family::IPv4) {
+    for (size_t i = 0; i < 4; i++)
+      value.low = value.low << 8 | address.bytes[i];
+    return value;
+  }
+  for (size_t i = 0; i < 8; i++) {
+    value.high = value.high << 8 | address.bytes[i];
+    value.low = value.low << 8 | address.bytes[i + 8];
+  }
+  return value;
+}
+
+client_ip::Address toAddress(Value value, bool ipv6) {
+  client_ip::Address address;
+  address.family = ipv6 ? client_ip::Family::IPv6 : client_ip::Family::IPv4;
+  if (!ipv6) {
+    for (size_t i = 4; i-- > 0; value.low >>= 8)
+      address.bytes[i] = static_cast<uint8_t>(value.low);
+    return address;
+  }
+  for (size_t i = 8; i-- > 0; value.high >>= 8, value.low >>= 8) {
+    address.bytes[i] = static_cast<uint8_t>(value.high);
+    address.bytes[i + 8] = static_cast<uint8_t>(value.low);
+  }
+  return address;
+}
+
+struct Range {
+  Value first, last;
+};
+
+// Appends the fewest prefixes covering the union of ranges, in address
+// order, each as one rule line.
+void emitMerged(std::vector<Range> &ranges, bool ipv6, bool no_resolve,
+                std::string_view line_break, std::string &output) {
+  if (ranges.empty())
+    return;
+  const unsigned width = ipv6 ? 128 : 32;
+  const Value maximum = withHostBits({}, width, true);
+  std::sort(ranges.begin(), ranges.end(),
+            [](const Range &a, const Range &b) { return a.first < b.first; });
+
+  auto emit = [&](const Range &merged) {
+    Value start = merged.first;
+    for (;;) {
+      unsigned host_bits = std::min(trailingZeros(start), width);
+      while (host_bits && merged.last < withHostBits(start, host_bits, true))
+        host_bits--;
+      output += ipv6 ? "IP-CIDR6," : "IP-CIDR,";
+      output += client_ip::toString(toAddress(start, ipv6));
+      output += '/';
+      output += std::to_string(width - host_bits);
+      if (no_resolve)
+        output += ",no-resolve";
+      output += line_break;
+      const Value end = withHostBits(start, host_bits, true);
+      if (end == merged.last)
+        break;
+      start = next(end);
+    }
+  };
+
+  Range merged = ranges.front();
+  for (size_t i = 1; i < ranges.size(); i++) {
+    const Range &range = ranges[i];
+    if (merged.last == maximum || !(next(merged.last) < range.first)) {
+      if (merged.last < range.last)
+        merged.last = range.last;
+      continue;
+    }
+    emit(merged);
+    merged = range;
+  }
+  emit(merged);
+}
+
+} // namespace
+
+bool parseRuleCidr(std::string_view value, client_ip::Address &network,
+                   unsigned &prefix_length) {
+  const size_t slash = value.find('/');
+  if (slash == std::string_view::npos)
+    return false;
+  const std::string_view address = value.substr(0, slash);
+  network = client_ip::parseAddress(address);
+  // parseAddress folds IPv4-mapped IPv6 addresses into IPv4, which would
+  // read their prefix length in the wrong family.
+  const bool ipv6 = address.find(':') != std::string_view::npos;
+  if (!network.valid() ||
+      ipv6 != (network.family == client_ip::Family::IPv6))
+    return false;
+  const std::string_view digits = value.substr(slash + 1);
+  const auto parsed = std::from_chars(
+      digits.data(), digits.data() + digits.size(), prefix_length);
+  return parsed.ec == std::errc() &&
+         parsed.ptr == digits.data() + digits.size() &&
+         prefix_length <= (ipv6 ? 128u : 32u);
+}
+
+std::string aggregateCidrRules(std::string_view rules) {
+  const char delimiter =
+      rules.find('\n') != std::string_view::npos ? '\n' : '\r';
+  // Lines are written back with the body's own line break, CRLF included,
+  // and the last one only gets a break if the body ended with one.
+  const size_t first_break = rules.find(delimiter);
+  const bool crlf = delimiter == '\n' && first_break != 0 &&
+                    first_break != std::string_view::npos &&
+                    rules[first_break - 1] == '\r';
+  const std::string_view line_break =
+      crlf ? "\r\n" : std::string_view(&delimiter, 1);
+  // Indexed by [ipv6][no_resolve].
+  std::vector<Range> ranges[2][2];
+  std::string kept;
+  size_t merged_at = std::string::npos;
+
+  std::string_view remaining = rules;
+  while (!remaining.empty()) {
+    const size_t end = remaining.find(delimiter);
+    std::string_view line = remaining.substr(0, end);
+    if (crlf && !line.empty() && line.back() == '\r')
+      line.remove_suffix(1);
+    remaining.remove_prefix(end == std::string_view::npos ? remaining.size()
+                                                          : end + 1);
+
+    std::string_view fields[4];
+    size_t count = 0;
+    std::string_view rest = line;
+    while (count < 4) {
+      const size_t comma = rest.find(',');
+      fields[count++] = trim(rest.substr(0, comma));
+      if (comma == std::string_view::npos)
+        break;
+      rest.remove_prefix(comma + 1);
+    }
+    const bool no_resolve = count == 3 && equalsUpper(fields[2], "NO-RESOLVE");
+    client_ip::Address network;
+    unsigned prefix_length = 0;
+    if ((count == 2 || no_resolve) &&
+        (equalsUpper(fields[0], "IP-CIDR") ||
+         equalsUpper(fields[0], "IP-CIDR6") ||
+         equalsUpper(fields[0], "IP6-CIDR")) &&
+        parseRuleCidr(fields[1], network, prefix_length)) {
+      const bool ipv6 = network.family == client_ip::Family::IPv6;
+      const unsigned host_bits = (ipv6 ? 128 : 32) - prefix_length;
+      const Value value = toValue(network);
+      ranges[ipv6][no_resolve].push_back(
+          {withHostBits(value, host_bits, false),
+           withHostBits(value, host_bits, true)});
+      if (merged_at == std::string::npos)
+        merged_at = kept.size();
+      continue;
+    }
+    kept.append(line);
+    kept += line_break;
+  }
+  if (merged_at == std::string::npos)
+    return std::string(rules);
+
+  std::string merged;
+  for (int ipv6 = 0; ipv6 < 2; ipv6++)
+    for (int no_resolve = 0; no_resolve < 2; no_resolve++)
+      emitMerged(ranges[ipv6][no_resolve], ipv6, no_resolve, line_break,
+                 merged);
+  kept.insert(merged_at, merged);
+  if (rules.back() != delimiter)
+    kept.resize(kept.size() - line_break.size());
+  return kept;
+}
@@ -0,0 +1,24 @@
+#ifndef CIDR_AGGREGATION_H_INCLUDED
+#define CIDR_AGGREGATION_H_INCLUDED
+
+#include <string>
+#include <string_view>
+
+#include "server/client_ip.h"
+
+// Rewrites the IP-CIDR, IP-CIDR6 and IP6-CIDR lines of a Surge-form ruleset
+// body (one "TYPE,VALUE[,no-resolve]" rule per line, no policy) into the
+// fewest prefixes covering the same addresses: overlapping, contained and
+// adjacent ranges are merged separately per address family and per
+// no-resolve flag. Every rule in a ruleset shares its policy, so only the
+// order among those rules changes; the merged prefixes take the place of
+// the first range rule. Other lines, and range rules with any other option
+// or a value that does not parse, are kept as they are and in order.
+std::string aggregateCidrRules(std::string_view rules);
+
+// Parses the "ADDRESS/PREFIX" value of a range rule. IPv4-mapped IPv6
+// addresses are rejected rather than read as IPv4.
+bool parseRuleCidr(std::string_view value, client_ip::Address &network,
+                   unsigned &prefix_length);
+
+#endif // CIDR_AGGREGATION_H_INCLUDED
@@ -0,0 +1,156 @@
+#include "clash_rules.h"
+
+#include <cctype>
+
+namespace {
+
+// The set trimWhitespace() strips.
+bool isSpace(char ch) {
+  return ch == ' ' || ch == '\t' || ch == '\f' || ch == '\v' || ch == '\n' ||
+         ch == '\r';
+}
+
+std::string_view trimTrailing(std::string_view text) {
+  while (!text.empty() && isSpace(text.back()))
+    text.remove_suffix(1);
+  return text;
+}
+
+std::string_view trim(std::string_view text) {
+  while (!text.empty() && isSpace(text.front()))
+    text.remove_prefix(1);
+  return trimTrailing(text);
+}
+
+bool equalsUpper(std::string_view text, std::string_view upper) {
+  if (text.size() != upper.size())
+    return false;
+  for (size_t i = 0; i < text.size(); i++)
+    if (std::toupper(static_cast<unsigned char>(text[i])) != upper[i])
+      return false;
+  return true;
+}
+
+// Rule types whose payload contains commas, so the rule is passed through
+// whole with the policy appended.
+bool isCommaPayloadRule(std::string_view type) {
+  for (const std::string_view candidate :
+       {"AND", "OR", "NOT", "SUB-RULE", "DOMAIN-REGEX", "PROCESS-NAME-REGEX",
+        "PROCESS-PATH-REGEX"})
+    if (equalsUpper(type, candidate))
+      return true;
+  return false;
+}
+
+void appendJoined(std::string &output, std::string_view first,
+                  std::string_view second) {
+  output += first;
+  output += ',';
+  output += second;
+}
+
+} // namespace
+
+RuleTypePrefixTrie::RuleTypePrefixTrie(const std::vector<std::string> &types) {
+  for (const std::string &type : types)
+    for (const char ch : type) {
+      uint8_t &column = column_[static_cast<unsigned char>(ch)];
+      if (!column)
+        column = static_cast<uint8_t>(columns_++);
+    }
+
+  next_.assign(columns_, 0);
+  terminal_.assign(1, false);
+  for (const std::string &type : types) {
+    uint32_t node = 0;
+    for (const char ch : type) {
+      const size_t slot =
+          node * columns_ + column_[static_cast<unsigned char>(ch)];
+      if (!next_[slot]) {
+        next_[slot] = static_cast<uint32_t>(terminal_.size());
+        terminal_.push_back(false);
+        next_.resize(next_.size() + columns_, 0);
+      }
+      node = next_[slot];
+    }
+    terminal_[node] = true;
+  }
+}
+
+bool RuleTypePrefixTrie::matchesPrefix(std::string_view line) const {
+  uint32_t node = 0;
+  if (terminal_[node])
+    return true;
+  for (const char ch : line) {
+    const uint8_t column = column_[static_cast<unsigned char>(ch)];
+    if (!column)
+      return false;
+    node = next_[node * columns_ + column];
+    if (!node)
+      return false;
+    if (terminal_[node])
+      return true;
+  }
+  return false;
+}
+
+void emitClashRuleTarget(std::string &output, std::string_view rule,
+                         std::string_view target, bool no_resolve_only) {
+  rule = trim(rule);
+  const size_t pos = rule.find(',');
+  const std::string_view type =
+      trim(pos == std::string_view::npos ? rule : rule.substr(0, pos));
+
+  if (equalsUpper(type, "FINAL") || equalsUpper(type, "MATCH")) {
+    appendJoined(output, "MATCH", target);
+    return;
+  }
+  // A rule that ends right after its first comma has no second field.
+  if (pos == std::string_view::npos || isCommaPayloadRule(type) ||
+      pos + 1 >= rule.size()) {
+    appendJoined(output, rule, target);
+    return;
+  }
+
+  const size_t second_end = rule.find(',', pos + 1);
+  const std::string_view second = rule.substr(
+      pos + 1, second_end == std::string_view::npos ? std::string_view::npos
+                                                    : second_end - pos - 1);
+  appendJoined(output, rule.substr(0, pos), second);
+  output += ',';
+  output += target;
+  if (second_end == std::string_view::npos || second_end + 1 >= rule.size())
+    return;
+
+  const size_t third_end = rule.find(',', second_end + 1);
+  const std::string_view option = trim(rule.substr(
+      second_end + 1, third_end == std::string_view::npos
+                          ? std::string_view::npos
+                          : third_end - second_end - 1));
+  if (!no_resolve_only || option == "no-resolve") {
+    output += ',';
+    output += option;
+  }
+}
+
+bool emitClashRuleLine(std::string &output, std::string_view line,
+                       std::string_view group, ruleset_type type,
+                       const RulesetOptions &options,
+                       const RuleTypePrefixTrie &types) {
+  line = trim(line);
+  if (line.empty() || line[0] == ';' || line[0] == '#' ||
+      line.substr(0, 2) == "//")
+    return false;
+  if (!types.matchesPrefix(line))
+    return false;
+  const size_t comment = line.find("//");
+  if (comment != std::string_view::npos)
+    line = trimTrailing(line.substr(0, comment));
+
+  const size_t start = output.size();
+  emitClashRuleTarget(output, line, group);
+  if (clashRuleNeedsNoResolve(std::string_view(output).substr(start), type,
+                              options))
+    output += ",no-resolve";
+  return true;
+}
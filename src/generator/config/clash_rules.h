@@ -0,0 +1,46 @@
+#ifndef CLASH_RULES_H_INCLUDED
+#define CLASH_RULES_H_INCLUDED
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "config/ruleset.h"
+
+// Answers "does this line start with one of the rule types" with one walk of
+// a byte trie instead of a startsWith() call per type. Matching is
+// case-sensitive and by prefix, exactly like the scan it replaces, so
+// "IP-CIDR6,..." matches both IP-CIDR and IP-CIDR6.
+class RuleTypePrefixTrie {
+public:
+  explicit RuleTypePrefixTrie(const std::vector<std::string> &types);
+
+  bool matchesPrefix(std::string_view line) const;
+
+private:
+  // Bytes that occur in some type map to columns 1..N of the transition
+  // table; column 0 stands for every other byte and never has an edge.
+  std::array<uint8_t, 256> column_{};
+  size_t columns_ = 1;
+  std::vector<uint32_t> next_;
+  std::vector<bool> terminal_;
+};
+
+// Appends `rule` with the policy `target` attached to `output`. Same result
+// as appendClashRuleTarget() in ruleconvert.h, without temporaries.
+void emitClashRuleTarget(std::string &output, std::string_view rule,
+                         std::string_view target,
+                         bool no_resolve_only = false);
+
+// Turns one line of a converted ruleset body into a Clash rule for `group`
+// and appends it to `output`. Blank lines, comments and lines that do not
+// start with one of `types` are skipped; `output` is left untouched and false
+// is returned for them.
+bool emitClashRuleLine(std::string &output, std::string_view line,
+                       std::string_view group, ruleset_type type,
+                       const RulesetOptions &options,
+                       const RuleTypePrefixTrie &types);
+
+#endif // CLASH_RULES_H_INCLUDED
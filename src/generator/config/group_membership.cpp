@@ -0,0 +1,125 @@
+#include "group_membership.h"
+
+#include <algorithm>
+
+#include "utils/pattern_set.h"
+#include "utils/regexp.h"
+#include "utils/string.h"
+
+bool applyMatcher(const std::string &rule, std::string &real_rule,
+                  const Proxy &node);
+
+namespace {
+
+// Below this many node-rule evaluations the hand-off to workers costs more
+// than it saves.
+constexpr size_t kParallelMembershipMinCells = 16384;
+constexpr size_t kParallelMembershipRuleChunk = 2;
+// Literal rules are scanned node by node; workers take whole 64-node words so
+// no two of them write the same word.
+constexpr size_t kParallelMembershipWordChunk = 4;
+
+} // namespace
+
+GroupMembership::GroupMembership(const std::vector<Proxy> &nodes,
+                                 const ProxyGroupConfigs &groups,
+                                 const ParallelFor &parallel_for)
+    : nodes_(nodes) {
+  std::vector<const std::string *> pending;
+  for (const ProxyGroupConfig &group : groups) {
+    for (const std::string &rule : group.Proxies) {
+      if (precomputable(rule) && rules_.try_emplace(rule).second)
+        pending.push_back(&rules_.find(rule)->first);
+    }
+  }
+  if (pending.empty() || nodes_.empty())
+    return;
+
+  // Plain remark rules that are literal alternations (`香港|HK`, `(?i)iplc`)
+  // share one PatternSet, so each remark is scanned once for all of them.
+  // Regex and `!!` rules are still evaluated one rule at a time.
+  std::vector<std::string> literals;
+  std::vector<Bits *> literal_slots, slots;
+  std::vector<const std::string *> others;
+  for (const std::string *rule : pending) {
+    Bits &slot = rules_.find(*rule)->second;
+    if (!startsWith(*rule, "!!") && PatternSet::literal(*rule)) {
+      literals.push_back(*rule);
+      literal_slots.push_back(&slot);
+    } else {
+      others.push_back(rule);
+      slots.push_back(&slot);
+    }
+  }
+  const bool parallel = static_cast<bool>(parallel_for);
+
+  if (!literals.empty()) {
+    const PatternSet literal_rules(literals);
+    const size_t words = (nodes_.size() + 63) / 64;
+    for (Bits *slot : literal_slots)
+      slot->assign(words, 0);
+    const auto scan = [&](size_t begin, size_t end) {
+      std::vector<uint32_t> matched;
+      const size_t last = std::min(end * 64, nodes_.size());
+      for (size_t i = begin * 64; i < last; i++) {
+        literal_rules.matchIndices(nodes_[i].Remark, matched);
+        for (const uint32_t rule : matched)
+          (*literal_slots[rule])[i / 64] |= uint64_t(1) << (i % 64);
+      }
+    };
+    if (parallel &&
+        literals.size() * nodes_.size() >= kParallelMembershipMinCells)
+      parallel_for(words, kParallelMembershipWordChunk, scan);
+    else
+      scan(0, words);
+  }
+
+  if (others.empty())
+    return;
+  // Every slot exists already, so workers only write their own vectors.
+  const auto fill = [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++)
+      *slots[i] = evaluate(*others[i]);
+  };
+  if (parallel &&
+      others.size() * nodes_.size() >= kParallelMembershipMinCells)
+    parallel_for(others.size(), kParallelMembershipRuleChunk, fill);
+  else
+    fill(0, others.size());
+}
+
+bool GroupMembership::precomputable(const std::string &rule) {
+  return !startsWith(rule, "[]") && !startsWith(rule, "script:");
+}
+
+const GroupMembership::Bits &GroupMembership::members(const std::string &rule) {
+  auto found = rules_.find(rule);
+  if (found != rules_.end())
+    return found->second;
+  return rules_.emplace(rule, evaluate(rule)).first->second;
+}
+
+GroupMembership::Bits GroupMembership::evaluate(const std::string &rule) const {
+  Bits bits((nodes_.size() + 63) / 64, 0);
+  const auto set = [&bits](size_t index) {
+    bits[index / 64] |= uint64_t(1) << (index % 64);
+  };
+  if (!startsWith(rule, "!!")) {
+    // A plain remark rule is the same pattern for every node; literal
+    // alternations such as `香港|HK` skip the regex engine entirely.
+    const PatternSet remark_rule({rule});
+    for (size_t i = 0; i < nodes_.size(); i++) {
+      if (remark_rule.matchAny(nodes_[i].Remark))
+        set(i);
+    }
+    return bits;
+  }
+  std::string real_rule;
+  for (size_t i = 0; i < nodes_.size(); i++) {
+    const Proxy &node = nodes_[i];
+    if (applyMatcher(rule, real_rule, node) &&
+        (real_rule.empty() || regFind(node.Remark, real_rule)))
+      set(i);
+  }
+  return bits;
+}
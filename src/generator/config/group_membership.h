@@ -0,0 +1,52 @@
+#ifndef GROUP_MEMBERSHIP_H_INCLUDED
+#define GROUP_MEMBERSHIP_H_INCLUDED
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "config/proxygroup.h"
+#include "parser/config/proxy.h"
+
+// Runs body(begin, end) over contiguous chunks of [0, count) and returns once
+// all of them finished. Generators get one from the server so CPU-bound work
+// can use the ruleset executor; an empty function means run inline.
+using ParallelFor = std::function<void(
+    size_t count, size_t min_chunk,
+    const std::function<void(size_t, size_t)> &body)>;
+
+// Node x rule membership for the proxy groups of one generator call. Every
+// distinct selection rule (a remark regex or a `!!` matcher) is evaluated once
+// against the emitted node list, however many groups repeat it. Literal remark
+// rules are matched together in one scan of each remark; the rest are spread
+// over `parallel_for` when the matrix is large enough. groupGenerate then only
+// walks the set bits.
+//
+// `nodes` must not change while the matrix is in use. `[]` and `script:` rules
+// are left to groupGenerate.
+class GroupMembership {
+public:
+  using Bits = std::vector<uint64_t>;
+
+  GroupMembership(const std::vector<Proxy> &nodes,
+                  const ProxyGroupConfigs &groups,
+                  const ParallelFor &parallel_for);
+
+  const std::vector<Proxy> &nodes() const { return nodes_; }
+  size_t ruleCount() const { return rules_.size(); }
+  // Bits of `rule`; rules not seen while building are evaluated on demand.
+  const Bits &members(const std::string &rule);
+
+  static bool precomputable(const std::string &rule);
+
+private:
+  Bits evaluate(const std::string &rule) const;
+
+  const std::vector<Proxy> &nodes_;
+  std::unordered_map<std::string, Bits> rules_;
+};
+
+#endif // GROUP_MEMBERSHIP_H_INCLUDED
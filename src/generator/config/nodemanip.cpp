@@ -1,11 +1,19 @@
 #include <algorithm>
+#include <atomic>
+#include <cmath>
 #include <iostream>
+#include <memory>
+#include <numeric>
+#include <optional>
+#include <stdexcept>
+#include <span>
 #include <string>
 #include <utility>
 #include <vector>
 
 #include <nlohmann/json.hpp>
 
+#include "handler/multithread.h"
 #include "handler/settings.h"
 #include "handler/settings_view.h"
 #include "handler/webget.h"
@@ -15,13 +23,18 @@
 #include "parser/mihomo_bridge.h"
 #include "parser/mihomo_scheme_utils.h"
 #include "parser/subparser.h"
+#include "parser/subscription_stream.h"
 #include "script/script_quickjs.h"
 #include "subexport.h"
+#include "utils/concurrent_lru_cache.h"
+#include "utils/defer.h"
 #include "utils/file_extra.h"
 #include "utils/logger.h"
 #include "utils/map_extra.h"
+#include "utils/content_digest.h"
 #include "utils/network.h"
 #include "parser/config/proxy_utils.h"
+#include "utils/pattern_set.h"
 #include "utils/regexp.h"
 #include "utils/redact.h"
 #include "utils/string.h"
@@ -40,6 +53,56 @@ void copyNodes(std::vector<Proxy> &source, std::vector<Proxy> &dest) {
   std::move(source.begin(), source.end(), std::back_inserter(dest));
 }
 
+// Parses a base64 link-list subscription line by line while it downloads, so
+// the legacy parser never materializes the decoded copy of a large body. The
+// raw body is still buffered by webGet for caching and for the fallback: when
+// the stream turns out not to be a plain link list, take() fails and the
+// caller runs explodeConfContent on the whole body as before.
+class StreamedLinkList : public BodyChunkSink {
+public:
+  StreamedLinkList()
+      : stream_([this](std::string &line) {
+          if (looksLikeSurgeProxyList(line))
+            return false;
+          explodeSubLine(line, nodes_);
+          return true;
+        }) {}
+
+  void consume(std::string_view chunk) override {
+    // Called from libcurl's write callback, so nothing may propagate out of
+    // here. A failing line parser only costs the shortcut: take() reports
+    // false and the buffered body is parsed as usual.
+    try {
+      stream_.feed(chunk);
+    } catch (...) {
+      stream_.abandon();
+    }
+    if (stream_.abandoned() && !nodes_.empty())
+      std::vector<Proxy>().swap(nodes_);
+  }
+
+  void reset() override {
+    stream_.reset();
+    nodes_.clear();
+  }
+
+  bool take(const std::string &body, std::vector<Proxy> &nodes) {
+    // Cache hits, joined fetches and served-on-failure caches never pass
+    // through the sink, which shows up as a byte count mismatch.
+    if (!stream_.finish() || stream_.consumed() != body.size())
+      return false;
+    // explodeConfContent hands bodies mentioning "vnext" to the V2Ray parser.
+    if (strFind(body, "vnext") || nodes_.empty())
+      return false;
+    nodes = std::move(nodes_);
+    return true;
+  }
+
+private:
+  std::vector<Proxy> nodes_;
+  Base64LineStream stream_;
+};
+
 static void appendMihomoNodes(std::vector<mihomo::ProxyNode> &source,
                               std::vector<Proxy> &nodes) {
   nodes.reserve(nodes.size() + source.size());
@@ -174,15 +237,163 @@ static bool isBrowserUA(const std::string &ua) {
   return false;
 }
 
+// ========== 智能订阅/节点链接分流逻辑 ==========
+// 目标：准确区分订阅链接和节点链接，支持多种格式
+// Returns true when the SUB branch has to download the link; everything else
+// is a node link that goes to the parser as it is.
+static bool isSubscriptionLink(const std::string &link) {
+  // Surge install-config links wrap a remote subscription URL.
+  if (startsWith(link, "surge:///install-config"))
+    return true;
+  // 规则 1: HTTP(S) 开头的链接
+  if (mihomo::isHttpSchemeLink(link)) {
+    size_t protocolEnd = link.find("://") + 3;
+    size_t pathStart = link.find("/", protocolEnd);
+    size_t queryStart = link.find("?", protocolEnd);
+    // 有查询参数 = 订阅（非常明确）
+    // 例如: https://api.com/sub?token=xxx
+    if (queryStart != link.npos)
+      return true;
+    // 有实际路径（不只是单个 /）= 订阅
+    // 例如: https://api.com/api/v1/sub
+    // 只有单个 "/" 或无路径无参数 = HTTP 代理节点
+    // 例如: http://proxy.com:8080/, http://proxy.com:8080
+    return pathStart != link.npos && link.size() - pathStart > 1;
+  }
+  // 规则 2: 无协议头（无 ://）= 订阅
+  // 用户可能省略 http:// 或 https://
+  // 例如: api.com/sub, example.com/clash?token=xxx, sub.domain.com
+  // 规则 3/4: 其他协议 = 节点链接，由当前目标的解析器处理
+  return link.find("://") == link.npos;
+}
+
+static std::string fetchSubscription(std::string link,
+                                     parse_settings &parse_set,
+                                     std::string &extra_headers,
+                                     BodyChunkSink *sink) {
+  writeLog(LOG_LEVEL_VERBOSE, "正在下载订阅数据...");
+  if (startsWith(link, "surge:///install-config"))
+    link = urlDecode(getUrlArg(link, "url"));
+
+  // Replace browser UA with clash.meta to avoid subscription-side blocks.
+  if (string_icase_map *request_headers = parse_set.request_header) {
+    auto ua_it = request_headers->find("User-Agent");
+    if (ua_it != request_headers->end() && isBrowserUA(ua_it->second)) {
+      writeLog(LOG_LEVEL_VERBOSE,
+               "检测到浏览器 UA，已替换为 clash.meta UA 以避免被拦截");
+      ua_it->second = "clash.meta";
+    }
+  }
+
+  return webGet(link, *parse_set.proxy, effectiveSettings().cacheSubscription,
+                &extra_headers, parse_set.request_header,
+                parse_set.fetch_context, sink);
+}
+
+PrefetchedSources prefetchSources(const string_array &links,
+                                  parse_settings &parse_set) {
+  PrefetchedSources sources;
+#ifdef USE_MIHOMO_PARSER
+  if (parse_set.parser_mode != NodeParserMode::MihomoOnly ||
+      parse_set.force_direct_link)
+    return sources;
+
+  std::vector<PrefetchedSource *> parsed;
+  std::vector<std::string> bodies;
+  for (const std::string &raw : links) {
+    // Links that addNodes rewrites first (quotes, scripts, pipe lists) or
+    // that do not end up in the SUB branch take the regular path.
+    if (raw.empty() || raw.find('"') != std::string::npos ||
+        raw.find('|') != std::string::npos || startsWith(raw, "script:") ||
+        sources.count(raw))
+      continue;
+    std::string link = raw;
+    if (startsWith(link, "tag:")) {
+      string_size pos = link.find(",");
+      if (pos == link.npos)
+        continue;
+      link.erase(0, pos + 1);
+    }
+    if (startsWith(link, "https://t.me/") || startsWith(link, "tg://") ||
+        !(isLink(link) || startsWith(link, "surge:///install-config") ||
+          mihomo::isSupportedSchemeLink(link)))
+      continue;
+
+    PrefetchedSource &source = sources[raw];
+    if (isSubscriptionLink(link))
+      source.body = fetchSubscription(link, parse_set, source.extra_headers,
+                                      nullptr);
+    else
+      source.body = std::move(link);
+    if (!source.body.empty()) {
+      parsed.push_back(&source);
+      bodies.push_back(std::move(source.body));
+    }
+  }
+  if (bodies.empty())
+    return sources;
+
+  try {
+    auto results = mihomo::parseSubscriptions(bodies);
+    for (size_t i = 0; i < parsed.size(); ++i)
+      parsed[i]->parsed = std::move(results[i]);
+  } catch (const std::exception &e) {
+    writeLog(LOG_LEVEL_WARNING,
+             "Mihomo 批量解析失败，回退到逐条解析：" +
+                 summarizeSensitiveTextForLog(e.what()));
+  }
+  // addNodes still reads the body for the SSD subscription info.
+  for (size_t i = 0; i < parsed.size(); ++i)
+    parsed[i]->body = std::move(bodies[i]);
+#else
+  (void)links;
+  (void)parse_set;
+#endif // USE_MIHOMO_PARSER
+  return sources;
+}
+
+// Compiled userinfo stream/time rules, keyed by the rule text. Requests
+// mostly share the global rules; an external config brings its own set. The
+// cache is dropped whenever the settings generation changes.
+constexpr size_t kSubInfoRuleSets = 64;
+constexpr size_t kSubInfoRuleBytes = 4 * 1024 * 1024;
+static ConcurrentLruCache<std::string, std::shared_ptr<const SubInfoRules>>
+    sub_info_rules(kSubInfoRuleSets, kSubInfoRuleBytes);
+static std::atomic<unsigned long long> sub_info_rules_generation{0};
+
+static std::shared_ptr<const SubInfoRules>
+cachedSubInfoRules(const RegexMatchConfigs &stream_rules,
+                   const RegexMatchConfigs &time_rules) {
+  const unsigned long long generation = effectiveSettings().configGeneration;
+  if (sub_info_rules_generation.exchange(generation) != generation)
+    sub_info_rules.clear();
+  std::string key;
+  for (const RegexMatchConfigs *rules : {&stream_rules, &time_rules}) {
+    for (const RegexMatchConfig &x : *rules) {
+      key += x.Match;
+      key += '\x1f';
+      key += x.Replace;
+      key += '\x1e';
+    }
+    key += '\x1d';
+  }
+  return sub_info_rules.getOrCompute(
+      key, true, [&] { return compileSubInfoRules(stream_rules, time_rules); },
+      [&key](const std::shared_ptr<const SubInfoRules> &)
+          -> ConcurrentLruCache<std::string,
+                                std::shared_ptr<const SubInfoRules>>::CacheSize {
+        // The compiled patterns themselves live in the shared regex cache.
+        return key.size() * 2;
+      });
+}
+
 int addNodes(std::string link, std::vector<Proxy> &allNodes, int groupID,
              parse_settings &parse_set) {
-  ProxyPolicy &proxy = *parse_set.proxy;
   std::string &subInfo = *parse_set.sub_info;
   string_array &exclude_remarks = *parse_set.exclude_remarks;
   string_array &include_remarks = *parse_set.include_remarks;
   RegexMatchConfigs &stream_rules = *parse_set.stream_rules;
   RegexMatchConfigs &time_rules = *parse_set.time_rules;
-  string_icase_map *request_headers = parse_set.request_header;
   bool &authorized = parse_set.authorized;
 
   ConfType linkType = ConfType::Unknow;
@@ -190,6 +401,15 @@ int addNodes(std::string link, std::vector<Proxy> &allNodes, int groupID,
   Proxy node;
   std::string strSub, extra_headers, custom_group;
 
+  std::optional<PrefetchedSource> prefetched;
+  if (parse_set.prefetched) {
+    auto found = parse_set.prefetched->find(link);
+    if (found != parse_set.prefetched->end()) {
+      prefetched = std::move(found->second);
+      parse_set.prefetched->erase(found);
+    }
+  }
+
   // TODO: replace with startsWith if appropriate
   link = replaceAllDistinct(link, "\"", "");
 
@@ -205,7 +425,7 @@ int addNodes(std::string link, std::vector<Proxy> &allNodes, int groupID,
             if (args.size() >= 1) {
               std::string script = fileGet(args[0], false);
               try {
-                ctx.eval(script);
+                script_eval_cached(ctx, script);
                 args.erase(args.begin()); /// remove script path
                 auto parse = (std::function<std::string(const std::string &,
                                                         const string_array &)>)
@@ -279,7 +499,11 @@ int addNodes(std::string link, std::vector<Proxy> &allNodes, int groupID,
   // Handle pipe separated links recursively
   if (link.find('|') != std::string::npos && (isLink(link) || isMihomoScheme)) {
     std::vector<std::string> links = split(link, "|");
-    for (const auto &l : links) {
+    PrefetchedSources batch = prefetchSources(links, parse_set);
+    PrefetchedSources *outer = parse_set.prefetched;
+    parse_set.prefetched = &batch;
+    defer(parse_set.prefetched = outer;)
+    for (const std::string &l : links) {
       if (l.empty())
         continue;
       addNodes(l, allNodes, groupID, parse_set);
@@ -321,110 +545,32 @@ int addNodes(std::string link, std::vector<Proxy> &allNodes, int groupID,
       return 0; // Handled
     }
 
-    // ========== 智能订阅/节点链接分流逻辑 ==========
-    // 目标：准确区分订阅链接和节点链接，支持多种格式
-
-    bool isSubscription = false; // 订阅链接标志
-    bool isNodeLink = false;     // 节点链接标志
-
-    // Surge install-config links wrap a remote subscription URL.
-    if (startsWith(link, "surge:///install-config")) {
-      isSubscription = true;
-    }
-    // 规则 1: HTTP(S) 开头的链接
-    else if (mihomo::isHttpSchemeLink(link)) {
-      size_t protocolEnd = link.find("://") + 3;
-      size_t pathStart = link.find("/", protocolEnd);
-      size_t queryStart = link.find("?", protocolEnd);
-
-      // 有查询参数 = 订阅（非常明确）
-      // 例如: https://api.com/sub?token=xxx
-      if (queryStart != link.npos) {
-        isSubscription = true;
-      }
-      // 有实际路径（不只是单个 /）= 订阅
-      // 例如: https://api.com/api/v1/sub
-      else if (pathStart != link.npos) {
-        std::string path = link.substr(pathStart);
-        if (path.length() > 1) { // 路径长度 > 1（不只是尾部 /）
-          isSubscription = true;
-        } else {
-          // 只有单个 "/" = 可能是 HTTP 代理节点
-          // 例如: http://proxy.com:8080/
-          isNodeLink = true;
-        }
-      }
-      // 无路径无参数 = HTTP 代理节点
-      // 例如: http://proxy.com:8080
-      else {
-        isNodeLink = true;
-      }
-    }
-    // 规则 2: 无协议头（无 ://）= 订阅
-    // 用户可能省略 http:// 或 https://
-    // 例如: api.com/sub, example.com/clash?token=xxx, sub.domain.com
-    else if (link.find("://") == link.npos) {
-      isSubscription = true;
+    const bool isSubscription = isSubscriptionLink(link);
+    if (isSubscription && link.find("://") == link.npos)
       writeLog(LOG_LEVEL_VERBOSE,
                "检测到无协议头链接，按订阅处理：" +
                    summarizeUrlForLog(link));
-    }
-    // 规则 3: 在 SUPPORTED_SCHEMES 中 = 节点链接
-    // 例如: trojan://..., vmess://..., hysteria2://...
-    else {
-      isNodeLink = mihomo::isSupportedSchemeLink(link);
-      // 规则 4: 其他未知协议 = 节点链接（交给当前目标的解析器尝试）
-      // 例如: newproto://..., unknown://...
-      // 解析器会拒绝自己不支持的协议。
-      if (!isNodeLink) {
-        isNodeLink = true;
-        writeLog(LOG_LEVEL_VERBOSE,
-                 "检测到未知协议，交给当前目标的节点解析器处理：" +
-                     summarizeUrlForLog(link));
-      }
-    }
+    else if (!isSubscription && !mihomo::isHttpSchemeLink(link) &&
+             !mihomo::isSupportedSchemeLink(link))
+      writeLog(LOG_LEVEL_VERBOSE,
+               "检测到未知协议，交给当前目标的节点解析器处理：" +
+                   summarizeUrlForLog(link));
+
+    StreamedLinkList streamed;
+    BodyChunkSink *streamed_sink = use_mihomo_parser ? nullptr : &streamed;
 
     // Clash proxy-provider sources are intercepted by the caller. Any
     // subscription URL that reaches addNodes must be expanded into nodes.
-    if (isSubscription) {
-      writeLog(LOG_LEVEL_VERBOSE, "正在下载订阅数据...");
-      if (startsWith(link, "surge:///install-config"))
-        link = urlDecode(getUrlArg(link, "url"));
-
-      // Replace browser UA with clash.meta to avoid subscription-side blocks.
-      if (request_headers) {
-        auto ua_it = request_headers->find("User-Agent");
-        if (ua_it != request_headers->end() && isBrowserUA(ua_it->second)) {
-          writeLog(LOG_LEVEL_VERBOSE,
-                   "检测到浏览器 UA，已替换为 clash.meta UA 以避免被拦截");
-          ua_it->second = "clash.meta";
-        }
-      }
-
-      strSub = webGet(link, proxy, effectiveSettings().cacheSubscription,
-                      &extra_headers, request_headers, parse_set.fetch_context);
-    } else if (isNodeLink) {
+    if (prefetched) {
+      strSub = std::move(prefetched->body);
+      extra_headers = std::move(prefetched->extra_headers);
+    } else if (isSubscription) {
+      strSub = fetchSubscription(link, parse_set, extra_headers,
+                                 streamed_sink);
+    } else {
       // 节点链接不需要下载，直接交给当前目标的解析器。
       writeLog(LOG_LEVEL_VERBOSE, "检测到节点链接，正在直接解析...");
       strSub = link; // 直接使用链接本身作为解析内容
-    } else {
-      // 其他情况（surge config link 等）：保持原有逻辑
-      writeLog(LOG_LEVEL_VERBOSE, "正在下载订阅数据...");
-      if (startsWith(link, "surge:///install-config")) // surge config link
-        link = urlDecode(getUrlArg(link, "url"));
-
-      // Replace browser UA with clash.meta
-      if (request_headers) {
-        auto ua_it = request_headers->find("User-Agent");
-        if (ua_it != request_headers->end() && isBrowserUA(ua_it->second)) {
-          writeLog(LOG_LEVEL_VERBOSE,
-                   "检测到浏览器 UA，已替换为 clash.meta UA 以避免被拦截");
-          ua_it->second = "clash.meta";
-        }
-      }
-
-      strSub = webGet(link, proxy, effectiveSettings().cacheSubscription,
-                      &extra_headers, request_headers, parse_set.fetch_context);
     }
     /*
     if(strSub.size() == 0)
@@ -446,7 +592,15 @@ int addNodes(std::string link, std::vector<Proxy> &allNodes, int groupID,
                  "NODE_PARSER_INVOKE parser=mihomo branch=sub");
 #ifdef USE_MIHOMO_PARSER
         try {
-          auto mihomo_nodes = mihomo::parseSubscription(strSub);
+          std::vector<mihomo::ProxyNode> mihomo_nodes;
+          if (prefetched && prefetched->parsed) {
+            mihomo::SubscriptionResult &batched = *prefetched->parsed;
+            if (!batched.error.empty())
+              throw std::runtime_error(batched.error);
+            mihomo_nodes = std::move(batched.nodes);
+          } else {
+            mihomo_nodes = mihomo::parseSubscription(strSub);
+          }
           appendMihomoNodes(mihomo_nodes, nodes);
         } catch (const std::exception &e) {
           recordParserFailure();
@@ -474,7 +628,11 @@ int addNodes(std::string link, std::vector<Proxy> &allNodes, int groupID,
         recordParserInvocation();
         writeLog(LOG_LEVEL_VERBOSE,
                  "NODE_PARSER_INVOKE parser=legacy branch=sub");
-        if (explodeConfContent(strSub, nodes) == 0) {
+        if (streamed.take(strSub, nodes)) {
+          writeLog(LOG_LEVEL_VERBOSE,
+                   "NODE_PARSER_STREAMED parser=legacy branch=sub nodes=" +
+                       std::to_string(nodes.size()));
+        } else if (explodeConfContent(strSub, nodes) == 0) {
           recordParserFailure();
           writeLog(LOG_LEVEL_ERROR,
                    "NODE_PARSER_FAILED parser=legacy branch=sub reason=no_nodes");
@@ -486,7 +644,8 @@ int addNodes(std::string link, std::vector<Proxy> &allNodes, int groupID,
         getSubInfoFromSSD(strSub, subInfo);
       } else {
         if (!getSubInfoFromHeader(extra_headers, subInfo))
-          getSubInfoFromNodes(nodes, stream_rules, time_rules, subInfo);
+          getSubInfoFromNodes(
+              nodes, *cachedSubInfoRules(stream_rules, time_rules), subInfo);
       }
       writeLog(LOG_LEVEL_VERBOSE,
                "过滤前节点数：" + std::to_string(nodes.size()));
@@ -528,7 +687,8 @@ int addNodes(std::string link, std::vector<Proxy> &allNodes, int groupID,
     if (startsWith(strSub, "ssd://")) {
       getSubInfoFromSSD(strSub, subInfo);
     } else {
-      getSubInfoFromNodes(nodes, stream_rules, time_rules, subInfo);
+      getSubInfoFromNodes(
+          nodes, *cachedSubInfoRules(stream_rules, time_rules), subInfo);
     }
     filterNodes(nodes, exclude_remarks, include_remarks, groupID);
     for (Proxy &x : nodes) {
@@ -611,39 +771,49 @@ int addNodes(std::string link, std::vector<Proxy> &allNodes, int groupID,
   return 0;
 }
 
-bool chkIgnore(const Proxy &node, string_array &exclude_remarks,
-               string_array &include_remarks) {
-  bool excluded = false, included = false;
-  // std::string remarks = UTF8ToACP(node.remarks);
-  // std::string remarks = node.remarks;
-  // writeLog(LOG_LEVEL_VERBOSE, "正在匹配排除规则...");
-  excluded = std::any_of(exclude_remarks.cbegin(), exclude_remarks.cend(),
-                         [&node](const auto &x) {
-                           std::string real_rule;
-                           if (applyMatcher(x, real_rule, node)) {
-                             if (real_rule.empty())
-                               return true;
-                             return regFind(node.Remark, real_rule);
-                           } else
-                             return false;
-                         });
-  if (include_remarks.size() != 0) {
-    // writeLog(LOG_LEVEL_VERBOSE, "正在匹配包含规则...");
-    included = std::any_of(include_remarks.cbegin(), include_remarks.cend(),
-                           [&node](const auto &x) {
-                             std::string real_rule;
-                             if (applyMatcher(x, real_rule, node)) {
-                               if (real_rule.empty())
-                                 return true;
-                               return regFind(node.Remark, real_rule);
-                             } else
-                               return false;
-                           });
-  } else {
-    included = true;
+// Remark rules of one include/exclude list. Plain remark patterns are matched
+// together through a PatternSet; rules with a `!!` matcher prefix still go
+// through applyMatcher for every node.
+class RemarkRuleSet {
+public:
+  explicit RemarkRuleSet(const string_array &rules) {
+    string_array remark_patterns;
+    for (const std::string &rule : rules) {
+      if (startsWith(rule, "!!"))
+        matcher_rules_.push_back(rule);
+      else
+        remark_patterns.push_back(rule);
+    }
+    remark_patterns_ = PatternSet(remark_patterns);
+  }
+
+  bool empty() const {
+    return remark_patterns_.empty() && matcher_rules_.empty();
+  }
+
+  bool matches(const Proxy &node) const {
+    if (remark_patterns_.matchAny(node.Remark))
+      return true;
+    return std::any_of(matcher_rules_.cbegin(), matcher_rules_.cend(),
+                       [&node](const std::string &rule) {
+                         std::string real_rule;
+                         if (!applyMatcher(rule, real_rule, node))
+                           return false;
+                         return real_rule.empty() ||
+                                regFind(node.Remark, real_rule);
+                       });
   }
 
-  return excluded || !included;
+private:
+  PatternSet remark_patterns_;
+  string_array matcher_rules_;
+};
+
+static bool chkIgnore(const Proxy &node, const RemarkRuleSet &exclude_rules,
+                      const RemarkRuleSet &include_rules) {
+  if (exclude_rules.matches(node))
+    return true;
+  return !include_rules.empty() && !include_rules.matches(node);
 }
 
 void filterNodes(std::vector<Proxy> &nodes, string_array &exclude_remarks,
@@ -651,9 +821,11 @@ void filterNodes(std::vector<Proxy> &nodes, string_array &exclude_remarks,
   const size_t input_count = nodes.size();
   size_t ignored_count = 0;
   int node_index = 0;
+  const RemarkRuleSet exclude_rules(exclude_remarks),
+      include_rules(include_remarks);
   auto write_iter = nodes.begin();
   for (auto iter = nodes.begin(); iter != nodes.end(); ++iter) {
-    if (chkIgnore(*iter, exclude_remarks, include_remarks)) {
+    if (chkIgnore(*iter, exclude_rules, include_rules)) {
       ignored_count++;
       continue;
     }
@@ -767,39 +939,75 @@ void filterNodes(std::vector<Proxy> &nodes, string_array &exclude_remarks,
   writeLog(LOG_LEVEL_VERBOSE, "过滤完成。");
 }
 
-void nodeRename(Proxy &node, const RegexMatchConfigs &rename_array,
-                extra_settings &ext) {
-  std::string &remark = node.Remark, original_remark = node.Remark,
-              returned_remark, real_rule;
+// Reads the source of a rename, emoji or sort script. Callers load it once per
+// pass over the node list instead of once per node.
+static std::string loadNodeScript(const std::string &script, bool scope_limit) {
+  if (startsWith(script, "path:"))
+    return fileGet(script.substr(5), scope_limit);
+  return script;
+}
 
+// Evaluates `script` once and calls `function_name` for every node through
+// `on_node(node, index, function)`. A failing call only skips that node, as it did when every node
+// evaluated the script on its own. With scriptCleanContext a fresh context is
+// still built for each rule, but it is now shared by all nodes of the pass.
+template <typename Signature, typename OnNode>
+static void runNodeScript(extra_settings &ext, const std::string &script,
+                          const char *function_name, std::span<Proxy> nodes,
+                          OnNode on_node) {
+  script_safe_runner(
+      ext.js_runtime, ext.js_context,
+      [&](qjs::Context &ctx) {
+        std::function<Signature> function;
+        try {
+          script_eval_cached(ctx, script);
+          function = (std::function<Signature>)ctx.eval(function_name);
+        } catch (qjs::exception) {
+          script_print_stack(ctx);
+          return;
+        }
+        for (size_t i = 0; i < nodes.size(); i++) {
+          try {
+            on_node(nodes[i], i, function);
+          } catch (qjs::exception) {
+            script_print_stack(ctx);
+          }
+        }
+      },
+      effectiveSettings().scriptCleanContext);
+}
+
+static void renameNodes(std::span<Proxy> nodes,
+                        const RegexMatchConfigs &rename_array,
+                        extra_settings &ext) {
+  if (rename_array.empty())
+    return;
+  string_array original_remarks;
+  original_remarks.reserve(nodes.size());
+  for (const Proxy &node : nodes)
+    original_remarks.push_back(node.Remark);
+
+  std::string real_rule;
   for (const RegexMatchConfig &x : rename_array) {
     if (!x.Script.empty() && ext.authorized) {
-      script_safe_runner(
-          ext.js_runtime, ext.js_context,
-          [&](qjs::Context &ctx) {
-            std::string script = x.Script;
-            if (startsWith(script, "path:"))
-              script = fileGet(script.substr(5), true);
-            try {
-              ctx.eval(script);
-              auto rename =
-                  (std::function<std::string(const Proxy &)>)ctx.eval("rename");
-              returned_remark = rename(node);
-              if (!returned_remark.empty())
-                remark = returned_remark;
-            } catch (qjs::exception) {
-              script_print_stack(ctx);
-            }
-          },
-          effectiveSettings().scriptCleanContext);
+      const std::string script = loadNodeScript(x.Script, true);
+      runNodeScript<std::string(const Proxy &)>(
+          ext, script, "rename", nodes, [](Proxy &node, size_t, auto &rename) {
+            std::string returned_remark = rename(node);
+            if (!returned_remark.empty())
+              node.Remark = std::move(returned_remark);
+          });
       continue;
     }
-    if (applyMatcher(x.Match, real_rule, node) && real_rule.size())
-      remark = regReplace(remark, real_rule, x.Replace);
+    for (Proxy &node : nodes) {
+      if (applyMatcher(x.Match, real_rule, node) && real_rule.size())
+        node.Remark = regReplace(node.Remark, real_rule, x.Replace);
+    }
+  }
+  for (size_t i = 0; i < nodes.size(); i++) {
+    if (nodes[i].Remark.empty())
+      nodes[i].Remark = std::move(original_remarks[i]);
   }
-  if (remark.empty())
-    remark = original_remark;
-  return;
 }
 
 std::string removeEmoji(const std::string &orig_remark) {
@@ -816,78 +1024,238 @@ std::string removeEmoji(const std::string &orig_remark) {
   return remark;
 }
 
-std::string addEmoji(const Proxy &node, const RegexMatchConfigs &emoji_array,
-                     extra_settings &ext) {
-  std::string real_rule, ret;
-
+// The first emoji rule that matches a node decides its emoji; later rules
+// only look at the nodes still without one.
+static void addEmojis(std::span<Proxy> nodes,
+                      const RegexMatchConfigs &emoji_array,
+                      extra_settings &ext) {
+  std::vector<bool> decided(nodes.size(), false);
+  std::string real_rule;
   for (const RegexMatchConfig &x : emoji_array) {
     if (!x.Script.empty() && ext.authorized) {
-      std::string result;
-      script_safe_runner(
-          ext.js_runtime, ext.js_context,
-          [&](qjs::Context &ctx) {
-            std::string script = x.Script;
-            if (startsWith(script, "path:"))
-              script = fileGet(script.substr(5), true);
-            try {
-              ctx.eval(script);
-              auto getEmoji =
-                  (std::function<std::string(const Proxy &)>)ctx.eval(
-                      "getEmoji");
-              ret = getEmoji(node);
-              if (!ret.empty())
-                result = ret + " " + node.Remark;
-            } catch (qjs::exception) {
-              script_print_stack(ctx);
-            }
-          },
-          effectiveSettings().scriptCleanContext);
-      if (!result.empty())
-        return result;
+      const std::string script = loadNodeScript(x.Script, true);
+      runNodeScript<std::string(const Proxy &)>(
+          ext, script, "getEmoji", nodes, [&decided](Proxy &node, size_t index, auto &getEmoji) {
+            if (decided[index])
+              return;
+            const std::string emoji = getEmoji(node);
+            if (emoji.empty())
+              return;
+            node.Remark = emoji + " " + node.Remark;
+            decided[index] = true;
+          });
       continue;
     }
     if (x.Replace.empty())
       continue;
-    if (applyMatcher(x.Match, real_rule, node) && real_rule.size() &&
-        regFind(node.Remark, real_rule))
-      return x.Replace + " " + node.Remark;
+    for (size_t index = 0; index < nodes.size(); index++) {
+      Proxy &node = nodes[index];
+      if (decided[index])
+        continue;
+      if (applyMatcher(x.Match, real_rule, node) && real_rule.size() &&
+          regFind(node.Remark, real_rule)) {
+        node.Remark = x.Replace + " " + node.Remark;
+        decided[index] = true;
+      }
+    }
+  }
+}
+
+static bool hasScriptRule(const RegexMatchConfigs &rules) {
+  return std::any_of(rules.cbegin(), rules.cend(),
+                     [](const RegexMatchConfig &x) { return !x.Script.empty(); });
+}
+
+// Remark transforms touch one node at a time, so without scripts (which share
+// one JS context) large lists are split across the ruleset executor. Small
+// lists are not worth the hand-off.
+constexpr size_t kParallelPreprocessMinNodes = 512;
+constexpr size_t kParallelPreprocessChunk = 256;
+
+// Final remarks keyed by the rule fingerprint and the incoming remark. The
+// same remarks come back request after request, and the rule sets only change
+// with a config reload or a different external config.
+constexpr size_t kRemarkMemoEntries = 65536;
+constexpr size_t kRemarkMemoBytes = 16 * 1024 * 1024;
+static ConcurrentLruCache<std::string, std::string>
+    remark_memo(kRemarkMemoEntries, kRemarkMemoBytes);
+static std::atomic<unsigned long long> remark_memo_generation{0};
+
+std::string remarkMemoFingerprint(const extra_settings &ext, bool scripted) {
+  if (scripted)
+    return {};
+  std::string material;
+  material += ext.remove_emoji ? '1' : '0';
+  material += ext.add_emoji ? '1' : '0';
+  const auto append_rules = [&material](const RegexMatchConfigs &rules) {
+    for (const RegexMatchConfig &x : rules) {
+      if (startsWith(x.Match, "!!"))
+        return false;
+      material += x.Match;
+      material += '\x1f';
+      material += x.Replace;
+      material += '\x1f';
+      material += x.Script;
+      material += '\x1e';
+    }
+    material += '\x1d';
+    return true;
+  };
+  if (!append_rules(ext.rename_array) ||
+      (ext.add_emoji && !append_rules(ext.emoji_array)))
+    return {};
+  return getContentDigest(material);
+}
+
+// Calls a script function and turns a pending JS exception into
+// qjs::exception, so callers fall back to the remark order.
+static qjs::Value callSortFunction(qjs::Context &ctx,
+                                   const qjs::Value &function, int argc,
+                                   JSValue *argv) {
+  JSValue result = JS_Call(ctx.ctx, function.v, JS_UNDEFINED, argc, argv);
+  if (JS_IsException(result))
+    throw qjs::exception{ctx.ctx};
+  return ctx.newValue(std::move(result));
+}
+
+// Orders `nodes` with the loaded sort script. When the script defines
+// sortKey(node), it is called once per node and the keys (numbers before
+// strings, NaN after every other number) are sorted natively. Otherwise
+// compare(a, b) is called as before, but each node is wrapped into a JS object
+// only once per sort. Nodes of unknown type go first in both modes. A script
+// error throws before `nodes` is touched.
+static void sortNodesWithScript(qjs::Context &ctx, std::vector<Proxy> &nodes) {
+  JSContext *js = ctx.ctx;
+  const qjs::Value global = ctx.global();
+  const qjs::Value sort_key =
+      ctx.newValue(JS_GetPropertyStr(js, global.v, "sortKey"));
+  const auto unknown = [&nodes](size_t index) {
+    return nodes[index].Type == ProxyType::Unknown;
+  };
+  std::vector<size_t> order(nodes.size());
+  std::iota(order.begin(), order.end(), 0);
+
+  if (JS_IsFunction(js, sort_key.v)) {
+    struct SortKey {
+      bool is_text = false;
+      double number = 0;
+      std::string text;
+    };
+    std::vector<SortKey> keys(nodes.size());
+    for (size_t i = 0; i < nodes.size(); i++) {
+      if (unknown(i))
+        continue;
+      qjs::Value node = ctx.newValue(nodes[i]);
+      qjs::Value key = callSortFunction(ctx, sort_key, 1, &node.v);
+      if (JS_IsNumber(key.v)) {
+        if (JS_ToFloat64(js, &keys[i].number, key.v))
+          throw qjs::exception{js};
+      } else {
+        keys[i].is_text = true;
+        keys[i].text = key.as<std::string>();
+      }
+    }
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+      if (unknown(a) || unknown(b))
+        return unknown(a) && !unknown(b);
+      const SortKey &x = keys[a], &y = keys[b];
+      if (x.is_text != y.is_text)
+        return !x.is_text;
+      if (x.is_text)
+        return x.text < y.text;
+      // NaN compares false both ways, which would break the strict weak
+      // ordering stable_sort relies on.
+      if (std::isnan(x.number) || std::isnan(y.number))
+        return !std::isnan(x.number) && std::isnan(y.number);
+      return x.number < y.number;
+    });
+  } else {
+    const qjs::Value compare = ctx.eval("compare");
+    std::vector<qjs::Value> wrapped;
+    wrapped.reserve(nodes.size());
+    for (const Proxy &node : nodes)
+      wrapped.push_back(ctx.newValue(node));
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+      if (unknown(a) || unknown(b))
+        return unknown(a) && !unknown(b);
+      JSValue args[2] = {wrapped[a].v, wrapped[b].v};
+      qjs::Value result = callSortFunction(ctx, compare, 2, args);
+      // compare() used to be read back as an int, so keep that truthiness.
+      int32_t before = 0;
+      if (JS_ToInt32(js, &before, result.v))
+        throw qjs::exception{js};
+      return before != 0;
+    });
   }
-  return node.Remark;
+
+  std::vector<Proxy> sorted;
+  sorted.reserve(nodes.size());
+  for (const size_t index : order)
+    sorted.push_back(std::move(nodes[index]));
+  nodes.swap(sorted);
 }
 
 void preprocessNodes(std::vector<Proxy> &nodes, extra_settings &ext) {
-  std::for_each(nodes.begin(), nodes.end(), [&ext](Proxy &x) {
-    if (ext.remove_emoji)
-      x.Remark = trim(removeEmoji(x.Remark));
+  const auto transform = [&ext](std::span<Proxy> chunk) {
+    if (ext.remove_emoji) {
+      for (Proxy &x : chunk)
+        x.Remark = trim(removeEmoji(x.Remark));
+    }
 
-    nodeRename(x, ext.rename_array, ext);
+    renameNodes(chunk, ext.rename_array, ext);
 
     if (ext.add_emoji)
-      x.Remark = addEmoji(x, ext.emoji_array, ext);
-  });
+      addEmojis(chunk, ext.emoji_array, ext);
+  };
+  const bool scripted =
+      ext.authorized && (hasScriptRule(ext.rename_array) ||
+                         (ext.add_emoji && hasScriptRule(ext.emoji_array)));
+
+  const unsigned long long generation = effectiveSettings().configGeneration;
+  if (remark_memo_generation.exchange(generation) != generation)
+    remark_memo.clear();
+  const std::string fingerprint = remarkMemoFingerprint(ext, scripted);
+  const auto memoized_transform = [&](std::span<Proxy> chunk) {
+    if (fingerprint.empty()) {
+      transform(chunk);
+      return;
+    }
+    std::string key;
+    for (Proxy &x : chunk) {
+      key.assign(fingerprint).append(1, '\0').append(x.Remark);
+      x.Remark = remark_memo.getOrCompute(
+          key, true,
+          [&] {
+            transform(std::span<Proxy>(&x, 1));
+            return x.Remark;
+          },
+          [&key](const std::string &value)
+              -> ConcurrentLruCache<std::string, std::string>::CacheSize {
+            return key.size() + value.size();
+          });
+    }
+  };
+
+  if (scripted || nodes.size() < kParallelPreprocessMinNodes) {
+    memoized_transform(nodes);
+  } else {
+    parallelForChunks(nodes.size(), kParallelPreprocessChunk,
+                      [&](size_t begin, size_t end) {
+                        memoized_transform(std::span<Proxy>(nodes).subspan(
+                            begin, end - begin));
+                      });
+  }
 
   if (ext.sort_flag) {
     bool failed = true;
     if (ext.sort_script.size() && ext.authorized) {
-      std::string script = ext.sort_script;
-      if (startsWith(script, "path:"))
-        script = fileGet(script.substr(5), false);
+      const std::string script = loadNodeScript(ext.sort_script, false);
       script_safe_runner(
           ext.js_runtime, ext.js_context,
           [&](qjs::Context &ctx) {
             try {
-              ctx.eval(script);
-              auto compare =
-                  (std::function<int(const Proxy &, const Proxy &)>)ctx.eval(
-                      "compare");
-              auto comparer = [&](const Proxy &a, const Proxy &b) {
-                if (a.Type == ProxyType::Unknown)
-                  return 1;
-                if (b.Type == ProxyType::Unknown)
-                  return 0;
-                return compare(a, b);
-              };
-              std::stable_sort(nodes.begin(), nodes.end(), comparer);
+              script_eval_cached(ctx, script);
+              sortNodesWithScript(ctx, nodes);
               failed = false;
             } catch (qjs::exception) {
               script_print_stack(ctx);
@@ -2,7 +2,9 @@
 #define NODEMANIP_H_INCLUDED
 
 #include <cstddef>
+#include <optional>
 #include <string>
+#include <unordered_map>
 #include <vector>
 #include <limits.h>
 
@@ -14,6 +16,7 @@
 #include "handler/fetch_context.h"
 #include "handler/proxy_policy.h"
 #include "parser/config/proxy.h"
+#include "parser/mihomo_bridge.h"
 #include "utils/map_extra.h"
 #include "utils/string.h"
 
@@ -27,6 +30,18 @@ struct NodeParserStats {
     std::size_t failures = 0;
 };
 
+// A source fetched before addNodes runs. The Mihomo parser reads the bodies
+// of all prefetched sources in one batched bridge call.
+struct PrefetchedSource
+{
+    std::string body;
+    std::string extra_headers;
+    std::optional<mihomo::SubscriptionResult> parsed;
+};
+
+// Keyed by the link exactly as it is later passed to addNodes.
+using PrefetchedSources = std::unordered_map<std::string, PrefetchedSource>;
+
 struct parse_settings
 {
     ProxyPolicy *proxy = nullptr;
@@ -41,15 +56,22 @@ struct parse_settings
     NodeParserStats *parser_stats = nullptr;
     FetchContext fetch_context = FetchContext::TrustedConfig;
     string_icase_map *request_header = nullptr;
+    PrefetchedSources *prefetched = nullptr;
 #ifndef NO_JS_RUNTIME
     qjs::Runtime *js_runtime = nullptr;
     qjs::Context *js_context = nullptr;
 #endif // NO_JS_RUNTIME
 };
 
+PrefetchedSources prefetchSources(const string_array &links, parse_settings &parse_set);
 int addNodes(std::string link, std::vector<Proxy> &allNodes, int groupID, parse_settings &parse_set);
 void filterNodes(std::vector<Proxy> &nodes, string_array &exclude_remarks, string_array &include_remarks, int groupID);
 bool applyMatcher(const std::string &rule, std::string &real_rule, const Proxy &node);
 void preprocessNodes(std::vector<Proxy> &nodes, extra_settings &ext);
+// Digest of everything emoji removal, renaming and emoji rules depend on, used
+// to memoize final remarks across requests. Empty when the result also depends
+// on more than the remark (scripts, or `!!` matchers that look at other node
+// fields), in which case preprocessNodes runs the rules for every node.
+std::string remarkMemoFingerprint(const extra_settings &ext, bool scripted);
 
 #endif // NODEMANIP_H_INCLUDED
@@ -0,0 +1,42 @@
+#include "remark_set.h"
+
+#include <algorithm>
+
+RemarkSet::RemarkSet(std::pmr::memory_resource *resource)
+    : used_(resource), next_suffix_(resource) {}
+
+std::string RemarkSet::uniqueRemark(const std::string &remark) {
+  if (!contains(remark))
+    return remark;
+  auto entry =
+      next_suffix_
+          .try_emplace(std::pmr::string(remark, next_suffix_.get_allocator()),
+                       2)
+          .first;
+  int &suffix = entry->second;
+  std::string candidate;
+  candidate.reserve(remark.size() + 12);
+  while (true) {
+    candidate.assign(remark).append(" ").append(std::to_string(suffix));
+    if (!contains(candidate))
+      return candidate;
+    suffix++;
+  }
+}
+
+void processRemark(std::string &remark, RemarkSet &used_remarks,
+                   bool proc_comma) {
+  // Replace every '=' with '-' in the remark string to avoid parse errors from
+  // the clients.
+  //     Surge is tested to yield an error when handling '=' in the remark
+  //     string, not sure if other clients have the same problem.
+  std::replace(remark.begin(), remark.end(), '=', '-');
+
+  if (proc_comma) {
+    if (remark.find(',') != std::string::npos) {
+      remark.insert(0, "\"");
+      remark.append("\"");
+    }
+  }
+  remark = used_remarks.uniqueRemark(remark);
+}
@@ -0,0 +1,43 @@
+#ifndef REMARK_SET_H_INCLUDED
+#define REMARK_SET_H_INCLUDED
+
+#include <cstddef>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+
+// Remarks already taken during one generator call. Entries are views into
+// strings owned by the caller (emitted nodes, base config names), which must
+// outlive the set. Remark sets only live for one generator call, so they
+// allocate from the request arena when one is active.
+class RemarkSet {
+public:
+  explicit RemarkSet(std::pmr::memory_resource *resource);
+
+  void reserve(size_t count) { used_.reserve(count); }
+  void emplace(std::string_view remark) { used_.emplace(remark); }
+  bool contains(std::string_view remark) const {
+    return used_.find(remark) != used_.end();
+  }
+
+  // Returns `remark` when it is free, otherwise the first free one of
+  // "remark 2", "remark 3", ...
+  std::string uniqueRemark(const std::string &remark);
+
+private:
+  std::pmr::unordered_set<std::string_view> used_;
+  // Per base remark, the lowest suffix that may still be free. Remarks are
+  // never removed, so every suffix below it stays taken and the next probe
+  // can start there instead of at 2.
+  std::pmr::unordered_map<std::pmr::string, int> next_suffix_;
+};
+
+// Makes `remark` safe for the generated config and unique among
+// `used_remarks`. The caller adds the result to the set once the node is
+// actually emitted.
+void processRemark(std::string &remark, RemarkSet &used_remarks,
+                   bool proc_comma = true);
+
+#endif // REMARK_SET_H_INCLUDED
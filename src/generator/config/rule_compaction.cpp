@@ -0,0 +1,163 @@
+#include "rule_compaction.h"
+
+#include <algorithm>
+#include <cctype>
+
+#include "cidr_aggregation.h"
+
+namespace {
+
+bool isSpace(char ch) {
+  return ch == ' ' || ch == '\t' || ch == '\r' || ch == '\n';
+}
+
+std::string_view trim(std::string_view text) {
+  while (!text.empty() && isSpace(text.front()))
+    text.remove_prefix(1);
+  while (!text.empty() && isSpace(text.back()))
+    text.remove_suffix(1);
+  return text;
+}
+
+bool equalsUpper(std::string_view text, std::string_view upper) {
+  if (text.size() != upper.size())
+    return false;
+  for (size_t i = 0; i < text.size(); i++)
+    if (std::toupper(static_cast<unsigned char>(text[i])) != upper[i])
+      return false;
+  return true;
+}
+
+} // namespace
+
+RuleCompactor::RuleCompactor() : domain_nodes_(1), cidr_nodes_(2), links_(1) {}
+
+bool RuleCompactor::admit(std::string_view rule) {
+  const std::string_view line = trim(rule);
+  std::string_view fields[5];
+  size_t count = 0;
+  while (count < 5) {
+    const size_t comma = rule.find(',');
+    fields[count++] = trim(rule.substr(0, comma));
+    if (comma == std::string_view::npos)
+      break;
+    rule.remove_prefix(comma + 1);
+  }
+  const bool no_resolve = count == 4 && equalsUpper(fields[3], "NO-RESOLVE");
+
+  const std::string_view type = fields[0];
+  bool kept = true;
+  if (count < 3 || count > 4 || fields[1].empty() || fields[2].empty() ||
+      (count == 4 && !no_resolve))
+    kept = admitLine(type, line);
+  else if (equalsUpper(type, "IP-CIDR") || equalsUpper(type, "IP-CIDR6") ||
+           equalsUpper(type, "IP6-CIDR"))
+    kept = admitCidr(fields[1], policyId(fields[2]), no_resolve);
+  else if (no_resolve)
+    kept = admitLine(type, line);
+  else if (equalsUpper(type, "DOMAIN") || equalsUpper(type, "HOST"))
+    kept = admitDomain(fields[1], policyId(fields[2]), false);
+  else if (equalsUpper(type, "DOMAIN-SUFFIX") ||
+           equalsUpper(type, "HOST-SUFFIX"))
+    kept = admitDomain(fields[1], policyId(fields[2]), true);
+  else
+    kept = admitLine(type, line);
+  if (!kept)
+    removed_++;
+  return kept;
+}
+
+uint32_t RuleCompactor::policyId(std::string_view policy) {
+  key_.assign(policy);
+  return policies_.try_emplace(key_, static_cast<uint32_t>(policies_.size()))
+      .first->second;
+}
+
+bool RuleCompactor::hasPolicy(uint32_t list, uint32_t policy,
+                              bool no_resolve) const {
+  for (; list; list = links_[list].next)
+    if (links_[list].policy == policy && (links_[list].resolves || no_resolve))
+      return true;
+  return false;
+}
+
+void RuleCompactor::addPolicy(uint32_t &list, uint32_t policy, bool resolves) {
+  links_.push_back({policy, resolves, list});
+  list = static_cast<uint32_t>(links_.size() - 1);
+}
+
+bool RuleCompactor::admitDomain(std::string_view domain, uint32_t policy,
+                                bool suffix) {
+  // Walks from the top-level label down; a DOMAIN-SUFFIX on any node passed
+  // covers the whole subtree below it.
+  uint32_t node = 0;
+  for (;;) {
+    const size_t dot = domain.rfind('.');
+    const std::string_view label =
+        dot == std::string_view::npos ? domain : domain.substr(dot + 1);
+    if (label.empty())
+      return true;
+    key_.assign(reinterpret_cast<const char *>(&node), sizeof(node));
+    for (const char ch : label)
+      key_ += static_cast<char>(std::tolower(static_cast<unsigned char>(ch)));
+    const auto [child, inserted] = domain_children_.try_emplace(
+        key_, static_cast<uint32_t>(domain_nodes_.size()));
+    if (inserted)
+      domain_nodes_.emplace_back();
+    node = child->second;
+    if (hasPolicy(domain_nodes_[node].suffix, policy, true))
+      return false;
+    if (dot == std::string_view::npos)
+      break;
+    domain = domain.substr(0, dot);
+  }
+
+  if (suffix) {
+    addPolicy(domain_nodes_[node].suffix, policy, true);
+    return true;
+  }
+  if (hasPolicy(domain_nodes_[node].exact, policy, true))
+    return false;
+  addPolicy(domain_nodes_[node].exact, policy, true);
+  return true;
+}
+
+bool RuleCompactor::admitLine(std::string_view type, std::string_view line) {
+  // The type is compared case-insensitively like everywhere else; the rest of
+  // the line has to repeat byte for byte, since for these types a value that
+  // only differs in case or spacing may well match something else.
+  key_.clear();
+  for (const char ch : type)
+    key_ += static_cast<char>(std::toupper(static_cast<unsigned char>(ch)));
+  key_.append(line.substr(std::min(line.find(','), line.size())));
+  return lines_.insert(key_).second;
+}
+
+bool RuleCompactor::admitCidr(std::string_view cidr, uint32_t policy,
+                              bool no_resolve) {
+  client_ip::Address address;
+  unsigned bits = 0;
+  if (!parseRuleCidr(cidr, address, bits))
+    return true;
+  const bool ipv4 = address.family == client_ip::Family::IPv4;
+
+  // A range without no-resolve also matches domains that resolve into it,
+  // so it covers later ranges either way; one with no-resolve only covers
+  // later no-resolve ranges.
+  uint32_t node = ipv4 ? 0 : 1;
+  for (unsigned depth = 0;; depth++) {
+    if (hasPolicy(cidr_nodes_[node].ranges, policy, no_resolve))
+      return false;
+    if (depth == bits)
+      break;
+    const unsigned bit = (address.bytes[depth / 8] >> (7 - depth % 8)) & 1;
+    if (!cidr_nodes_[node].child[bit]) {
+      const uint32_t child = static_cast<uint32_t>(cidr_nodes_.size());
+      cidr_nodes_.emplace_back();
+      cidr_nodes_[node].child[bit] = child;
+    }
+    node = cidr_nodes_[node].child[bit];
+  }
+  addPolicy(cidr_nodes_[node].ranges, policy, !no_resolve);
+  return true;
+}
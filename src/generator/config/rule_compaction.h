@@ -0,0 +1,66 @@
+#ifndef RULE_COMPACTION_H_INCLUDED
+#define RULE_COMPACTION_H_INCLUDED
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// Drops generated rules that can never take effect. A rule is shadowed when
+// a rule admitted before it has the same policy and matches everything it
+// matches, so with first-match evaluation removing it changes nothing:
+// DOMAIN and DOMAIN-SUFFIX rules repeated or under an earlier DOMAIN-SUFFIX
+// (a trie over reversed domain labels), IP-CIDR/IP-CIDR6 ranges repeated or
+// inside an earlier range (a binary radix tree over address bits), and exact
+// repeats of any other rule (DOMAIN-KEYWORD, GEOIP, PROCESS-NAME, logical
+// rules, options other than no-resolve, ...). DOMAIN and IP-CIDR values that
+// do not parse are always kept.
+class RuleCompactor {
+public:
+  RuleCompactor();
+
+  // Takes the next rule in order, "TYPE,VALUE,POLICY[,no-resolve]" in Clash
+  // or Surge form. Returns false when it is shadowed and should be dropped.
+  bool admit(std::string_view rule);
+
+  size_t removed() const { return removed_; }
+
+private:
+  // Singly linked lists of policies, index 0 ending a list.
+  struct PolicyLink {
+    uint32_t policy = 0;
+    bool resolves = false;
+    uint32_t next = 0;
+  };
+  struct DomainNode {
+    uint32_t exact = 0, suffix = 0;
+  };
+  struct CidrNode {
+    uint32_t child[2] = {0, 0};
+    uint32_t ranges = 0;
+  };
+
+  uint32_t policyId(std::string_view policy);
+  bool hasPolicy(uint32_t list, uint32_t policy, bool no_resolve) const;
+  void addPolicy(uint32_t &list, uint32_t policy, bool resolves);
+  bool admitDomain(std::string_view domain, uint32_t policy, bool suffix);
+  bool admitCidr(std::string_view cidr, uint32_t policy, bool no_resolve);
+  bool admitLine(std::string_view type, std::string_view line);
+
+  std::unordered_map<std::string, uint32_t> policies_;
+  // Keyed by the parent node id followed by the lower-cased label.
+  std::unordered_map<std::string, uint32_t> domain_children_;
+  std::vector<DomainNode> domain_nodes_;
+  // Nodes 0 and 1 are the IPv4 and IPv6 roots.
+  std::vector<CidrNode> cidr_nodes_;
+  std::vector<PolicyLink> links_;
+  // Upper-cased type followed by the rest of the line, for admitLine().
+  std::unordered_set<std::string> lines_;
+  std::string key_;
+  size_t removed_ = 0;
+};
+
+#endif // RULE_COMPACTION_H_INCLUDED
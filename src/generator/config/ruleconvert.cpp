@@ -4,20 +4,27 @@
 #include <cstdint>
 #include <limits>
 #include <map>
+#include <memory>
+#include <optional>
 #include <set>
-#include <sstream>
 #include <string>
+#include <string_view>
 #include <unordered_set>
 
+#include "handler/multithread.h"
 #include "handler/settings.h"
 #include "handler/settings_view.h"
 #include "utils/logger.h"
 #include "utils/concurrent_lru_cache.h"
-#include "utils/md5/md5_interface.h"
 #include "utils/network.h"
 #include "utils/regexp.h"
+#include "utils/request_arena.h"
 #include "utils/string.h"
 #include "utils/rapidjson_extra.h"
+#include "cidr_aggregation.h"
+#include "clash_rules.h"
+#include "rule_compaction.h"
+#include "ruleset_source.h"
 #include "subexport.h"
 
 /// rule type lists
@@ -31,105 +38,52 @@ string_array QuanXRuleTypes = {basic_types, "USER-AGENT", "HOST", "HOST-SUFFIX",
 string_array SurfRuleTypes = {basic_types, "IP-CIDR6", "PROCESS-NAME", "IN-PORT", "DEST-PORT", "SRC-IP"};
 string_array SingBoxRuleTypes = {basic_types, "IP-VERSION", "INBOUND", "PROTOCOL", "NETWORK", "GEOSITE", "SRC-GEOIP", "DOMAIN-REGEX", "PROCESS-NAME", "PROCESS-PATH", "PACKAGE-NAME", "PORT", "PORT-RANGE", "SRC-PORT", "SRC-PORT-RANGE", "USER", "USER-ID"};
 
-static std::string convertRulesetUncached(const std::string &content, int type)
-{
-    /// Target: Surge type,pattern[,flag]
-    /// Source: QuanX type,pattern[,group]
-    ///         Clash payload:\n  - 'ipcidr/domain/classic(Surge-like)'
-
-    std::string output, strLine;
-
-    if(type == RULESET_SURGE)
-        return content;
-
-    if(regFind(content, "^payload:\\r?\\n")) /// Clash
-    {
-        output = regReplace(regReplace(content, "payload:\\r?\\n", "", true), R"(\s?^\s*-\s+('|"?)(.*)\1$)", "\n$2", true);
-        if(type == RULESET_CLASH_CLASSICAL) /// classical type
-            return output;
-        std::stringstream ss;
-        ss << output;
-        char delimiter = getLineBreak(output);
-        output.clear();
-        string_size pos, lineSize;
-        while(getline(ss, strLine, delimiter))
-        {
-            strLine = trim(strLine);
-            lineSize = strLine.size();
-            if(lineSize && strLine[lineSize - 1] == '\r') //remove line break
-                strLine.erase(--lineSize);
-
-            if(strFind(strLine, "//"))
-            {
-                strLine.erase(strLine.find("//"));
-                strLine = trimWhitespace(strLine);
-            }
-
-            if(!strLine.empty() && (strLine[0] != ';' && strLine[0] != '#' && !(lineSize >= 2 && strLine[0] == '/' && strLine[1] == '/')))
-            {
-                pos = strLine.find('/');
-                if(pos != std::string::npos) /// ipcidr
-                {
-                    if(isIPv4(strLine.substr(0, pos)))
-                        output += "IP-CIDR,";
-                    else
-                        output += "IP-CIDR6,";
-                }
-                else
-                {
-                    if(strLine[0] == '.' || (lineSize >= 2 && strLine[0] == '+' && strLine[1] == '.')) /// suffix
-                    {
-                        bool keyword_flag = false;
-                        while(endsWith(strLine, ".*"))
-                        {
-                            keyword_flag = true;
-                            strLine.erase(strLine.size() - 2);
-                        }
-                        output += "DOMAIN-";
-                        if(keyword_flag)
-                            output += "KEYWORD,";
-                        else
-                            output += "SUFFIX,";
-                        strLine.erase(0, 2 - (strLine[0] == '.'));
-                    }
-                    else
-                        output += "DOMAIN,";
-                }
-            }
-            output += strLine;
-            output += '\n';
-        }
-        return output;
-    }
-    else /// QuanX
-    {
-        output = regReplace(regReplace(content, "^(?i:host)", "DOMAIN", true), "^(?i:ip6-cidr)", "IP-CIDR6", true); //translate type
-        output = regReplace(output, "^((?i:DOMAIN(?:-(?:SUFFIX|KEYWORD))?|IP-CIDR6?|USER-AGENT),)\\s*?(\\S*?)(?:,(?!no-resolve).*?)(,no-resolve)?$", "\\U$1\\E$2${3:-}", true); //remove group
-        return output;
-    }
-}
-
 namespace {
 
 constexpr size_t kRulesetConversionCacheEntries = 256;
 constexpr size_t kRulesetConversionCacheBytes = 16 * 1024 * 1024;
-ConcurrentLruCache<std::string, std::string> ruleset_conversion_cache(
+ConcurrentLruCache<std::string, RulesetText> ruleset_conversion_cache(
     kRulesetConversionCacheEntries, kRulesetConversionCacheBytes);
 
+// The rules of one ruleset rendered for one target and policy group, each
+// followed by a line break; ends[i] is the offset just past rule i.
+struct RenderedRuleset
+{
+    std::string text;
+    std::vector<size_t> ends;
+};
+
+using RenderedRulesetCache =
+    ConcurrentLruCache<std::string, std::shared_ptr<const RenderedRuleset>>;
+constexpr size_t kRenderedRulesetCacheEntries = 512;
+constexpr size_t kRenderedRulesetCacheBytes = 32 * 1024 * 1024;
+RenderedRulesetCache rendered_ruleset_cache(kRenderedRulesetCacheEntries,
+                                            kRenderedRulesetCacheBytes);
+
 } // namespace
 
-std::string convertRuleset(const std::string &content, int type)
+RulesetText convertRuleset(const RulesetBody &body, int type, bool aggregate_cidr)
 {
-    if(type == RULESET_SURGE)
-        return content;
-
-    const std::string key =
-        getMD5(content) + ":" + std::to_string(type);
+    if(!body.content)
+        return std::make_shared<const std::string>();
+    if(type == RULESET_SURGE && !aggregate_cidr)
+        return body.content;
+
+    std::string key = body.digest + ":" + std::to_string(type);
+    if(aggregate_cidr)
+        key += ":aggregate-cidr";
     return ruleset_conversion_cache.getOrCompute(
-        key, true, [&] { return convertRulesetUncached(content, type); },
-        [](const std::string &value)
-            -> ConcurrentLruCache<std::string, std::string>::CacheSize {
-            return value.size();
+        key, true,
+        [&] {
+            if(!aggregate_cidr)
+                return std::make_shared<const std::string>(
+                    convertRulesetSource(*body.content, type));
+            return std::make_shared<const std::string>(aggregateCidrRules(
+                *convertRuleset(body, type)));
+        },
+        [](const RulesetText &value)
+            -> ConcurrentLruCache<std::string, RulesetText>::CacheSize {
+            return value->size();
         });
 }
 
@@ -143,37 +97,20 @@ size_t rulesetConversionCacheMaxBytes()
     return kRulesetConversionCacheBytes;
 }
 
-static bool isClashCommaPayloadRule(const std::string &rule_type)
+size_t renderedRulesetCacheMaxEntries()
 {
-    return rule_type == "AND" || rule_type == "OR" || rule_type == "NOT" ||
-           rule_type == "SUB-RULE" || rule_type == "DOMAIN-REGEX" ||
-           rule_type == "PROCESS-NAME-REGEX" || rule_type == "PROCESS-PATH-REGEX";
+    return kRenderedRulesetCacheEntries;
 }
 
-std::string appendClashRuleTarget(const std::string &rule, const std::string &target, bool no_resolve_only)
+size_t renderedRulesetCacheMaxBytes()
 {
-    std::string strLine = trimWhitespace(rule, true, true);
-    std::string::size_type pos = strLine.find(',');
-    std::string rule_type = toUpper(trimWhitespace(pos == std::string::npos ? strLine : strLine.substr(0, pos), true, true));
-
-    if(rule_type == "FINAL" || rule_type == "MATCH")
-        return "MATCH," + target;
-
-    if(pos == std::string::npos || isClashCommaPayloadRule(rule_type))
-        return strLine + "," + target;
-
-    string_view_array temp;
-    split(temp, strLine, ',');
-    if(temp.size() < 2)
-        return strLine + "," + target;
+    return kRenderedRulesetCacheBytes;
+}
 
-    std::string output = std::string(temp[0]) + "," + std::string(temp[1]) + "," + target;
-    if(temp.size() > 2)
-    {
-        std::string option = trimWhitespace(std::string(temp[2]), true, true);
-        if(!no_resolve_only || option == "no-resolve")
-            output += "," + option;
-    }
+std::string appendClashRuleTarget(const std::string &rule, const std::string &target, bool no_resolve_only)
+{
+    std::string output;
+    emitClashRuleTarget(output, rule, target, no_resolve_only);
     return output;
 }
 
@@ -534,11 +471,11 @@ bool rulesetToStash(YAML::Node &base_rule,
             continue;
         }
 
-        std::string retrieved = source.rule_content.get();
+        const RulesetBody &body = source.rule_content.get();
         if(!stashRulesetGroupIsSafe(source.rule_group))
             return fail("a Stash ruleset policy name contains an unsafe value",
                         "Stash 规则集的策略名称包含不安全值");
-        if(retrieved.empty())
+        if(body.text().empty())
             return fail("a Stash ruleset could not be fetched or was empty",
                         "Stash 规则集获取失败或内容为空");
         if(source.rule_path.empty())
@@ -547,18 +484,19 @@ bool rulesetToStash(YAML::Node &base_rule,
         {
             stash_stats.expanded_sources++;
         }
-        if(startsWith(retrieved, "[]"))
-            retrieved.erase(0, 2);
-        else
-            retrieved = convertRuleset(retrieved, source.rule_type);
+        const RulesetText retrieved =
+            startsWith(body.text(), "[]")
+                ? std::make_shared<const std::string>(body.text().substr(2))
+                : convertRuleset(body, source.rule_type,
+                                 source.options.aggregate_cidr);
 
-        std::stringstream stream(retrieved);
+        std::string_view remaining = *retrieved, view;
         std::string line;
-        const char delimiter = getLineBreak(retrieved);
+        const char delimiter = getLineBreak(*retrieved);
         bool emitted_source_rule = false;
-        while(getline(stream, line, delimiter))
+        while(nextRulesetLine(remaining, delimiter, view))
         {
-            line = trimWhitespace(line, true, true);
+            line = trimWhitespace(std::string(view), true, true);
             if(line.empty() || line[0] == ';' || line[0] == '#' ||
                (line.size() >= 2 && line[0] == '/' && line[1] == '/'))
                 continue;
@@ -591,26 +529,189 @@ bool rulesetToStash(YAML::Node &base_rule,
     return true;
 }
 
+static const RuleTypePrefixTrie &clashRuleTypes()
+{
+    static const RuleTypePrefixTrie types(ClashRuleTypes);
+    return types;
+}
+
+// Calls on_line for every delimiter-separated line of body, as getline()
+// would, until it returns false.
+template <class OnLine>
+static void forEachRulesetLine(std::string_view body, char delimiter, OnLine &&on_line)
+{
+    std::string_view line;
+    while(nextRulesetLine(body, delimiter, line))
+        if(!on_line(line))
+            break;
+}
+
+// Grows output geometrically so that reserving per ruleset does not turn into
+// one reallocation per ruleset.
+static void reserveAtLeast(std::string &output, size_t size)
+{
+    if(size > output.capacity())
+        output.reserve(std::max(size, output.capacity() * 2));
+}
+
+// Rendering a ruleset for one target depends only on its body, type, policy
+// group and options, so the result is kept and later requests for the same
+// combination only copy it out.
+template <class Render>
+static std::shared_ptr<const RenderedRuleset> renderRulesetCached(const RulesetContent &x, const RulesetBody &body, const std::string &target, Render &&render)
+{
+    std::string key = body.digest;
+    key += ':';
+    key += std::to_string(x.rule_type);
+    key += ':';
+    key += target;
+    key += x.options.no_resolve ? ":no-resolve" : ":";
+    key += x.options.aggregate_cidr ? ":aggregate-cidr:" : "::";
+    key += x.rule_group;
+    return rendered_ruleset_cache.getOrCompute(
+        key, true, [&] {
+            auto fragment = std::make_shared<RenderedRuleset>();
+            render(x, *convertRuleset(body, x.rule_type, x.options.aggregate_cidr), *fragment);
+            return std::shared_ptr<const RenderedRuleset>(std::move(fragment));
+        },
+        [](const std::shared_ptr<const RenderedRuleset> &fragment) -> RenderedRulesetCache::CacheSize {
+            return fragment->text.size() + fragment->ends.size() * sizeof(size_t);
+        });
+}
+
+// Renders the fetched rulesets the caller is going to emit on the ruleset
+// executor, so that configs with many rulesets convert on every worker
+// instead of one after another. Entries left null (inline rules, empty
+// bodies, rulesets emits() rejects, rulesets past max_allowed_rules) are for
+// the caller to handle in order.
+template <class Emits, class Render>
+static std::vector<std::shared_ptr<const RenderedRuleset>> renderRulesetsParallel(const std::vector<RulesetContent> &ruleset_content_array, const std::string &target, Emits &&emits, Render &&render)
+{
+    std::vector<std::shared_ptr<const RenderedRuleset>> fragments(ruleset_content_array.size());
+    size_t count = ruleset_content_array.size();
+    // The caller stops once max_allowed_rules is passed, so only the rulesets
+    // up to that point are rendered ahead, counting a line per rule. Should
+    // fewer lines turn into rules, the caller renders the rest on demand.
+    if(const size_t max_allowed_rules = effectiveSettings().maxAllowedRules)
+    {
+        size_t lines = 0;
+        for(count = 0; count < ruleset_content_array.size() && lines <= max_allowed_rules; count++)
+        {
+            const RulesetContent &x = ruleset_content_array[count];
+            if(!emits(x))
+            {
+                lines++;
+                continue;
+            }
+            const std::string &text = x.rule_content.get().text();
+            lines += std::count(text.begin(), text.end(), '\n') + 1;
+        }
+    }
+    parallelForChunks(count, 1, [&](size_t begin, size_t end)
+    {
+        for(size_t i = begin; i < end; i++)
+        {
+            const RulesetContent &x = ruleset_content_array[i];
+            if(!emits(x))
+                continue;
+            const RulesetBody &body = x.rule_content.get();
+            if(!body.text().empty() && !startsWith(body.text(), "[]"))
+                fragments[i] = renderRulesetCached(x, body, target, render);
+        }
+    });
+    return fragments;
+}
+
+// The first `limit` rules of fragment, in rendered form. The per-rule checks
+// stop once total_rules exceeds max_allowed_rules, so a ruleset may still add
+// one rule past the limit.
+static std::string_view renderedRules(const RenderedRuleset &fragment, size_t max_allowed_rules, size_t total_rules, size_t &count)
+{
+    count = fragment.ends.size();
+    if(max_allowed_rules)
+        count = std::min(count, total_rules > max_allowed_rules ? 0 : max_allowed_rules - total_rules + 1);
+    return std::string_view(fragment.text).substr(0, count ? fragment.ends[count - 1] : 0);
+}
+
+// renderedRules() one rule at a time, leaving out the rules compactor finds
+// shadowed. Each rule is passed to emit as rendered, `prefix` bytes of
+// leading text and the line break included. Returns the number emitted.
+template <class Emit>
+static size_t emitCompactedRules(const RenderedRuleset &fragment, size_t prefix, RuleCompactor &compactor, size_t max_allowed_rules, size_t total_rules, Emit &&emit)
+{
+    size_t emitted = 0, begin = 0;
+    for(const size_t end : fragment.ends)
+    {
+        if(max_allowed_rules && total_rules + emitted > max_allowed_rules)
+            break;
+        const std::string_view line = std::string_view(fragment.text).substr(begin, end - begin);
+        begin = end;
+        if(!compactor.admit(line.substr(prefix, line.size() - prefix - 1)))
+            continue;
+        emit(line);
+        emitted++;
+    }
+    return emitted;
+}
+
+static std::optional<RuleCompactor> makeRuleCompactor()
+{
+    std::optional<RuleCompactor> compactor;
+    if(effectiveSettings().compactRules)
+        compactor.emplace();
+    return compactor;
+}
+
+static void logRuleCompaction(const std::optional<RuleCompactor> &compactor)
+{
+    if(compactor && compactor->removed())
+        writeLog(LOG_LEVEL_INFO, "规则压缩：已移除 " + std::to_string(compactor->removed()) + " 条被前面同策略规则覆盖的规则。");
+}
+
+// Renders each Clash rule as a block sequence entry, "  - <rule>\n".
+static void renderClashRules(const RulesetContent &x, const std::string &converted, RenderedRuleset &fragment)
+{
+    const char delimiter = getLineBreak(converted);
+    // Every emitted line gains at most "  - ", ",<group>", ",no-resolve" and
+    // the line break over its source line.
+    const size_t lines = std::count(converted.begin(), converted.end(), delimiter) + 1;
+    fragment.text.reserve(converted.size() + lines * (x.rule_group.size() + 17));
+    forEachRulesetLine(converted, delimiter, [&](std::string_view line)
+    {
+        const size_t mark = fragment.text.size();
+        fragment.text += "  - ";
+        if(!emitClashRuleLine(fragment.text, line, x.rule_group, x.rule_type, x.options, clashRuleTypes()))
+        {
+            fragment.text.resize(mark);
+            return true;
+        }
+        fragment.text += '\n';
+        fragment.ends.push_back(fragment.text.size());
+        return true;
+    });
+}
+
 void rulesetToClash(YAML::Node &base_rule, std::vector<RulesetContent> &ruleset_content_array, bool overwrite_original_rules, bool new_field_name, RuleConversionStats *stats)
 {
     RuleConversionStats local_stats;
-    string_array allRules;
-    std::string rule_group, retrieved_rules, strLine;
-    std::stringstream strStrm;
+    std::string rule;
     const std::string field_name = new_field_name ? "rules" : "Rule";
     const size_t max_allowed_rules = effectiveSettings().maxAllowedRules;
     YAML::Node rules;
     size_t total_rules = 0;
+    std::optional<RuleCompactor> compactor = makeRuleCompactor();
 
     if(!overwrite_original_rules && base_rule[field_name].IsDefined())
         rules = base_rule[field_name];
 
-    for(RulesetContent &x : ruleset_content_array)
+    const auto fragments = renderRulesetsParallel(ruleset_content_array, "clash", [](const RulesetContent &) { return true; }, renderClashRules);
+    for(size_t index = 0; index < ruleset_content_array.size(); index++)
     {
+        RulesetContent &x = ruleset_content_array[index];
         if(max_allowed_rules && total_rules > max_allowed_rules)
             break;
-        rule_group = x.rule_group;
-        retrieved_rules = x.rule_content.get();
+        const RulesetBody &body = x.rule_content.get();
+        const std::string &retrieved_rules = body.text();
         if(retrieved_rules.empty())
         {
             writeLog(LOG_LEVEL_WARNING, "获取规则集失败或规则集为空：'" + x.rule_path + "'。");
@@ -618,49 +719,41 @@ void rulesetToClash(YAML::Node &base_rule, std::vector<RulesetContent> &ruleset_
         }
         if(startsWith(retrieved_rules, "[]"))
         {
-            strLine = retrieved_rules.substr(2);
-            strLine = appendClashRuleTarget(strLine, rule_group);
-            allRules.emplace_back(strLine);
+            rule.clear();
+            emitClashRuleTarget(rule, std::string_view(retrieved_rules).substr(2), x.rule_group);
+            if(compactor && !compactor->admit(rule))
+                continue;
+            rules.push_back(rule);
             total_rules++;
             local_stats.add();
             continue;
         }
-        retrieved_rules = convertRuleset(retrieved_rules, x.rule_type);
-        char delimiter = getLineBreak(retrieved_rules);
-
-        strStrm.clear();
-        strStrm<<retrieved_rules;
-        std::string::size_type lineSize;
-        while(getline(strStrm, strLine, delimiter))
+        const auto fragment = fragments[index] ? fragments[index] : renderRulesetCached(x, body, "clash", renderClashRules);
+        size_t count = 0;
+        if(compactor)
         {
-            if(max_allowed_rules && total_rules > max_allowed_rules)
-                break;
-            strLine = trimWhitespace(strLine, true, true); //remove whitespaces
-            lineSize = strLine.size();
-            if(!lineSize || strLine[0] == ';' || strLine[0] == '#' || (lineSize >= 2 && strLine[0] == '/' && strLine[1] == '/')) //empty lines and comments are ignored
-                continue;
-            if(std::none_of(ClashRuleTypes.begin(), ClashRuleTypes.end(), [strLine](const std::string& type){return startsWith(strLine, type);}))
-                continue;
-            if(strFind(strLine, "//"))
+            count = emitCompactedRules(*fragment, 4, *compactor, max_allowed_rules, total_rules, [&](std::string_view line)
             {
-                strLine.erase(strLine.find("//"));
-                strLine = trimWhitespace(strLine);
-            }
-            strLine = appendClashRuleTarget(strLine, rule_group);
-            strLine =
-                appendClashIpCidrNoResolve(strLine, x.rule_type, x.options);
-            allRules.emplace_back(strLine);
-            total_rules++;
-            local_stats.add();
+                rules.push_back(std::string(line.substr(4, line.size() - 5)));
+            });
+            total_rules += count;
+            local_stats.add(count);
+            continue;
         }
-    }
-
-    for(std::string &x : allRules)
-    {
-        rules.push_back(x);
+        const std::string_view rendered = renderedRules(*fragment, max_allowed_rules, total_rules, count);
+        size_t begin = 0;
+        for(size_t i = 0; i < count; i++)
+        {
+            // Drop the "  - " in front and the line break behind each rule.
+            rules.push_back(std::string(rendered.substr(begin + 4, fragment->ends[i] - begin - 5)));
+            begin = fragment->ends[i];
+        }
+        total_rules += count;
+        local_stats.add(count);
     }
 
     base_rule[field_name] = rules;
+    logRuleCompaction(compactor);
     if(stats)
         stats->add(local_stats.rules);
 }
@@ -668,12 +761,11 @@ void rulesetToClash(YAML::Node &base_rule, std::vector<RulesetContent> &ruleset_
 std::string rulesetToClashStr(YAML::Node &base_rule, std::vector<RulesetContent> &ruleset_content_array, bool overwrite_original_rules, bool new_field_name, RuleConversionStats *stats)
 {
     RuleConversionStats local_stats;
-    std::string rule_group, retrieved_rules, strLine;
-    std::stringstream strStrm;
     const std::string field_name = new_field_name ? "rules" : "Rule";
     const size_t max_allowed_rules = effectiveSettings().maxAllowedRules;
     std::string output_content = "\n" + field_name + ":\n";
     size_t total_rules = 0;
+    std::optional<RuleCompactor> compactor = makeRuleCompactor();
 
     if(!overwrite_original_rules && base_rule[field_name].IsDefined())
     {
@@ -682,12 +774,14 @@ std::string rulesetToClashStr(YAML::Node &base_rule, std::vector<RulesetContent>
     }
     base_rule.remove(field_name);
 
-    for(RulesetContent &x : ruleset_content_array)
+    const auto fragments = renderRulesetsParallel(ruleset_content_array, "clash", [](const RulesetContent &) { return true; }, renderClashRules);
+    for(size_t index = 0; index < ruleset_content_array.size(); index++)
     {
+        RulesetContent &x = ruleset_content_array[index];
         if(max_allowed_rules && total_rules > max_allowed_rules)
             break;
-        rule_group = x.rule_group;
-        retrieved_rules = x.rule_content.get();
+        const RulesetBody &body = x.rule_content.get();
+        const std::string &retrieved_rules = body.text();
         if(retrieved_rules.empty())
         {
             writeLog(LOG_LEVEL_WARNING, "获取规则集失败或规则集为空：'" + x.rule_path + "'。");
@@ -695,57 +789,125 @@ std::string rulesetToClashStr(YAML::Node &base_rule, std::vector<RulesetContent>
         }
         if(startsWith(retrieved_rules, "[]"))
         {
-            strLine = retrieved_rules.substr(2);
-            strLine = appendClashRuleTarget(strLine, rule_group);
-            output_content += "  - " + strLine + "\n";
+            const size_t mark = output_content.size();
+            output_content += "  - ";
+            emitClashRuleTarget(output_content, std::string_view(retrieved_rules).substr(2), x.rule_group);
+            if(compactor && !compactor->admit(std::string_view(output_content).substr(mark + 4)))
+            {
+                output_content.resize(mark);
+                continue;
+            }
+            output_content += '\n';
             total_rules++;
             local_stats.add();
             continue;
         }
-        retrieved_rules = convertRuleset(retrieved_rules, x.rule_type);
-        char delimiter = getLineBreak(retrieved_rules);
-
-        strStrm.clear();
-        strStrm<<retrieved_rules;
-        std::string::size_type lineSize;
-        while(getline(strStrm, strLine, delimiter))
+        const auto fragment = fragments[index] ? fragments[index] : renderRulesetCached(x, body, "clash", renderClashRules);
+        size_t count = 0;
+        if(compactor)
         {
-            if(max_allowed_rules && total_rules > max_allowed_rules)
-                break;
-            strLine = trimWhitespace(strLine, true, true); //remove whitespaces
-            lineSize = strLine.size();
-            if(!lineSize || strLine[0] == ';' || strLine[0] == '#' || (lineSize >= 2 && strLine[0] == '/' && strLine[1] == '/')) //empty lines and comments are ignored
-                continue;
-            if(std::none_of(ClashRuleTypes.begin(), ClashRuleTypes.end(), [strLine](const std::string& type){ return startsWith(strLine, type); }))
-                continue;
-            if(strFind(strLine, "//"))
+            reserveAtLeast(output_content, output_content.size() + fragment->text.size());
+            count = emitCompactedRules(*fragment, 4, *compactor, max_allowed_rules, total_rules, [&](std::string_view line)
             {
-                strLine.erase(strLine.find("//"));
-                strLine = trimWhitespace(strLine);
-            }
-
-            strLine = appendClashRuleTarget(strLine, rule_group);
-            strLine =
-                appendClashIpCidrNoResolve(strLine, x.rule_type, x.options);
-            output_content += "  - " + strLine + "\n";
-            total_rules++;
-            local_stats.add();
+                output_content += line;
+            });
+        }
+        else
+        {
+            const std::string_view rendered = renderedRules(*fragment, max_allowed_rules, total_rules, count);
+            reserveAtLeast(output_content, output_content.size() + rendered.size());
+            output_content += rendered;
         }
+        total_rules += count;
+        local_stats.add(count);
     }
+    logRuleCompaction(compactor);
     if(stats)
         stats->add(local_stats.rules);
     return output_content;
 }
 
+// Applies the type filter and rewriting of rulesetToSurge() to one line of a
+// converted ruleset. Returns false when the line is not emitted.
+static bool renderSurgeRule(std::string &strLine, int surge_ver, const std::string &rule_group, string_view_array &temp)
+{
+    strLine = trimWhitespace(strLine, true, true);
+    const std::string::size_type lineSize = strLine.size();
+    if(!lineSize || strLine[0] == ';' || strLine[0] == '#' || (lineSize >= 2 && strLine[0] == '/' && strLine[1] == '/')) //empty lines and comments are ignored
+        return false;
+
+    /// remove unsupported types
+    switch(surge_ver)
+    {
+    case -2:
+        if(startsWith(strLine, "IP-CIDR6"))
+            return false;
+        [[fallthrough]];
+    case -1:
+        if(!std::any_of(QuanXRuleTypes.begin(), QuanXRuleTypes.end(), [&strLine](const std::string& type){return startsWith(strLine, type);}))
+            return false;
+        break;
+    case -3:
+        if(!std::any_of(SurfRuleTypes.begin(), SurfRuleTypes.end(), [&strLine](const std::string& type){return startsWith(strLine, type);}))
+            return false;
+        break;
+    default:
+        if(surge_ver > 2)
+        {
+            if(!std::any_of(SurgeRuleTypes.begin(), SurgeRuleTypes.end(), [&strLine](const std::string& type){return startsWith(strLine, type);}))
+                return false;
+        }
+        else
+        {
+            if(!std::any_of(Surge2RuleTypes.begin(), Surge2RuleTypes.end(), [&strLine](const std::string& type){return startsWith(strLine, type);}))
+                return false;
+        }
+    }
+
+    if(strFind(strLine, "//"))
+    {
+        strLine.erase(strLine.find("//"));
+        strLine = trimWhitespace(strLine);
+    }
+
+    if(surge_ver == -1 || surge_ver == -2)
+    {
+        if(startsWith(strLine, "IP-CIDR6"))
+            strLine.replace(0, 8, "IP6-CIDR");
+        strLine = transformRuleToCommon(temp, strLine, rule_group, true);
+    }
+    else
+    {
+        if(!startsWith(strLine, "AND") && !startsWith(strLine, "OR") && !startsWith(strLine, "NOT"))
+            strLine = transformRuleToCommon(temp, strLine, rule_group);
+    }
+    return true;
+}
+
+// Whether rulesetToSurge() emits the rules of the fetched ruleset x itself
+// rather than a reference to it or nothing.
+static bool surgeEmitsRulesetRules(const RulesetContent &x, int surge_ver, const std::string &remote_path_prefix)
+{
+    if(x.rule_path.empty())
+        return false;
+    if(surge_ver == -1 && x.rule_type == RULESET_QUANX && isLink(x.rule_path))
+        return false;
+    if(fileExist(x.rule_path))
+        return remote_path_prefix.empty() || !(surge_ver > 2 || surge_ver == -1 || surge_ver == -4);
+    if(isLink(x.rule_path))
+        return !(surge_ver > 2 || surge_ver == -4 || (surge_ver == -1 && !remote_path_prefix.empty()));
+    return false;
+}
+
 void rulesetToSurge(INIReader &base_rule, std::vector<RulesetContent> &ruleset_content_array, int surge_ver, bool overwrite_original_rules, const std::string &remote_path_prefix, RuleConversionStats *stats)
 {
     RuleConversionStats local_stats;
     warnNoResolveIgnoredForTarget(ruleset_content_array, "非 Clash");
-    string_array allRules;
-    std::string rule_group, rule_path, rule_path_typed, retrieved_rules, strLine;
-    std::stringstream strStrm;
+    std::pmr::vector<std::pmr::string> allRules(requestMemoryResource());
+    std::string rule_group, rule_path, rule_path_typed, strLine;
     const size_t max_allowed_rules = effectiveSettings().maxAllowedRules;
     size_t total_rules = 0;
+    std::optional<RuleCompactor> compactor = makeRuleCompactor();
 
     switch(surge_ver) //other version: -3 for Surfboard, -4 for Loon
     {
@@ -780,17 +942,41 @@ void rulesetToSurge(INIReader &base_rule, std::vector<RulesetContent> &ruleset_c
 
     const std::string rule_match_regex = "^(.*?,.*?)(,.*)(,.*)$";
 
-    string_view_array temp(4);
-    for(RulesetContent &x : ruleset_content_array)
+    const std::string target = "surge" + std::to_string(surge_ver);
+    const auto render = [surge_ver](const RulesetContent &x, const std::string &converted, RenderedRuleset &rendered)
+    {
+        std::string strLine;
+        string_view_array temp(requestMemoryResource());
+        forEachRulesetLine(converted, getLineBreak(converted), [&](std::string_view line)
+        {
+            strLine.assign(line);
+            if(renderSurgeRule(strLine, surge_ver, x.rule_group, temp))
+            {
+                rendered.text += strLine;
+                rendered.text += '\n';
+                rendered.ends.push_back(rendered.text.size());
+            }
+            return true;
+        });
+    };
+    const auto fragments = renderRulesetsParallel(ruleset_content_array, target, [&](const RulesetContent &x)
+    {
+        return surgeEmitsRulesetRules(x, surge_ver, remote_path_prefix);
+    }, render);
+
+    string_view_array temp(requestMemoryResource());
+    for(size_t index = 0; index < ruleset_content_array.size(); index++)
     {
+        RulesetContent &x = ruleset_content_array[index];
         if(max_allowed_rules && total_rules > max_allowed_rules)
             break;
         rule_group = x.rule_group;
         rule_path = x.rule_path;
         rule_path_typed = x.rule_path_typed;
+        const std::string aggregate_query = x.options.aggregate_cidr ? "&aggregate=true" : "";
         if(rule_path.empty())
         {
-            strLine = x.rule_content.get().substr(2);
+            strLine = x.rule_content.get().text().substr(2);
             if(strLine == "MATCH")
                 strLine = "FINAL";
             if(surge_ver == -1 || surge_ver == -2)
@@ -803,6 +989,8 @@ void rulesetToSurge(INIReader &base_rule, std::vector<RulesetContent> &ruleset_c
                     strLine = transformRuleToCommon(temp, strLine, rule_group);
             }
             strLine = replaceAllDistinct(strLine, ",,", ",");
+            if(compactor && !compactor->admit(strLine))
+                continue;
             allRules.emplace_back(strLine);
             total_rules++;
             local_stats.add();
@@ -821,7 +1009,7 @@ void rulesetToSurge(INIReader &base_rule, std::vector<RulesetContent> &ruleset_c
             {
                 if(surge_ver > 2 && !remote_path_prefix.empty())
                 {
-                    strLine = "RULE-SET," + remote_path_prefix + "/getruleset?type=1&url=" + urlSafeBase64Encode(rule_path_typed) + "," + rule_group;
+                    strLine = "RULE-SET," + remote_path_prefix + "/getruleset?type=1&url=" + urlSafeBase64Encode(rule_path_typed) + aggregate_query + "," + rule_group;
                     if(x.update_interval)
                         strLine += ",update-interval=" + std::to_string(x.update_interval);
                     allRules.emplace_back(strLine);
@@ -830,7 +1018,7 @@ void rulesetToSurge(INIReader &base_rule, std::vector<RulesetContent> &ruleset_c
                 }
                 else if(surge_ver == -1 && !remote_path_prefix.empty())
                 {
-                    strLine = remote_path_prefix + "/getruleset?type=2&url=" + urlSafeBase64Encode(rule_path_typed) + "&group=" + urlSafeBase64Encode(rule_group);
+                    strLine = remote_path_prefix + "/getruleset?type=2&url=" + urlSafeBase64Encode(rule_path_typed) + aggregate_query + "&group=" + urlSafeBase64Encode(rule_group);
                     strLine += ", tag=" + rule_group + ", enabled=true";
                     base_rule.set("filter_remote", "{NONAME}", strLine);
                     local_stats.add();
@@ -838,7 +1026,7 @@ void rulesetToSurge(INIReader &base_rule, std::vector<RulesetContent> &ruleset_c
                 }
                 else if(surge_ver == -4 && !remote_path_prefix.empty())
                 {
-                    strLine = remote_path_prefix + "/getruleset?type=1&url=" + urlSafeBase64Encode(rule_path_typed) + "," + rule_group;
+                    strLine = remote_path_prefix + "/getruleset?type=1&url=" + urlSafeBase64Encode(rule_path_typed) + aggregate_query + "," + rule_group;
                     base_rule.set("Remote Rule", "{NONAME}", strLine);
                     local_stats.add();
                     continue;
@@ -851,7 +1039,7 @@ void rulesetToSurge(INIReader &base_rule, std::vector<RulesetContent> &ruleset_c
                     if(x.rule_type != RULESET_SURGE)
                     {
                         if(!remote_path_prefix.empty())
-                            strLine = "RULE-SET," + remote_path_prefix + "/getruleset?type=1&url=" + urlSafeBase64Encode(rule_path_typed) + "," + rule_group;
+                            strLine = "RULE-SET," + remote_path_prefix + "/getruleset?type=1&url=" + urlSafeBase64Encode(rule_path_typed) + aggregate_query + "," + rule_group;
                         else
                             continue;
                     }
@@ -867,7 +1055,7 @@ void rulesetToSurge(INIReader &base_rule, std::vector<RulesetContent> &ruleset_c
                 }
                 else if(surge_ver == -1 && !remote_path_prefix.empty())
                 {
-                    strLine = remote_path_prefix + "/getruleset?type=2&url=" + urlSafeBase64Encode(rule_path_typed) + "&group=" + urlSafeBase64Encode(rule_group);
+                    strLine = remote_path_prefix + "/getruleset?type=2&url=" + urlSafeBase64Encode(rule_path_typed) + aggregate_query + "&group=" + urlSafeBase64Encode(rule_group);
                     strLine += ", tag=" + rule_group + ", enabled=true";
                     base_rule.set("filter_remote", "{NONAME}", strLine);
                     local_stats.add();
@@ -883,84 +1071,42 @@ void rulesetToSurge(INIReader &base_rule, std::vector<RulesetContent> &ruleset_c
             }
             else
                 continue;
-            retrieved_rules = x.rule_content.get();
-            if(retrieved_rules.empty())
+            const RulesetBody &body = x.rule_content.get();
+            if(body.text().empty())
             {
                 writeLog(LOG_LEVEL_WARNING, "获取规则集失败或规则集为空：'" + x.rule_path + "'。");
                 continue;
             }
 
-            retrieved_rules = convertRuleset(retrieved_rules, x.rule_type);
-            char delimiter = getLineBreak(retrieved_rules);
-
-            strStrm.clear();
-            strStrm<<retrieved_rules;
-            std::string::size_type lineSize;
-            while(getline(strStrm, strLine, delimiter))
+            const auto fragment = fragments[index] ? fragments[index] : renderRulesetCached(x, body, target, render);
+            size_t count = 0;
+            if(compactor)
             {
-                if(max_allowed_rules && total_rules > max_allowed_rules)
-                    break;
-                strLine = trimWhitespace(strLine, true, true);
-                lineSize = strLine.size();
-                if(!lineSize || strLine[0] == ';' || strLine[0] == '#' || (lineSize >= 2 && strLine[0] == '/' && strLine[1] == '/')) //empty lines and comments are ignored
-                    continue;
-
-                /// remove unsupported types
-                switch(surge_ver)
+                count = emitCompactedRules(*fragment, 0, *compactor, max_allowed_rules, total_rules, [&](std::string_view line)
                 {
-                case -2:
-                    if(startsWith(strLine, "IP-CIDR6"))
-                        continue;
-                    [[fallthrough]];
-                case -1:
-                    if(!std::any_of(QuanXRuleTypes.begin(), QuanXRuleTypes.end(), [strLine](const std::string& type){return startsWith(strLine, type);}))
-                        continue;
-                    break;
-                case -3:
-                    if(!std::any_of(SurfRuleTypes.begin(), SurfRuleTypes.end(), [strLine](const std::string& type){return startsWith(strLine, type);}))
-                        continue;
-                    break;
-                default:
-                    if(surge_ver > 2)
-                    {
-                        if(!std::any_of(SurgeRuleTypes.begin(), SurgeRuleTypes.end(), [strLine](const std::string& type){return startsWith(strLine, type);}))
-                            continue;
-                    }
-                    else
-                    {
-                        if(!std::any_of(Surge2RuleTypes.begin(), Surge2RuleTypes.end(), [strLine](const std::string& type){return startsWith(strLine, type);}))
-                            continue;
-                    }
-                }
-
-                if(strFind(strLine, "//"))
-                {
-                    strLine.erase(strLine.find("//"));
-                    strLine = trimWhitespace(strLine);
-                }
-
-                if(surge_ver == -1 || surge_ver == -2)
-                {
-                    if(startsWith(strLine, "IP-CIDR6"))
-                        strLine.replace(0, 8, "IP6-CIDR");
-                    strLine = transformRuleToCommon(temp, strLine, rule_group, true);
-                }
-                else
+                    allRules.emplace_back(line.substr(0, line.size() - 1));
+                });
+            }
+            else
+            {
+                const std::string_view rendered = renderedRules(*fragment, max_allowed_rules, total_rules, count);
+                size_t begin = 0;
+                for(size_t i = 0; i < count; i++)
                 {
-                    if(!startsWith(strLine, "AND") && !startsWith(strLine, "OR") && !startsWith(strLine, "NOT"))
-                        strLine = transformRuleToCommon(temp, strLine, rule_group);
+                    allRules.emplace_back(rendered.substr(begin, fragment->ends[i] - begin - 1));
+                    begin = fragment->ends[i];
                 }
-                allRules.emplace_back(strLine);
-                total_rules++;
-                local_stats.add();
             }
+            total_rules += count;
+            local_stats.add(count);
         }
     }
 
-    for(std::string &x : allRules)
+    for(const std::pmr::string &x : allRules)
     {
-        base_rule.set("{NONAME}", x);
+        base_rule.set("{NONAME}", std::string(x));
     }
+    logRuleCompaction(compactor);
     if(stats)
         stats->add(local_stats.rules);
 }
@@ -997,7 +1143,7 @@ bool parseSingBoxRuleInteger(const std::string &value, uint32_t maximum,
            parsed <= maximum;
 }
 
-bool appendSingBoxRule(std::vector<std::string_view> &args,
+bool appendSingBoxRule(string_view_array &args,
                        std::map<std::string, SingBoxRuleBucket> &buckets,
                        std::set<std::string> &geosite_codes,
                        std::set<std::string> &geoip_codes,
@@ -1186,8 +1332,7 @@ void rulesetToSingBox(rapidjson::Document &base_rule, std::vector<RulesetContent
     RuleConversionStats local_stats;
     warnNoResolveIgnoredForTarget(ruleset_content_array, "sing-box");
     using namespace rapidjson_ext;
-    std::string rule_group, retrieved_rules, strLine, final;
-    std::stringstream strStrm;
+    std::string rule_group, strLine, final;
     const Settings &settings = effectiveSettings();
     size_t total_rules = 0;
     auto &allocator = base_rule.GetAllocator();
@@ -1228,22 +1373,22 @@ void rulesetToSingBox(rapidjson::Document &base_rule, std::vector<RulesetContent
     // auto dns_object = buildObject(allocator, "protocol", "dns", "outbound", "dns-out");
     // rules.PushBack(dns_object, allocator);
 
-    std::vector<std::string_view> temp(4);
+    string_view_array temp(requestMemoryResource());
     std::set<std::string> geosite_codes, geoip_codes;
     for(RulesetContent &x : ruleset_content_array)
     {
         if(settings.maxAllowedRules && total_rules > settings.maxAllowedRules)
             break;
         rule_group = x.rule_group;
-        retrieved_rules = x.rule_content.get();
-        if(retrieved_rules.empty())
+        const RulesetBody &body = x.rule_content.get();
+        if(body.text().empty())
         {
             writeLog(LOG_LEVEL_WARNING, "获取规则集失败或规则集为空：'" + x.rule_path + "'。");
             continue;
         }
-        if(startsWith(retrieved_rules, "[]"))
+        if(startsWith(body.text(), "[]"))
         {
-            strLine = retrieved_rules.substr(2);
+            strLine = body.text().substr(2);
             std::map<std::string, SingBoxRuleBucket> buckets;
             if (appendSingBoxRule(temp, buckets, geosite_codes, geoip_codes,
                                   strLine, final, rule_group)) {
@@ -1253,20 +1398,18 @@ void rulesetToSingBox(rapidjson::Document &base_rule, std::vector<RulesetContent
             }
             continue;
         }
-        retrieved_rules = convertRuleset(retrieved_rules, x.rule_type);
-        char delimiter = getLineBreak(retrieved_rules);
-
-        strStrm.clear();
-        strStrm<<retrieved_rules;
+        const RulesetText retrieved_rules = convertRuleset(body, x.rule_type, x.options.aggregate_cidr);
+        char delimiter = getLineBreak(*retrieved_rules);
+        std::string_view remaining = *retrieved_rules, line;
 
         std::string::size_type lineSize;
         std::map<std::string, SingBoxRuleBucket> buckets;
 
-        while(getline(strStrm, strLine, delimiter))
+        while(nextRulesetLine(remaining, delimiter, line))
         {
             if(settings.maxAllowedRules && total_rules > settings.maxAllowedRules)
                 break;
-            strLine = trimWhitespace(strLine, true, true); //remove whitespaces
+            strLine = trimWhitespace(std::string(line), true, true); //remove whitespaces
             lineSize = strLine.size();
             if(!lineSize || strLine[0] == ';' || strLine[0] == '#' || (lineSize >= 2 && strLine[0] == '/' && strLine[1] == '/')) //empty lines and comments are ignored
                 continue;
@@ -31,7 +31,7 @@ struct RulesetContent
     std::string rule_path;
     std::string rule_path_typed;
     ruleset_type rule_type = RULESET_SURGE;
-    std::shared_future<std::string> rule_content;
+    std::shared_future<RulesetBody> rule_content;
     int update_interval = 0;
     RulesetOptions options;
     RulesetDelivery delivery = RulesetDelivery::ServerFetched;
@@ -58,9 +58,12 @@ struct StashRuleConversionStats
     size_t unsupported_sources = 0;
 };
 
-std::string convertRuleset(const std::string &content, int type);
+RulesetText convertRuleset(const RulesetBody &body, int type,
+                           bool aggregate_cidr = false);
 size_t rulesetConversionCacheMaxEntries();
 size_t rulesetConversionCacheMaxBytes();
+size_t renderedRulesetCacheMaxEntries();
+size_t renderedRulesetCacheMaxBytes();
 std::string appendClashRuleTarget(const std::string &rule, const std::string &target, bool no_resolve_only = false);
 void rulesetToClash(YAML::Node &base_rule, std::vector<RulesetContent> &ruleset_content_array, bool overwrite_original_rules, bool new_field_name, RuleConversionStats *stats = nullptr);
 std::string rulesetToClashStr(YAML::Node &base_rule, std::vector<RulesetContent> &ruleset_content_array, bool overwrite_original_rules, bool new_field_name, RuleConversionStats *stats = nullptr);
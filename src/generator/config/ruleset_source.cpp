@@ -0,0 +1,507 @@
+#include "ruleset_source.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "config/ruleset.h"
+
+namespace {
+
+constexpr std::string_view kPayloadMarker = "payload:";
+constexpr std::string_view kNoResolve = ",no-resolve";
+
+// PCRE2's \s without PCRE2_UCP, which is what the former patterns used.
+bool isSpace(char ch) { return ch == ' ' || (ch >= '\t' && ch <= '\r'); }
+
+size_t firstNonSpace(std::string_view text, size_t pos = 0) {
+  while (pos < text.size() && isSpace(text[pos]))
+    pos++;
+  return pos;
+}
+
+// The former patterns were compiled with PCRE2_UTF, so a body that is not
+// valid UTF-8 never matched anything and came back unchanged.
+bool isValidUtf8(std::string_view text) {
+  size_t i = 0;
+  while (i < text.size()) {
+    const auto lead = static_cast<unsigned char>(text[i]);
+    size_t length = 0;
+    uint32_t code = 0;
+    if (lead < 0x80) {
+      i++;
+      continue;
+    } else if (lead >= 0xc2 && lead <= 0xdf) {
+      length = 2;
+      code = lead & 0x1f;
+    } else if (lead >= 0xe0 && lead <= 0xef) {
+      length = 3;
+      code = lead & 0x0f;
+    } else if (lead >= 0xf0 && lead <= 0xf4) {
+      length = 4;
+      code = lead & 0x07;
+    } else {
+      return false;
+    }
+    if (i + length > text.size())
+      return false;
+    for (size_t j = 1; j < length; j++) {
+      const auto next = static_cast<unsigned char>(text[i + j]);
+      if ((next & 0xc0) != 0x80)
+        return false;
+      code = (code << 6) | (next & 0x3f);
+    }
+    if ((length == 3 && code < 0x800) || (length == 4 && code < 0x10000) ||
+        (code >= 0xd800 && code <= 0xdfff) || code > 0x10ffff)
+      return false;
+    i += length;
+  }
+  return true;
+}
+
+// Reads `text` one line at a time, without the '\n'. A text ending in '\n'
+// has a final empty line, as splitting on '\n' gives. With `skip_markers`,
+// lines that are exactly `payload:` (optionally with '\r') and end in '\n'
+// are left out.
+class LineReader {
+public:
+  LineReader(std::string_view text, bool skip_markers)
+      : text_(text), skip_markers_(skip_markers) {}
+
+  bool next(std::string_view &line, bool &last) {
+    while (!done_) {
+      const void *newline =
+          pos_ < text_.size()
+              ? std::memchr(text_.data() + pos_, '\n', text_.size() - pos_)
+              : nullptr;
+      if (!newline) {
+        line = text_.substr(pos_);
+        last = done_ = true;
+        return true;
+      }
+      const size_t end = static_cast<const char *>(newline) - text_.data();
+      line = text_.substr(pos_, end - pos_);
+      pos_ = end + 1;
+      if (skip_markers_ && line.starts_with(kPayloadMarker) &&
+          (line.size() == kPayloadMarker.size() ||
+           (line.size() == kPayloadMarker.size() + 1 && line.back() == '\r')))
+        continue;
+      last = false;
+      return true;
+    }
+    return false;
+  }
+
+private:
+  std::string_view text_;
+  bool skip_markers_;
+  size_t pos_ = 0;
+  bool done_ = false;
+};
+
+// Calls on_marker(begin, end) for each `payload:\r?\n` in `content`, with
+// `end` just past the '\n'. Stops early when it returns false.
+template <class OnMarker>
+void forEachPayloadMarker(std::string_view content, OnMarker &&on_marker) {
+  for (size_t pos = content.find(kPayloadMarker); pos != std::string::npos;
+       pos = content.find(kPayloadMarker, pos + 1)) {
+    size_t end = pos + kPayloadMarker.size();
+    if (end < content.size() && content[end] == '\r')
+      end++;
+    if (end < content.size() && content[end] == '\n' &&
+        !on_marker(pos, end + 1))
+      return;
+  }
+}
+
+bool atLineStart(std::string_view content, size_t pos) {
+  return pos == 0 || content[pos - 1] == '\n';
+}
+
+bool isIPv4Address(std::string_view text) {
+  for (int octet = 0; octet < 4; octet++) {
+    if (octet) {
+      if (text.empty() || text[0] != '.')
+        return false;
+      text.remove_prefix(1);
+    }
+    size_t digits = 0;
+    while (digits < 3 && digits < text.size() && text[digits] >= '0' &&
+           text[digits] <= '9')
+      digits++;
+    if (!digits || (digits == 3 && (text[0] - '0') * 100 +
+                                           (text[1] - '0') * 10 +
+                                           (text[2] - '0') >
+                                       255))
+      return false;
+    text.remove_prefix(digits);
+  }
+  return text.empty();
+}
+
+// Classifies one unwrapped payload entry: IP-CIDR/IP-CIDR6 for anything with
+// a '/', DOMAIN-SUFFIX for `.x` and `+.x`, DOMAIN-KEYWORD when such a suffix
+// ends in `.*`, DOMAIN otherwise. Comments and empty lines are copied as they
+// are.
+void appendPayloadRule(std::string &output, std::string_view line) {
+  const size_t first = line.find_first_not_of(' ');
+  if (first != std::string_view::npos)
+    line = line.substr(first, line.find_last_not_of(' ') - first + 1);
+  if (!line.empty() && line.back() == '\r')
+    line.remove_suffix(1);
+  const size_t comment = line.find("//");
+  if (comment != std::string_view::npos) {
+    const size_t end = line.substr(0, comment).find_last_not_of(" \t\f\v\n\r");
+    line = line.substr(0, end == std::string_view::npos ? 0 : end + 1);
+  }
+
+  if (!line.empty() && line[0] != ';' && line[0] != '#') {
+    const size_t slash = line.find('/');
+    if (slash != std::string_view::npos) {
+      output += isIPv4Address(line.substr(0, slash)) ? "IP-CIDR," : "IP-CIDR6,";
+    } else if (line[0] == '.' || line.starts_with("+.")) {
+      bool keyword = false;
+      while (line.ends_with(".*")) {
+        keyword = true;
+        line.remove_suffix(2);
+      }
+      output += keyword ? "DOMAIN-KEYWORD," : "DOMAIN-SUFFIX,";
+      line.remove_prefix(
+          std::min<size_t>(line.size(), !line.empty() && line[0] == '.' ? 1 : 2));
+    } else {
+      output += "DOMAIN,";
+    }
+  }
+  output += line;
+  output += '\n';
+}
+
+// Undoes the Clash `- item` list line by line. A line whose first non-space
+// character is a dash followed by whitespace becomes the rest of the item,
+// with one pair of matching quotes removed, and swallows the blank lines in
+// front of it. When nothing follows the dash on its line, the item is the
+// next non-blank line. The result is reported as the pieces between '\n's;
+// a list starting on the first line gets an empty first piece.
+template <class OnPiece>
+void unwrapPayloadList(LineReader &lines, OnPiece &&on_piece) {
+  std::vector<std::string_view> blanks;
+  bool first = true, region_at_start = false, after_dash = false;
+  const auto item = [&](std::string_view value) {
+    if (region_at_start)
+      on_piece(std::string_view());
+    if (value.size() >= 2 && (value[0] == '\'' || value[0] == '"') &&
+        value.back() == value[0])
+      value = value.substr(1, value.size() - 2);
+    on_piece(value);
+    blanks.clear();
+    after_dash = false;
+  };
+
+  std::string_view line;
+  bool last = false;
+  while (lines.next(line, last)) {
+    const bool at_start = first;
+    first = false;
+    const size_t start = firstNonSpace(line);
+    if (after_dash) {
+      if (start < line.size())
+        item(line.substr(start));
+      continue;
+    }
+    if (blanks.empty())
+      region_at_start = at_start;
+    if (start == line.size()) {
+      blanks.push_back(line);
+      continue;
+    }
+    if (line[start] == '-') {
+      const size_t value = start + 1;
+      // The dash needs whitespace after it; a line break counts.
+      if (value < line.size() ? isSpace(line[value]) : !last) {
+        const size_t begin = firstNonSpace(line, value);
+        if (begin < line.size())
+          item(line.substr(begin));
+        else
+          after_dash = true;
+        continue;
+      }
+    }
+    for (std::string_view blank : blanks)
+      on_piece(blank);
+    blanks.clear();
+    on_piece(line);
+  }
+  if (after_dash) {
+    item(std::string_view());
+  } else {
+    for (std::string_view blank : blanks)
+      on_piece(blank);
+  }
+}
+
+std::string convertClashPayload(std::string_view content, int type) {
+  bool own_lines = true;
+  forEachPayloadMarker(content, [&](size_t begin, size_t) {
+    own_lines = atLineStart(content, begin);
+    return own_lines;
+  });
+  // Every marker normally fills a line of its own and is simply skipped. A
+  // marker inside a line joins two lines, so those rare bodies are copied
+  // without the markers first.
+  std::string joined;
+  if (!own_lines) {
+    joined.reserve(content.size());
+    size_t copied = 0;
+    forEachPayloadMarker(content, [&](size_t begin, size_t end) {
+      joined.append(content.substr(copied, begin - copied));
+      copied = end;
+      return true;
+    });
+    joined.append(content.substr(copied));
+  }
+  LineReader lines(own_lines ? content : std::string_view(joined), own_lines);
+
+  std::string output;
+  output.reserve(content.size() + content.size() / 2);
+  if (type == RULESET_CLASH_CLASSICAL) {
+    bool first = true;
+    unwrapPayloadList(lines, [&](std::string_view piece) {
+      if (!first)
+        output += '\n';
+      first = false;
+      output += piece;
+    });
+    return output;
+  }
+
+  // Lines as std::getline() reads them from the joined pieces: nothing after
+  // a trailing '\n', and '\r' as the separator when there is no '\n' at all.
+  std::string_view held;
+  size_t pieces = 0;
+  unwrapPayloadList(lines, [&](std::string_view piece) {
+    if (pieces++)
+      appendPayloadRule(output, held);
+    held = piece;
+  });
+  if (pieces == 1) {
+    while (!held.empty()) {
+      const size_t end = held.find('\r');
+      appendPayloadRule(output, held.substr(0, end));
+      if (end == std::string_view::npos)
+        break;
+      held.remove_prefix(end + 1);
+    }
+  } else if (!held.empty()) {
+    appendPayloadRule(output, held);
+  }
+  return output;
+}
+
+bool hasPayloadHeader(std::string_view content) {
+  bool found = false;
+  forEachPayloadMarker(content, [&](size_t begin, size_t) {
+    found = atLineStart(content, begin);
+    return !found;
+  });
+  return found;
+}
+
+// Matches an ASCII keyword case-insensitively at `pos` the way PCRE2 does in
+// UTF mode, where 'k' and 's' also match KELVIN SIGN and LONG S. Returns the
+// end of the match or npos.
+size_t matchCaseless(std::string_view text, size_t pos,
+                     std::string_view keyword) {
+  for (const char ch : keyword) {
+    if (pos >= text.size())
+      return std::string_view::npos;
+    const char lower = text[pos] >= 'A' && text[pos] <= 'Z'
+                           ? static_cast<char>(text[pos] - 'A' + 'a')
+                           : text[pos];
+    if (lower == ch) {
+      pos++;
+    } else if (ch == 's' && text.substr(pos, 2) == "\xC5\xBF") {
+      pos += 2;
+    } else if (ch == 'k' && text.substr(pos, 3) == "\xE2\x84\xAA") {
+      pos += 3;
+    } else {
+      return std::string_view::npos;
+    }
+  }
+  return pos;
+}
+
+// A QuanX line after the leading `host` / `ip6-cidr` type has been renamed:
+// the replacement type, then the rest of the original line.
+struct QuanXLine {
+  std::string_view prefix;
+  std::string_view rest;
+  bool last = false;
+};
+
+QuanXLine renameQuanXType(std::string_view line, bool last) {
+  size_t end = matchCaseless(line, 0, "host");
+  if (end != std::string_view::npos)
+    return {"DOMAIN", line.substr(end), last};
+  end = matchCaseless(line, 0, "ip6-cidr");
+  if (end != std::string_view::npos)
+    return {"IP-CIDR6", line.substr(end), last};
+  return {{}, line, last};
+}
+
+// End of a leading `TYPE,` in line.rest for the types whose policy is
+// dropped, or npos.
+size_t matchQuanXRuleType(const QuanXLine &line) {
+  const std::string_view rest = line.rest;
+  size_t pos = 0;
+  bool domain = line.prefix == "DOMAIN";
+  if (line.prefix.empty()) {
+    if ((pos = matchCaseless(rest, 0, "domain")) != std::string_view::npos) {
+      domain = true;
+    } else if ((pos = matchCaseless(rest, 0, "ip-cidr")) !=
+               std::string_view::npos) {
+      if (pos < rest.size() && rest[pos] == '6')
+        pos++;
+    } else if ((pos = matchCaseless(rest, 0, "user-agent")) ==
+               std::string_view::npos) {
+      return std::string_view::npos;
+    }
+  }
+  if (domain && pos < rest.size() && rest[pos] == '-') {
+    size_t end = matchCaseless(rest, pos + 1, "suffix");
+    if (end == std::string_view::npos)
+      end = matchCaseless(rest, pos + 1, "keyword");
+    if (end != std::string_view::npos)
+      pos = end;
+  }
+  return pos < rest.size() && rest[pos] == ',' ? pos + 1
+                                               : std::string_view::npos;
+}
+
+// First ',' of the non-space run at `pos` that does not start `,no-resolve`.
+size_t findPolicyComma(std::string_view text, size_t pos) {
+  for (; pos < text.size() && !isSpace(text[pos]); pos++)
+    if (text[pos] == ',' && text.substr(pos + 1, kNoResolve.size() - 1) !=
+                                kNoResolve.substr(1))
+      return pos;
+  return std::string_view::npos;
+}
+
+void appendLine(std::string &output, const QuanXLine &line) {
+  output += line.prefix;
+  output += line.rest;
+  if (!line.last)
+    output += '\n';
+}
+
+// Writes `TYPE,pattern[,no-resolve]`: the type of `head` (up to type_end)
+// upper-cased, the pattern from `body` (rest[begin, comma), after the renamed
+// type when the pattern starts a later line) and the no-resolve flag when
+// body's line ends with one after the comma.
+void appendRuleWithoutPolicy(std::string &output, const QuanXLine &head,
+                             size_t type_end, const QuanXLine &body,
+                             std::string_view body_prefix, size_t begin,
+                             size_t comma) {
+  output += head.prefix;
+  const std::string_view type = head.rest.substr(0, type_end);
+  for (size_t i = 0; i < type.size(); i++) {
+    if (type[i] >= 'a' && type[i] <= 'z') {
+      output += static_cast<char>(type[i] - 'a' + 'A');
+    } else if (type.substr(i, 2) == "\xC5\xBF") {
+      // PCRE2's \U turns LONG S into its other case, a plain 's'.
+      output += 's';
+      i++;
+    } else {
+      output += type[i];
+    }
+  }
+  output += body_prefix;
+  output += body.rest.substr(begin, comma - begin);
+  if (body.rest.size() >= comma + 1 + kNoResolve.size() &&
+      body.rest.ends_with(kNoResolve))
+    output += kNoResolve;
+  if (!body.last)
+    output += '\n';
+}
+
+// Renames `host*` to `DOMAIN*` and `ip6-cidr` to `IP-CIDR6` at line starts,
+// then turns `TYPE, pattern,policy[,no-resolve]` into
+// `TYPE,pattern[,no-resolve]` for DOMAIN(-SUFFIX/-KEYWORD), IP-CIDR(6) and
+// USER-AGENT. When only whitespace follows `TYPE,`, the pattern is taken from
+// the next non-blank line, which then joins this one.
+std::string convertQuanXList(std::string_view content) {
+  std::string output;
+  output.reserve(content.size());
+  LineReader lines(content, false);
+
+  QuanXLine head;
+  size_t head_type_end = 0;
+  bool waiting = false;
+  std::vector<QuanXLine> blanks;
+
+  std::string_view raw;
+  bool last = false;
+  while (lines.next(raw, last)) {
+    const QuanXLine line = renameQuanXType(raw, last);
+    if (waiting) {
+      const size_t begin = line.prefix.empty() ? firstNonSpace(line.rest) : 0;
+      if (line.prefix.empty() && begin == line.rest.size()) {
+        blanks.push_back(line);
+        continue;
+      }
+      waiting = false;
+      const size_t comma = findPolicyComma(line.rest, begin);
+      if (comma != std::string_view::npos) {
+        appendRuleWithoutPolicy(output, head, head_type_end, line,
+                                line.prefix, begin, comma);
+        blanks.clear();
+        continue;
+      }
+      appendLine(output, head);
+      for (const QuanXLine &blank : blanks)
+        appendLine(output, blank);
+      blanks.clear();
+    }
+
+    const size_t type_end = matchQuanXRuleType(line);
+    if (type_end == std::string_view::npos) {
+      appendLine(output, line);
+      continue;
+    }
+    const size_t begin = firstNonSpace(line.rest, type_end);
+    if (begin == line.rest.size()) {
+      if (line.last) {
+        appendLine(output, line);
+      } else {
+        head = line;
+        head_type_end = type_end;
+        waiting = true;
+      }
+      continue;
+    }
+    const size_t comma = findPolicyComma(line.rest, begin);
+    if (comma == std::string_view::npos)
+      appendLine(output, line);
+    else
+      appendRuleWithoutPolicy(output, line, type_end, line, {}, begin, comma);
+  }
+  if (waiting) {
+    appendLine(output, head);
+    for (const QuanXLine &blank : blanks)
+      appendLine(output, blank);
+  }
+  return output;
+}
+
+} // namespace
+
+std::string convertRulesetSource(std::string_view content, int type) {
+  /// Target: Surge type,pattern[,flag]
+  /// Source: QuanX type,pattern[,group]
+  ///         Clash payload:\n  - 'ipcidr/domain/classic(Surge-like)'
+  if (type == RULESET_SURGE || !isValidUtf8(content))
+    return std::string(content);
+  if (hasPayloadHeader(content))
+    return convertClashPayload(content, type);
+  return convertQuanXList(content);
+}
@@ -0,0 +1,15 @@
+#ifndef RULESET_SOURCE_H_INCLUDED
+#define RULESET_SOURCE_H_INCLUDED
+
+#include <string>
+#include <string_view>
+
+// Converts a downloaded ruleset body of the given ruleset_type into Surge-style
+// `TYPE,pattern[,flag]` lines. Clash payloads (domain, ipcidr and classical)
+// and QuanX lists are converted by one pass of a line scanner straight into
+// the output. The result is byte for byte what the earlier regex pipeline
+// produced, including how it treated blank lines, comments and CRLF bodies.
+// Surge bodies are returned unchanged.
+std::string convertRulesetSource(std::string_view content, int type);
+
+#endif // RULESET_SOURCE_H_INCLUDED
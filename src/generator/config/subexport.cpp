@@ -1,10 +1,12 @@
 #include <algorithm>
+#include <bit>
 #include <cctype>
 #include <climits>
 #include <cmath>
 #include <functional>
 #include <iostream>
 #include <limits>
+#include <memory_resource>
 #include <numeric>
 #include <string_view>
 #include <unordered_map>
@@ -13,11 +15,13 @@
 #include "config/regmatch.h"
 #include "external_rules.h"
 #include "generator/config/clash_proxy.h"
+#include "generator/config/group_membership.h"
 #include "generator/config/subexport.h"
 #include "generator/template/templates.h"
 #include "handler/settings.h"
 #include "handler/settings_view.h"
 #include "nodemanip.h"
+#include "remark_set.h"
 #include "parser/config/proxy.h"
 #include "parser/mieru_uri.h"
 #include "ruleconvert.h"
@@ -30,6 +34,7 @@
 #include "utils/rapidjson_extra.h"
 #include "utils/redact.h"
 #include "utils/regexp.h"
+#include "utils/request_arena.h"
 #include "utils/stl_extra.h"
 #include "utils/time_compat.h"
 #include "utils/urlencode.h"
@@ -899,35 +904,10 @@ static YAML::Node providersMatchingGroupId(
   return use_node;
 }
 
-using RemarkSet = std::unordered_set<std::string_view>;
-
-void processRemark(std::string &remark, const RemarkSet &used_remarks,
-                   bool proc_comma = true) {
-  // Replace every '=' with '-' in the remark string to avoid parse errors from
-  // the clients.
-  //     Surge is tested to yield an error when handling '=' in the remark
-  //     string, not sure if other clients have the same problem.
-  std::replace(remark.begin(), remark.end(), '=', '-');
-
-  if (proc_comma) {
-    if (remark.find(',') != std::string::npos) {
-      remark.insert(0, "\"");
-      remark.append("\"");
-    }
-  }
-  std::string tempRemark = remark;
-  int cnt = 2;
-  while (used_remarks.find(tempRemark) != used_remarks.end()) {
-    tempRemark = remark + " " + std::to_string(cnt);
-    cnt++;
-  }
-  remark = tempRemark;
-}
-
-void groupGenerate(const std::string &rule, std::vector<Proxy> &nodelist,
+void groupGenerate(const std::string &rule, GroupMembership &membership,
                    string_array &filtered_nodelist, bool add_direct,
                    extra_settings &ext) {
-  std::string real_rule;
+  const std::vector<Proxy> &nodelist = membership.nodes();
   if (startsWith(rule, "[]") && add_direct) {
     filtered_nodelist.emplace_back(rule.substr(2));
   }
@@ -938,7 +918,7 @@ void groupGenerate(const std::string &rule, std::vector<Proxy> &nodelist,
         [&](qjs::Context &ctx) {
           std::string script = fileGet(rule.substr(7), true);
           try {
-            ctx.eval(script);
+            script_eval_cached(ctx, script);
             auto filter =
                 (std::function<std::string(const std::vector<Proxy> &)>)
                     ctx.eval("filter");
@@ -954,11 +934,13 @@ void groupGenerate(const std::string &rule, std::vector<Proxy> &nodelist,
   else {
     std::unordered_set<std::string> seen(filtered_nodelist.begin(),
                                          filtered_nodelist.end());
-    for (Proxy &x : nodelist) {
-      if (applyMatcher(rule, real_rule, x) &&
-          (real_rule.empty() || regFind(x.Remark, real_rule)) &&
-          seen.insert(x.Remark).second)
-        filtered_nodelist.emplace_back(x.Remark);
+    const GroupMembership::Bits &members = membership.members(rule);
+    for (size_t word = 0; word < members.size(); word++) {
+      for (uint64_t bits = members[word]; bits; bits &= bits - 1) {
+        const Proxy &x = nodelist[word * 64 + std::countr_zero(bits)];
+        if (seen.insert(x.Remark).second)
+          filtered_nodelist.emplace_back(x.Remark);
+      }
     }
   }
 }
@@ -968,7 +950,10 @@ void proxyToClash(std::vector<Proxy> &nodes, YAML::Node &yamlnode,
                   extra_settings &ext) {
   YAML::Node proxies, original_groups;
   std::vector<Proxy> nodelist;
-  RemarkSet used_remarks;
+  // Emitted nodes are moved here rather than copied, and used_remarks keeps
+  // views into them; reserving up front keeps those views valid.
+  nodelist.reserve(nodes.size());
+  RemarkSet used_remarks(requestMemoryResource());
   used_remarks.reserve(nodes.size());
   /// proxies style
 
@@ -1035,8 +1020,8 @@ void proxyToClash(std::vector<Proxy> &nodes, YAML::Node &yamlnode,
       // Preserve the existing compact representation for Mihomo-parsed nodes.
       singleproxy.SetStyle(YAML::EmitterStyle::Flow);
       proxies.push_back(singleproxy);
-      nodelist.emplace_back(x);
-      used_remarks.emplace(x.Remark);
+      nodelist.emplace_back(std::move(x));
+      used_remarks.emplace(nodelist.back().Remark);
 
       continue;
     }
@@ -1572,8 +1557,8 @@ void proxyToClash(std::vector<Proxy> &nodes, YAML::Node &yamlnode,
     else
       singleproxy.SetStyle(YAML::EmitterStyle::Flow);
     proxies.push_back(singleproxy);
-    used_remarks.emplace(x.Remark);
-    nodelist.emplace_back(x);
+    nodelist.emplace_back(std::move(x));
+    used_remarks.emplace(nodelist.back().Remark);
   }
 
   if (proxy_compact)
@@ -1662,6 +1647,7 @@ void proxyToClash(std::vector<Proxy> &nodes, YAML::Node &yamlnode,
                  " 个 proxy provider。");
   }
 
+  GroupMembership membership(nodelist, extra_proxy_group, ext.parallel_for);
   for (const ProxyGroupConfig &x : extra_proxy_group) {
     YAML::Node singlegroup;
     string_array filtered_nodelist;
@@ -1699,7 +1685,7 @@ void proxyToClash(std::vector<Proxy> &nodes, YAML::Node &yamlnode,
       singlegroup["disable-udp"] = x.DisableUdp.get();
 
     for (const auto &y : x.Proxies)
-      groupGenerate(y, nodelist, filtered_nodelist, true, ext);
+      groupGenerate(y, membership, filtered_nodelist, true, ext);
 
     // 对于 proxy-provider 模式的处理
     if (ext.use_proxy_provider && !ext.providers.empty()) {
@@ -3156,7 +3142,7 @@ static std::string proxyToStashImpl(
   }
   std::vector<Proxy> emitted_nodes;
   emitted_nodes.reserve(nodes.size());
-  RemarkSet used_remarks;
+  RemarkSet used_remarks(requestMemoryResource());
   used_remarks.reserve(nodes.size() + base_remark_storage.size() +
                        built_in_policy_names.size());
   for (const std::string &name : built_in_policy_names)
@@ -3324,6 +3310,8 @@ static std::string proxyToStashImpl(
     }
     root["proxy-groups"] = base_groups;
   }
+  GroupMembership membership(emitted_nodes, extra_proxy_group,
+                             ext.parallel_for);
   for (const ProxyGroupConfig &group : extra_proxy_group) {
     if (group.Type == ProxyGroupType::Smart ||
         group.Type == ProxyGroupType::SSID) {
@@ -3388,7 +3376,7 @@ static std::string proxyToStashImpl(
     }
     string_array local_members;
     for (const std::string &rule : group.Proxies)
-      groupGenerate(rule, emitted_nodes, local_members, true, ext);
+      groupGenerate(rule, membership, local_members, true, ext);
     if (local_members.empty() && remote.providers.empty())
       local_members.emplace_back("DIRECT");
     if (!local_members.empty())
@@ -3750,8 +3738,9 @@ std::string proxyToSurge(std::vector<Proxy> &nodes,
   INIReader ini;
   std::string output_nodelist;
   std::vector<Proxy> nodelist;
+  nodelist.reserve(nodes.size());
   unsigned short local_port = 1080;
-  RemarkSet used_remarks;
+  RemarkSet used_remarks(requestMemoryResource());
   used_remarks.reserve(nodes.size());
   const bool surfboard = surge_ver == -3;
   TargetGenerationStats &generation_stats = ext.target_generation_stats;
@@ -4143,13 +4132,14 @@ std::string proxyToSurge(std::vector<Proxy> &nodes,
       proxy += ", udp-relay=" + udp.get_str();
     if (underlying_proxy != "")
       proxy += ", underlying-proxy=" + underlying_proxy;
-    if (ext.nodelist)
+    if (ext.nodelist) {
       output_nodelist += x.Remark + " = " + proxy + "\n";
-    else {
+      used_remarks.emplace(x.Remark);
+    } else {
       ini.set("{NONAME}", x.Remark + " = " + proxy);
-      nodelist.emplace_back(x);
+      nodelist.emplace_back(std::move(x));
+      used_remarks.emplace(nodelist.back().Remark);
     }
-    used_remarks.emplace(x.Remark);
     generation_stats.emitted_nodes++;
   }
 
@@ -4159,6 +4149,7 @@ std::string proxyToSurge(std::vector<Proxy> &nodes,
   ini.set_current_section("Proxy Group");
   ini.erase_section();
   size_t surfboard_test_url_fallbacks = 0;
+  GroupMembership membership(nodelist, extra_proxy_group, ext.parallel_for);
   for (const ProxyGroupConfig &x : extra_proxy_group) {
     string_array filtered_nodelist;
     std::string group;
@@ -4190,7 +4181,7 @@ std::string proxyToSurge(std::vector<Proxy> &nodes,
     }
 
     for (const auto &y : x.Proxies)
-      groupGenerate(y, nodelist, filtered_nodelist, true, ext);
+      groupGenerate(y, membership, filtered_nodelist, true, ext);
 
     if (filtered_nodelist.empty() && !has_remote_selector)
       filtered_nodelist.emplace_back("DIRECT");
@@ -5364,7 +5355,8 @@ std::string proxyToSSSub(std::string base_conf, std::vector<Proxy> &nodes,
   generation_stats = TargetGenerationStats{};
   generation_stats.input_nodes = nodes.size();
   using namespace rapidjson_ext;
-  rapidjson::Document base;
+  RequestJsonAllocator base_allocator;
+  rapidjson::Document base(base_allocator.get());
 
   auto &alloc = base.GetAllocator();
 
@@ -5467,7 +5459,8 @@ void proxyToQuan(std::vector<Proxy> &nodes, INIReader &ini,
   generation_stats.input_nodes = nodes.size();
   std::string proxyStr;
   std::vector<Proxy> nodelist;
-  RemarkSet used_remarks;
+  nodelist.reserve(nodes.size());
+  RemarkSet used_remarks(requestMemoryResource());
   used_remarks.reserve(nodes.size());
 
   ini.set_current_section("SERVER");
@@ -5589,8 +5582,8 @@ void proxyToQuan(std::vector<Proxy> &nodes, INIReader &ini,
     }
 
     ini.set("{NONAME}", proxyStr);
-    used_remarks.emplace(x.Remark);
-    nodelist.emplace_back(x);
+    nodelist.emplace_back(std::move(x));
+    used_remarks.emplace(nodelist.back().Remark);
     generation_tracker.markEmitted();
   }
 
@@ -5600,6 +5593,7 @@ void proxyToQuan(std::vector<Proxy> &nodes, INIReader &ini,
   ini.set_current_section("POLICY");
   ini.erase_section();
 
+  GroupMembership membership(nodelist, extra_proxy_group, ext.parallel_for);
   for (const ProxyGroupConfig &x : extra_proxy_group) {
     string_array filtered_nodelist;
     std::string type;
@@ -5641,7 +5635,7 @@ void proxyToQuan(std::vector<Proxy> &nodes, INIReader &ini,
     }
 
     for (const auto &y : x.Proxies)
-      groupGenerate(y, nodelist, filtered_nodelist, true, ext);
+      groupGenerate(y, membership, filtered_nodelist, true, ext);
 
     if (filtered_nodelist.empty())
       filtered_nodelist.emplace_back("direct");
@@ -5905,7 +5899,8 @@ void proxyToQuanX(std::vector<Proxy> &nodes, INIReader &ini,
   std::string proxyStr;
   tribool udp, tfo, scv, tls13;
   std::vector<Proxy> nodelist;
-  RemarkSet used_remarks;
+  nodelist.reserve(nodes.size());
+  RemarkSet used_remarks(requestMemoryResource());
   used_remarks.reserve(nodes.size());
 
   ini.set_current_section("server_local");
@@ -6193,8 +6188,8 @@ void proxyToQuanX(std::vector<Proxy> &nodes, INIReader &ini,
     proxyStr += ", tag=" + x.Remark;
 
     ini.set("{NONAME}", proxyStr);
-    used_remarks.emplace(x.Remark);
-    nodelist.emplace_back(x);
+    nodelist.emplace_back(std::move(x));
+    used_remarks.emplace(nodelist.back().Remark);
     generation_tracker.markEmitted();
   }
 
@@ -6206,6 +6201,7 @@ void proxyToQuanX(std::vector<Proxy> &nodes, INIReader &ini,
   ini.get_items(original_groups);
   ini.erase_section();
 
+  GroupMembership membership(nodelist, extra_proxy_group, ext.parallel_for);
   for (const ProxyGroupConfig &x : extra_proxy_group) {
     std::string type;
     string_array filtered_nodelist;
@@ -6235,7 +6231,7 @@ void proxyToQuanX(std::vector<Proxy> &nodes, INIReader &ini,
 
     if (x.Type != ProxyGroupType::SSID) {
       for (const auto &y : x.Proxies)
-        groupGenerate(y, nodelist, filtered_nodelist, true, ext);
+        groupGenerate(y, membership, filtered_nodelist, true, ext);
 
       QuanXRemoteSelector remote_selector =
           quanxRemoteSelectorForGroup(x, ext.quanx_server_remotes);
@@ -6429,8 +6425,9 @@ void proxyToMellow(std::vector<Proxy> &nodes, INIReader &ini,
   std::string url;
   tribool tfo, scv;
   std::vector<Proxy> nodelist;
+  nodelist.reserve(nodes.size());
   string_array vArray, remarks_list;
-  RemarkSet used_remarks;
+  RemarkSet used_remarks(requestMemoryResource());
   used_remarks.reserve(nodes.size());
 
   ini.set_current_section("Endpoint");
@@ -6521,13 +6518,14 @@ void proxyToMellow(std::vector<Proxy> &nodes, INIReader &ini,
 
     ini.set("{NONAME}", proxy);
     remarks_list.emplace_back(x.Remark);
-    used_remarks.emplace(x.Remark);
-    nodelist.emplace_back(x);
+    nodelist.emplace_back(std::move(x));
+    used_remarks.emplace(nodelist.back().Remark);
     generation_tracker.markEmitted();
   }
 
   ini.set_current_section("EndpointGroup");
 
+  GroupMembership membership(nodelist, extra_proxy_group, ext.parallel_for);
   for (const ProxyGroupConfig &x : extra_proxy_group) {
     string_array filtered_nodelist;
     url.clear();
@@ -6544,7 +6542,7 @@ void proxyToMellow(std::vector<Proxy> &nodes, INIReader &ini,
     }
 
     for (const auto &y : x.Proxies)
-      groupGenerate(y, nodelist, filtered_nodelist, false, ext);
+      groupGenerate(y, membership, filtered_nodelist, false, ext);
 
     if (filtered_nodelist.empty()) {
       if (remarks_list.empty())
@@ -6696,13 +6694,14 @@ std::string proxyToLoon(std::vector<Proxy> &nodes, const std::string &base_conf,
   INIReader ini;
   std::string output_nodelist;
   std::vector<Proxy> nodelist;
+  nodelist.reserve(nodes.size());
   TargetGenerationStats &generation_stats = ext.target_generation_stats;
   generation_stats = TargetGenerationStats{};
   generation_stats.input_nodes = nodes.size();
   TargetGenerationStatsMirror generation_stats_mirror(
       generation_stats, ext.loon_generation_stats);
 
-  RemarkSet used_remarks;
+  RemarkSet used_remarks(requestMemoryResource());
   used_remarks.reserve(nodes.size());
 
   ini.store_any_line = true;
@@ -7037,8 +7036,8 @@ std::string proxyToLoon(std::vector<Proxy> &nodes, const std::string &base_conf,
       output_nodelist += x.Remark + " = " + proxy + "\n";
     else {
       ini.set("{NONAME}", x.Remark + " = " + proxy);
-      nodelist.emplace_back(x);
-      used_remarks.emplace(x.Remark);
+      nodelist.emplace_back(std::move(x));
+      used_remarks.emplace(nodelist.back().Remark);
     }
     generation_stats.emitted_nodes++;
   }
@@ -7053,6 +7052,7 @@ std::string proxyToLoon(std::vector<Proxy> &nodes, const std::string &base_conf,
 
   size_t loon_group_index = 0;
   size_t generated_remote_filters = 0;
+  GroupMembership membership(nodelist, extra_proxy_group, ext.parallel_for);
   for (const ProxyGroupConfig &x : extra_proxy_group) {
     const size_t current_group_index = ++loon_group_index;
     string_array filtered_nodelist;
@@ -7076,7 +7076,7 @@ std::string proxyToLoon(std::vector<Proxy> &nodes, const std::string &base_conf,
     }
 
     for (const auto &y : x.Proxies)
-      groupGenerate(y, nodelist, filtered_nodelist, true, ext);
+      groupGenerate(y, membership, filtered_nodelist, true, ext);
 
     auto add_remote_member = [&](const std::string &member) {
       if (std::find(filtered_nodelist.begin(), filtered_nodelist.end(),
@@ -7368,7 +7368,7 @@ void proxyToSingBox(std::vector<Proxy> &nodes, rapidjson::Document &json,
   size_t snell_nodes_input = 0;
   size_t snell_nodes_emitted = 0;
   size_t snell_v5_normalized = 0;
-  RemarkSet used_remarks;
+  RemarkSet used_remarks(requestMemoryResource());
   used_remarks.reserve(nodes.size());
 
   if (!ext.nodelist) {
@@ -7936,6 +7936,7 @@ void proxyToSingBox(std::vector<Proxy> &nodes, rapidjson::Document &json,
     return;
   }
 
+  GroupMembership membership(nodelist, extra_proxy_group, ext.parallel_for);
   for (const ProxyGroupConfig &x : extra_proxy_group) {
     string_array filtered_nodelist;
     std::string type;
@@ -7954,7 +7955,7 @@ void proxyToSingBox(std::vector<Proxy> &nodes, rapidjson::Document &json,
       continue;
     }
     for (const auto &y : x.Proxies)
-      groupGenerate(y, nodelist, filtered_nodelist, true, ext);
+      groupGenerate(y, membership, filtered_nodelist, true, ext);
 
     if (filtered_nodelist.empty())
       filtered_nodelist.emplace_back("DIRECT");
@@ -8013,7 +8014,8 @@ std::string proxyToSingBox(std::vector<Proxy> &nodes,
   ext.target_generation_stats = TargetGenerationStats{};
   ext.target_generation_stats.input_nodes = nodes.size();
   using namespace rapidjson_ext;
-  rapidjson::Document json;
+  RequestJsonAllocator json_allocator;
+  rapidjson::Document json(json_allocator.get());
 
   if (!ext.nodelist) {
     json.Parse(base_conf.data());
@@ -14,6 +14,7 @@
 #include "config/proxy_provider_interval.h"
 #include "config/proxy_provider_direct.h"
 #include "config/regmatch.h"
+#include "generator/config/group_membership.h"
 #include "parser/config/proxy.h"
 #include "ruleconvert.h"
 #include "utils/ini_reader/ini_reader.h"
@@ -163,6 +164,7 @@ struct extra_settings {
   TargetGenerationStats loon_generation_stats;
   bool authorized = false;
   RuleConversionStats *rule_stats = nullptr;
+  ParallelFor parallel_for;
 
   extra_settings() = default;
   extra_settings(const extra_settings &) = delete;
@@ -439,12 +439,11 @@ int renderClashScript(YAML::Node &base_rule, std::vector<RulesetContent> &rulese
 {
     RuleConversionStats local_stats;
     nlohmann::json data;
-    std::string match_group, geoips, retrieved_rules;
+    std::string match_group, geoips;
     std::string strLine, rule_group, rule_path, rule_path_typed, rule_name, old_rule_name;
-    std::stringstream strStrm;
     string_array vArray, groups;
     string_map keywords, urls, names;
-    std::map<std::string, bool> has_domain, has_ipcidr;
+    std::map<std::string, bool> has_domain, has_ipcidr, aggregate_cidr;
     std::map<std::string, int> ruleset_interval, rule_type;
     string_array rules;
     int index = 0;
@@ -459,7 +458,7 @@ int renderClashScript(YAML::Node &base_rule, std::vector<RulesetContent> &rulese
         rule_path_typed = x.rule_path_typed;
         if(rule_path.empty())
         {
-            strLine = x.rule_content.get().substr(2);
+            strLine = x.rule_content.get().text().substr(2);
             if(script)
             {
                 if(startsWith(strLine, "MATCH") || startsWith(strLine, "FINAL"))
@@ -533,6 +532,7 @@ int renderClashScript(YAML::Node &base_rule, std::vector<RulesetContent> &rulese
                         rule_name = old_rule_name + " " + std::to_string(idx++);
                     names[rule_name] = rule_group;
                     urls[rule_name] = rule_path_typed;
+                    aggregate_cidr[rule_name] = x.options.aggregate_cidr;
                     rule_type[rule_name] = x.rule_type;
                     ruleset_interval[rule_name] = x.update_interval;
                     if(clash_classical_ruleset)
@@ -550,23 +550,22 @@ int renderClashScript(YAML::Node &base_rule, std::vector<RulesetContent> &rulese
                     continue;
             }
 
-            retrieved_rules = x.rule_content.get();
-            if(retrieved_rules.empty())
+            const RulesetBody &body = x.rule_content.get();
+            if(body.text().empty())
             {
                 writeLog(LOG_LEVEL_WARNING, "获取规则集失败或规则集为空：" +
                                 summarizeUrlForLog(x.rule_path) + "。");
                 continue;
             }
 
-            retrieved_rules = convertRuleset(retrieved_rules, x.rule_type);
-            char delimiter = getLineBreak(retrieved_rules);
-
-            strStrm.clear();
-            strStrm<<retrieved_rules;
+            const RulesetText retrieved_rules = convertRuleset(body, x.rule_type, x.options.aggregate_cidr);
+            char delimiter = getLineBreak(*retrieved_rules);
+            std::string_view remaining = *retrieved_rules, line;
             std::string::size_type lineSize;
             bool has_no_resolve = false;
-            while(getline(strStrm, strLine, delimiter))
+            while(nextRulesetLine(remaining, delimiter, line))
             {
+                strLine.assign(line);
                 lineSize = strLine.size();
                 if(lineSize && strLine[lineSize - 1] == '\r') //remove line break
                     strLine.erase(--lineSize);
@@ -648,6 +647,7 @@ int renderClashScript(YAML::Node &base_rule, std::vector<RulesetContent> &rulese
             direct_mrs ? "mrs" : direct_txt ? "text" : "";
         bool group_has_domain = has_domain[x], group_has_ipcidr = has_ipcidr[x];
         int interval = ruleset_interval[x];
+        std::string aggregate_query = aggregate_cidr[x] ? "&aggregate=true" : "";
 
         if(group_has_domain)
         {
@@ -679,7 +679,7 @@ int renderClashScript(YAML::Node &base_rule, std::vector<RulesetContent> &rulese
             if(url[0] == '*')
                 base_rule["rule-providers"][yaml_key]["url"] = url.substr(1);
             else
-                base_rule["rule-providers"][yaml_key]["url"] = remote_path_prefix + "/getruleset?type=4&url=" + urlSafeBase64Encode(url);
+                base_rule["rule-providers"][yaml_key]["url"] = remote_path_prefix + "/getruleset?type=4&url=" + urlSafeBase64Encode(url) + aggregate_query;
             base_rule["rule-providers"][yaml_key]["path"] =
                 "./providers/" + std::to_string(hash_(url)) +
                 (direct_mrs ? "_ipcidr.mrs" :
@@ -697,7 +697,7 @@ int renderClashScript(YAML::Node &base_rule, std::vector<RulesetContent> &rulese
             if(url[0] == '*')
                 base_rule["rule-providers"][yaml_key]["url"] = url.substr(1);
             else
-                base_rule["rule-providers"][yaml_key]["url"] = remote_path_prefix + "/getruleset?type=6&url=" + urlSafeBase64Encode(url);
+                base_rule["rule-providers"][yaml_key]["url"] = remote_path_prefix + "/getruleset?type=6&url=" + urlSafeBase64Encode(url) + aggregate_query;
             base_rule["rule-providers"][yaml_key]["path"] =
                 "./providers/" + std::to_string(hash_(url)) +
                 (direct_mrs ? ".mrs" : direct_txt ? ".txt" : ".yaml");
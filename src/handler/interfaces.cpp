@@ -21,6 +21,7 @@
 #include <yaml-cpp/yaml.h>
 
 #include "config/binding.h"
+#include "generator/config/cidr_aggregation.h"
 #include "generator/config/clash_proxy.h"
 #include "generator/config/external_rules.h"
 #include "generator/config/nodemanip.h"
@@ -52,13 +53,18 @@ static string_icase_map buildSubscriptionRequestHeaders() {
 }
 
 #include "utils/base64/base64.h"
+#include "utils/concurrent_lru_cache.h"
+#include "utils/content_digest.h"
+#include "utils/defer.h"
 #include "utils/file_extra.h"
 #include "utils/ini_reader/ini_reader.h"
+#include "utils/interned_string.h"
 #include "utils/logger.h"
 #include "utils/md5/md5_interface.h"
 #include "utils/network.h"
 #include "utils/redact.h"
 #include "utils/regexp.h"
+#include "utils/request_arena.h"
 #include "utils/stl_extra.h"
 #include "utils/string.h"
 #include "utils/string_hash.h"
@@ -373,6 +379,66 @@ static std::string buildProviderRemarkFilter(const string_array &rules) {
 
 extern string_array ClashRuleTypes, SurgeRuleTypes, QuanXRuleTypes;
 
+constexpr size_t kRulesetResponseCacheEntries = 256;
+constexpr size_t kRulesetResponseCacheBytes = 32 * 1024 * 1024;
+
+// A finished /getruleset body. An empty etag marks a request without any
+// usable rules; it is answered with 400 and never cached.
+struct RulesetResponse {
+  std::string body;
+  std::string content_type;
+  std::string etag;
+};
+
+using RulesetResponseCache =
+    ConcurrentLruCache<std::string, std::shared_ptr<const RulesetResponse>>;
+static RulesetResponseCache
+    ruleset_response_cache(kRulesetResponseCacheEntries,
+                           kRulesetResponseCacheBytes);
+
+size_t rulesetResponseCacheMaxEntries() {
+  return kRulesetResponseCacheEntries;
+}
+
+size_t rulesetResponseCacheMaxBytes() { return kRulesetResponseCacheBytes; }
+
+static std::shared_ptr<const RulesetResponse>
+renderRulesetResponse(const std::vector<RulesetContent> &rca, int type_int,
+                      const std::string &group, bool aggregate) {
+  auto result = std::make_shared<RulesetResponse>();
+  std::string output_content;
+  for (const RulesetContent &x : rca)
+    output_content +=
+        *convertRuleset(x.rule_content.get(), x.rule_type, aggregate);
+  // Ranges from different sources can still overlap each other.
+  if (aggregate && rca.size() > 1)
+    output_content = aggregateCidrRules(output_content);
+  if (output_content.empty())
+    return result;
+
+  const RulesetTypeCatalogs catalogs{ClashRuleTypes, SurgeRuleTypes,
+                                     QuanXRuleTypes};
+  if (type_int == 7 || type_int == 8) {
+#ifdef USE_MIHOMO_PARSER
+    result->body = mihomo::convertRulesetToMrs(
+        formatRulesetOutput(std::move(output_content), type_int - 4, group,
+                            catalogs),
+        type_int == 7 ? "domain" : "ipcidr");
+    // None of the rules fit the behavior; answered like an empty source.
+    if (result->body.empty())
+      return result;
+    result->content_type = "application/octet-stream";
+#endif // USE_MIHOMO_PARSER
+  } else {
+    result->body = formatRulesetOutput(std::move(output_content), type_int,
+                                       group, catalogs);
+  }
+  // The cache key digests are seeded per process, so they would hand clients a
+  // new tag after every restart; the body's MD5 is the same on every instance.
+  result->etag = "\"" + getMD5(result->body) + "\"";
+  return result;
+}
+
 std::string getRuleset(RESPONSE_CALLBACK_ARGS) {
   SettingsSnapshot snapshot = captureEffectiveSettingsSnapshot();
   ScopedSettingsView settings_scope(std::move(snapshot));
@@ -380,21 +446,30 @@ std::string getRuleset(RESPONSE_CALLBACK_ARGS) {
   int *status_code = &response.status_code;
   /// type: 1 for Surge, 2 for Quantumult X, 3 for Clash domain rule-provider, 4
   /// for Clash ipcidr rule-provider, 5 for Surge DOMAIN-SET, 6 for Clash
-  /// classical ruleset
+  /// classical ruleset, 7 and 8 for types 3 and 4 encoded as Mihomo mrs
+  /// aggregate: merge the IP-CIDR rules into the fewest covering prefixes
   std::string url = urlSafeBase64Decode(getUrlArg(argument, "url")),
               type = getUrlArg(argument, "type"),
               group = urlSafeBase64Decode(getUrlArg(argument, "group"));
-  std::string output_content;
+  const bool aggregate = tribool(getUrlArg(argument, "aggregate")).get();
   int type_int = to_int(type, 0);
 
   if (url.empty() || type.empty() || (type_int == 2 && group.empty()) ||
-      (type_int < 1 || type_int > 6)) {
+      (type_int < 1 || type_int > 8)) {
     *status_code = 400;
     return "Invalid request: missing or invalid ruleset parameters.\n"
            "无效请求：规则集参数缺失或无效。\n"
-           "Required: url and type=1..6; group is required when type=2.\n"
-           "必须提供 url 和 type=1..6；当 type=2 时还必须提供 group。";
+           "Required: url and type=1..8; group is required when type=2.\n"
+           "必须提供 url 和 type=1..8；当 type=2 时还必须提供 group。";
+  }
+#ifndef USE_MIHOMO_PARSER
+  if (type_int == 7 || type_int == 8) {
+    *status_code = 501;
+    return "mrs output requires the Mihomo bridge, which this build does not "
+           "include.\n"
+           "mrs 输出需要 Mihomo 桥接库，当前构建未包含。";
   }
+#endif // USE_MIHOMO_PARSER
 
   string_array vArray = split(url, "|");
   for (std::string &x : vArray)
@@ -402,12 +477,38 @@ std::string getRuleset(RESPONSE_CALLBACK_ARGS) {
   std::vector<RulesetContent> rca;
   RulesetConfigs confs = INIBinding::from<RulesetConfig>::from_ini(vArray);
   refreshRulesets(confs, rca, FetchContext::PublicRequest);
-  for (RulesetContent &x : rca) {
-    std::string content = x.rule_content.get();
-    output_content += convertRuleset(content, x.rule_type);
+
+  // The body depends only on these parameters and the fetched bodies, whose
+  // digests change whenever the fetch cache hands out new content, so a
+  // refreshed source never hits a stale entry.
+  std::vector<RulesetKeySource> key_sources;
+  key_sources.reserve(rca.size());
+  for (const RulesetContent &x : rca)
+    key_sources.push_back({x.rule_type, x.rule_content.get().digest});
+  const std::string key =
+      buildRulesetResponseKey(type_int, aggregate, key_sources, group);
+
+  std::shared_ptr<const RulesetResponse> result;
+  try {
+    result = ruleset_response_cache.getOrCompute(
+        key, true,
+        [&] {
+          return renderRulesetResponse(rca, type_int, group, aggregate);
+        },
+        [](const std::shared_ptr<const RulesetResponse> &value)
+            -> RulesetResponseCache::CacheSize {
+          if (value->etag.empty())
+            return std::nullopt;
+          return value->body.size() + value->etag.size();
+        });
+  } catch (const std::exception &e) {
+    writeLog(LOG_LEVEL_ERROR, std::string("规则集输出生成失败：") + e.what());
+    *status_code = 500;
+    return "Internal error: the ruleset output could not be generated.\n"
+           "内部错误：无法生成规则集输出。";
   }
 
-  if (output_content.empty()) {
+  if (result->etag.empty()) {
     *status_code = 400;
     return "Invalid request: no valid rules were found in the supplied "
            "ruleset source.\n"
@@ -416,10 +517,16 @@ std::string getRuleset(RESPONSE_CALLBACK_ARGS) {
            "matches the content.\n"
            "请检查链接是否可访问，以及规则集类型是否与内容匹配。";
   }
-
-  return formatRulesetOutput(
-      std::move(output_content), type_int, group,
-      RulesetTypeCatalogs{ClashRuleTypes, SurgeRuleTypes, QuanXRuleTypes});
+  response.headers["ETag"] = result->etag;
+  if (!result->content_type.empty())
+    response.content_type = result->content_type;
+  auto if_none_match = request.headers.find("If-None-Match");
+  if (if_none_match != request.headers.end() &&
+      matchesIfNoneMatch(if_none_match->second, result->etag)) {
+    *status_code = 304;
+    return "";
+  }
+  return result->body;
 }
 
 bool checkExternalBase(const std::string &path, std::string &dest,
@@ -2028,6 +2135,7 @@ static std::string buildEffectiveSubPolicy(Request &request,
   policy.include_remarks = settings.includeRemarks;
   policy.exclude_remarks = settings.excludeRemarks;
   policy.generator.rule_stats = rule_stats;
+  policy.generator.parallel_for = parallelForChunks;
   policy.update_interval =
       !parsed.update_interval.empty()
           ? to_int(parsed.update_interval, settings.updateInterval)
@@ -3142,8 +3250,12 @@ static SubStageResponse processSubscriptionNodes(
     urls = split(settings.insertUrls, "|");
     explain.insert_url_count = urls.size();
     importItems(urls, true);
-    for (std::string &x : urls) {
+    for (std::string &x : urls)
       x = regTrim(x);
+    PrefetchedSources prefetched = prefetchSources(urls, parse_set);
+    parse_set.prefetched = &prefetched;
+    defer(parse_set.prefetched = nullptr;)
+    for (std::string &x : urls) {
       writeLog(LOG_LEVEL_INFO, "正在从 URL 获取节点数据：" + summarizeUrlForLog(x) + "。");
       source_calls++;
       if (addNodes(x, insert_nodes, groupID, parse_set) == -1) {
@@ -3928,16 +4040,31 @@ static SubStageResponse processSubscriptionNodes(
     }
   } else {
     importItems(urls, true, FetchContext::PublicRequest);
+    // Subscriptions are downloaded up front so their bodies reach the Mihomo
+    // bridge in one batched call; direct HTTP proxy links are not sources.
+    std::vector<bool> force_direct_links;
+    string_array prefetch_urls;
     for (std::string &x : urls) {
       x = regTrim(x);
-      writeLog(LOG_LEVEL_INFO, "正在从 URL 获取节点数据：" + summarizeUrlForLog(x) + "。");
-      source_calls++;
-      parse_settings item_parse_set = parse_set;
+      bool force_direct_link = false;
       if (native_remote_target) {
         const TaggedLink tagged = parseTaggedLink(x);
-        item_parse_set.force_direct_link =
+        force_direct_link =
             isLegacyHttpProxyUri(tagged.link.empty() ? x : tagged.link);
       }
+      force_direct_links.push_back(force_direct_link);
+      if (!force_direct_link)
+        prefetch_urls.push_back(x);
+    }
+    PrefetchedSources prefetched = prefetchSources(prefetch_urls, parse_set);
+    for (size_t index = 0; index < urls.size(); ++index) {
+      std::string &x = urls[index];
+      writeLog(LOG_LEVEL_INFO, "正在从 URL 获取节点数据：" + summarizeUrlForLog(x) + "。");
+      source_calls++;
+      parse_settings item_parse_set = parse_set;
+      item_parse_set.force_direct_link = force_direct_links[index];
+      if (!item_parse_set.force_direct_link)
+        item_parse_set.prefetched = &prefetched;
       if (addNodes(x, nodes, groupID, item_parse_set) == -1) {
         source_failures++;
         writeLog(LOG_LEVEL_WARNING,
@@ -4016,7 +4143,7 @@ static SubStageResponse processSubscriptionNodes(
         ext.js_runtime, ext.js_context,
         [&](qjs::Context &ctx) {
           try {
-            ctx.eval(filterScript);
+            script_eval_cached(ctx, filterScript);
             auto filter =
                 (std::function<bool(const Proxy &)>)ctx.eval("filter");
             nodes.erase(std::remove_if(nodes.begin(), nodes.end(), filter),
@@ -4961,6 +5088,14 @@ static std::string assembleSubResponse(
 static std::string subconverter_impl(Request &request, Response &response,
                                      const Settings &settings,
                                      RuleConversionStats *rule_stats) {
+  // Request-local temporaries on this thread (remark sets, split rule fields,
+  // the Surge rule list, Clash proxy item scratch, the first chunk of the
+  // sing-box and SS JSON documents) draw from this arena and are released
+  // together when the conversion returns. Node fields parsed on this thread
+  // share repeated values through the intern pool, whose lookup table is on
+  // the arena too, so the pool is opened second and closed first.
+  RequestArena request_arena;
+  StringInternPool string_pool;
   ParsedSubRequest parsed_request;
   std::string parse_error =
       parseSubRequestArguments(request, response, settings, parsed_request);
@@ -5020,6 +5155,7 @@ std::string simpleToClashR(RESPONSE_CALLBACK_ARGS) {
 }
 
 std::string surgeConfToClash(RESPONSE_CALLBACK_ARGS) {
+  StringInternPool string_pool;
   auto argument = joinArguments(request.argument);
   int *status_code = &response.status_code;
 
@@ -18,7 +18,10 @@ void refreshRulesets(RulesetConfigs &ruleset_list,
                          nullptr);
 bool readConf();
 int simpleGenerator();
-std::string convertRuleset(const std::string &content, int type);
+RulesetText convertRuleset(const RulesetBody &body, int type,
+                           bool aggregate_cidr);
+size_t rulesetResponseCacheMaxEntries();
+size_t rulesetResponseCacheMaxBytes();
 
 std::string getProfile(RESPONSE_CALLBACK_ARGS);
 std::string getRuleset(RESPONSE_CALLBACK_ARGS);
@@ -1,13 +1,19 @@
 #include <algorithm>
 #include <atomic>
+#include <condition_variable>
+#include <exception>
 #include <future>
+#include <memory>
+#include <mutex>
 #include <thread>
 #include <utility>
+#include <vector>
 
 #include "handler/settings.h"
 #include "handler/settings_view.h"
 #include "utils/network.h"
 #include "utils/bounded_executor.h"
+#include "utils/content_digest.h"
 #include "webget.h"
 #include "multithread.h"
 //#include "vfs.h"
@@ -38,9 +44,10 @@ static BoundedExecutor &rulesetExecutor()
     return executor;
 }
 
-std::shared_future<std::string> makeReadyStringFuture(std::string value)
+template <class Value>
+static std::shared_future<Value> makeReadyFuture(Value value)
 {
-    std::promise<std::string> promise;
+    std::promise<Value> promise;
     promise.set_value(std::move(value));
     return promise.get_future().share();
 }
@@ -64,6 +71,93 @@ void shutdownRulesetExecutor()
         executor->shutdown(true);
 }
 
+// Chunks are claimed from a shared counter, by the caller and by helper
+// tasks queued on the ruleset executor. The caller claims until none are
+// left and then waits only for chunks a worker has already started, so it
+// never blocks on a helper stuck in the queue behind a slow download. A
+// helper that starts after the last claim finds nothing left and returns
+// without touching the caller's body.
+namespace {
+struct ChunkRun
+{
+    const std::function<void(size_t, size_t)> *body = nullptr;
+    SettingsSnapshot settings;
+    size_t count = 0;
+    size_t chunk_size = 0;
+    size_t chunk_count = 0;
+    std::atomic<size_t> next {0};
+    std::mutex mutex;
+    std::condition_variable finished_cv;
+    size_t finished = 0;
+    std::exception_ptr failure;
+};
+
+void runClaimedChunks(ChunkRun &run)
+{
+    for(;;)
+    {
+        const size_t index = run.next.fetch_add(1, std::memory_order_relaxed);
+        if(index >= run.chunk_count)
+            return;
+        const size_t begin = index * run.chunk_size;
+        std::exception_ptr failure;
+        try
+        {
+            (*run.body)(begin, std::min(run.count, begin + run.chunk_size));
+        }
+        catch(...)
+        {
+            failure = std::current_exception();
+        }
+        std::lock_guard<std::mutex> lock(run.mutex);
+        if(failure && !run.failure)
+            run.failure = failure;
+        if(++run.finished == run.chunk_count)
+            run.finished_cv.notify_all();
+    }
+}
+} // namespace
+
+void parallelForChunks(size_t count, size_t min_chunk,
+                       const std::function<void(size_t, size_t)> &body)
+{
+    BoundedExecutor &executor = rulesetExecutor();
+    const size_t chunk_limit = count / std::max<size_t>(min_chunk, 1);
+    const size_t chunk_count =
+        std::min(chunk_limit, executor.workerCount() + 1);
+    if(chunk_count <= 1)
+    {
+        body(0, count);
+        return;
+    }
+
+    auto run = std::make_shared<ChunkRun>();
+    run->body = &body;
+    run->settings = captureEffectiveSettingsSnapshot();
+    run->count = count;
+    run->chunk_size = (count + chunk_count - 1) / chunk_count;
+    run->chunk_count = (count + run->chunk_size - 1) / run->chunk_size;
+    // A helper rejected during shutdown never runs; the caller claims its
+    // share instead, so the futures are not needed.
+    for(size_t i = 1; i < run->chunk_count; i++)
+        executor.submit([run]() {
+            if(run->next.load(std::memory_order_relaxed) >= run->chunk_count)
+                return;
+            ScopedSettingsView view(run->settings);
+            runClaimedChunks(*run);
+        });
+
+    runClaimedChunks(*run);
+    // Every claimed chunk must be done before returning, even after a
+    // failure, because it references the caller's body and data.
+    std::unique_lock<std::mutex> lock(run->mutex);
+    run->finished_cv.wait(lock, [&run]() {
+        return run->finished == run->chunk_count;
+    });
+    if(run->failure)
+        std::rethrow_exception(run->failure);
+}
+
 RegexMatchConfigs safe_get_emojis()
 {
     guarded_mutex guard(on_emoji);
@@ -129,7 +223,62 @@ static bool canReadLocalFetchPath(const std::string &path,
     return false;
 }
 
-std::shared_future<std::string> fetchFileAsync(const std::string &path, const ProxyPolicy &proxy, int cache_ttl, bool find_local, bool async, FetchContext context)
+// How fetchAsyncWith() reads a local file, downloads a link and what it
+// returns for a path that is neither.
+struct PlainFetch
+{
+    using Result = std::string;
+
+    static Result local(const std::string &path, bool scope_limit)
+    {
+        return fileGet(path, scope_limit);
+    }
+
+    static Result remote(const std::string &path, const ProxyPolicy &proxy, int cache_ttl, FetchContext context)
+    {
+        return webGet(path, proxy, cache_ttl, nullptr, nullptr, context);
+    }
+
+    static Result none()
+    {
+        return {};
+    }
+};
+
+static RulesetBody digestBody(std::string content)
+{
+    RulesetBody body;
+    body.digest = getContentDigest(content);
+    body.content = std::make_shared<const std::string>(std::move(content));
+    return body;
+}
+
+// Downloads go through webGetRuleset(), so a cache hit shares the body and
+// digest kept in memory for that cache file.
+struct RulesetFetch
+{
+    using Result = RulesetBody;
+
+    static Result local(const std::string &path, bool scope_limit)
+    {
+        return digestBody(fileGet(path, scope_limit));
+    }
+
+    static Result remote(const std::string &path, const ProxyPolicy &proxy, int cache_ttl, FetchContext context)
+    {
+        return webGetRuleset(path, proxy, cache_ttl, context);
+    }
+
+    static Result none()
+    {
+        return digestBody(std::string());
+    }
+};
+
+// Fetches path as fetchFileAsync() documents, reading and downloading
+// through Fetch on the thread that does the work.
+template <class Fetch>
+static std::shared_future<typename Fetch::Result> fetchAsyncWith(const std::string &path, const ProxyPolicy &proxy, int cache_ttl, bool find_local, bool async, FetchContext context)
 {
     const bool trusted_local_path = isTrustedLocalResourcePath(path);
     const bool scope_limit = !trusted_local_path;
@@ -137,32 +286,46 @@ std::shared_future<std::string> fetchFileAsync(const std::string &path, const Pr
     {
         if(find_local && fileExist(path, scope_limit) &&
            canReadLocalFetchPath(path, context))
-            return makeReadyStringFuture(fileGet(path, scope_limit));
+            return makeReadyFuture(Fetch::local(path, scope_limit));
         if(isLink(path))
-            return makeReadyStringFuture(webGet(path, proxy, cache_ttl, nullptr, nullptr, context));
-        return makeReadyStringFuture(std::string());
+            return makeReadyFuture(Fetch::remote(path, proxy, cache_ttl, context));
+        return makeReadyFuture(Fetch::none());
     }
 
-    std::future<std::string> retVal;
+    std::future<typename Fetch::Result> retVal;
     if(find_local && fileExist(path, scope_limit) &&
        canReadLocalFetchPath(path, context))
         retVal = rulesetExecutor().submit(
-            [path, scope_limit](){ return fileGet(path, scope_limit); });
+            [path, scope_limit](){ return Fetch::local(path, scope_limit); });
     else if(isLink(path))
     {
         SettingsSnapshot settings = captureEffectiveSettingsSnapshot();
         retVal = rulesetExecutor().submit(
             [path, proxy, cache_ttl, context, settings](){
                 ScopedSettingsView view(settings);
-                return webGet(path, proxy, cache_ttl, nullptr, nullptr,
-                              context);
+                return Fetch::remote(path, proxy, cache_ttl, context);
             });
     }
     else
-        return makeReadyStringFuture(std::string());
+        return makeReadyFuture(Fetch::none());
     return retVal.share();
 }
 
+std::shared_future<std::string> fetchFileAsync(const std::string &path, const ProxyPolicy &proxy, int cache_ttl, bool find_local, bool async, FetchContext context)
+{
+    return fetchAsyncWith<PlainFetch>(path, proxy, cache_ttl, find_local, async, context);
+}
+
+std::shared_future<RulesetBody> fetchRulesetAsync(const std::string &path, const ProxyPolicy &proxy, int cache_ttl, bool find_local, bool async, FetchContext context)
+{
+    return fetchAsyncWith<RulesetFetch>(path, proxy, cache_ttl, find_local, async, context);
+}
+
+std::shared_future<RulesetBody> makeReadyRulesetFuture(std::string content)
+{
+    return makeReadyFuture(digestBody(std::move(content)));
+}
+
 std::string fetchFile(const std::string &path, const ProxyPolicy &proxy, int cache_ttl, bool find_local, FetchContext context)
 {
     return fetchFileAsync(path, proxy, cache_ttl, find_local, false, context).get();
@@ -4,10 +4,12 @@
 #include <mutex>
 #include <future>
 #include <cstddef>
+#include <functional>
 
 #include <yaml-cpp/yaml.h>
 
 #include "config/regmatch.h"
+#include "config/ruleset.h"
 #include "handler/fetch_context.h"
 #include "handler/proxy_policy.h"
 #include "utils/ini_reader/ini_reader.h"
@@ -28,14 +30,26 @@ void safe_set_renames(RegexMatchConfigs data);
 void safe_set_streams(RegexMatchConfigs data);
 void safe_set_times(RegexMatchConfigs data);
 void safe_replace_settings(Settings &&settings);
-std::shared_future<std::string> makeReadyStringFuture(std::string value);
 size_t rulesetExecutorWorkerCount();
 size_t rulesetExecutorQueueCapacity();
 void shutdownRulesetExecutor();
+// Calls body(begin, end) for contiguous chunks of [0, count), each at least
+// min_chunk items long, on the ruleset executor. The calling thread claims
+// chunks alongside the workers and returns once every chunk has finished.
+void parallelForChunks(size_t count, size_t min_chunk,
+                       const std::function<void(size_t, size_t)> &body);
 std::shared_future<std::string> fetchFileAsync(
     const std::string &path, const ProxyPolicy &proxy, int cache_ttl,
     bool find_local = true, bool async = false,
     FetchContext context = FetchContext::TrustedConfig);
+// fetchFileAsync() for ruleset sources: the digest of the body is computed
+// by the same task that fetched it, or comes with the cached body on a
+// download cache hit.
+std::shared_future<RulesetBody> fetchRulesetAsync(
+    const std::string &path, const ProxyPolicy &proxy, int cache_ttl,
+    bool find_local = true, bool async = false,
+    FetchContext context = FetchContext::TrustedConfig);
+std::shared_future<RulesetBody> makeReadyRulesetFuture(std::string content);
 std::string fetchFile(const std::string &path, const ProxyPolicy &proxy,
                       int cache_ttl, bool find_local = true,
                       FetchContext context = FetchContext::TrustedConfig);
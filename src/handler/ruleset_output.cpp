@@ -140,3 +140,37 @@ std::string formatRulesetOutput(std::string converted_content, int type,
   }
   return output_content;
 }
+
+static void appendKeyField(std::string &key, const std::string &field) {
+  key += std::to_string(field.size());
+  key += ':';
+  key += field;
+}
+
+std::string buildRulesetResponseKey(int type, bool aggregate,
+                                    const std::vector<RulesetKeySource> &sources,
+                                    const std::string &group) {
+  std::string key = std::to_string(type);
+  key += aggregate ? 'a' : '-';
+  key += std::to_string(sources.size());
+  key += ';';
+  for (const RulesetKeySource &source : sources) {
+    key += std::to_string(source.rule_type);
+    key += ',';
+    appendKeyField(key, source.digest);
+  }
+  appendKeyField(key, group);
+  return key;
+}
+
+bool matchesIfNoneMatch(const std::string &if_none_match,
+                        const std::string &etag) {
+  for (std::string token : split(if_none_match, ",")) {
+    token = trim(token);
+    if (startsWith(token, "W/"))
+      token.erase(0, 2);
+    if (token == "*" || token == etag)
+      return true;
+  }
+  return false;
+}
@@ -14,4 +14,22 @@ std::string formatRulesetOutput(std::string converted_content, int type,
                                 const std::string &group,
                                 const RulesetTypeCatalogs &catalogs);
 
+// One fetched source of a /getruleset request: its ruleset type and the
+// digest of the body it was converted from.
+struct RulesetKeySource {
+  int rule_type;
+  std::string digest;
+};
+
+// Cache key of a /getruleset response. Every variable-length field is length
+// prefixed, so no group name or digest can make two requests share a key.
+std::string buildRulesetResponseKey(int type, bool aggregate,
+                                    const std::vector<RulesetKeySource> &sources,
+                                    const std::string &group);
+
+// Whether an If-None-Match header value lists etag, or "*". Weak tags
+// compare by their opaque part.
+bool matchesIfNoneMatch(const std::string &if_none_match,
+                        const std::string &etag);
+
 #endif // RULESET_OUTPUT_H_INCLUDED
@@ -1,6 +1,7 @@
 #include <algorithm>
 #include <cstdint>
 #include <mutex>
+#include <optional>
 #include <stdexcept>
 #include <string>
 #include <filesystem>
@@ -9,13 +10,14 @@
 #include "handler/webget.h"
 #include "interfaces.h"
 #include "multithread.h"
+#include "parser/mihomo_bridge.h"
 #include "script/cron.h"
 #include "server/webserver.h"
 #include "settings.h"
 #include "settings_view.h"
 #include "utils/logger.h"
 #include "utils/concurrent_lru_cache.h"
-#include "utils/md5/md5_interface.h"
+#include "utils/content_digest.h"
 #include "utils/network.h"
 #include "utils/redact.h"
 #include "utils/system.h"
@@ -334,8 +336,16 @@ static void finalizePerformanceSettings() {
   if (!response_cache_ttl.empty())
     global.responseCacheTtl = to_int(response_cache_ttl, global.responseCacheTtl);
 
+  std::string mihomo_memory_limit =
+      getEnv("SUBCONVERTER_MIHOMO_MEMORY_LIMIT");
+  if (!mihomo_memory_limit.empty())
+    global.mihomoMemoryLimit =
+        to_number<long>(mihomo_memory_limit, global.mihomoMemoryLimit);
+
   if (global.responseCacheTtl < 0)
     global.responseCacheTtl = 0;
+  if (global.mihomoMemoryLimit < 0)
+    global.mihomoMemoryLimit = 0;
   if (global.maxConcurThreads < 1)
     global.maxConcurThreads = 1;
   if (global.maxServerThreads < global.maxConcurThreads)
@@ -345,6 +355,21 @@ static void finalizePerformanceSettings() {
              "response_cache_ttl 最大允许 5 秒，已自动收敛到 5。");
     global.responseCacheTtl = 5;
   }
+#ifdef USE_MIHOMO_PARSER
+  // Leave the Go runtime alone unless a limit is configured, so a GOMEMLIMIT
+  // set by the operator keeps working. The limit found before the first
+  // override is restored when a reload clears the setting again.
+  static std::optional<long long> inherited_memory_limit;
+  if (global.mihomoMemoryLimit > 0) {
+    long long previous = mihomo::setMemoryLimit(
+        static_cast<long long>(global.mihomoMemoryLimit) * 1024LL * 1024LL);
+    if (!inherited_memory_limit)
+      inherited_memory_limit = previous;
+  } else if (inherited_memory_limit) {
+    mihomo::setMemoryLimit(*inherited_memory_limit);
+    inherited_memory_limit.reset();
+  }
+#endif // USE_MIHOMO_PARSER
 }
 
 static void finalizeDashboardAuthSettings() {
@@ -737,7 +762,7 @@ void refreshRulesets(RulesetConfigs &ruleset_list,
               "",
               "",
               RULESET_SURGE,
-              makeReadyStringFuture(rule_url.substr(pos)),
+              makeReadyRulesetFuture(rule_url.substr(pos)),
               0,
               x.Options};
     } else {
@@ -781,9 +806,10 @@ void refreshRulesets(RulesetConfigs &ruleset_list,
               rule_url_typed,
               type,
               native_stash_provider
-                  ? makeReadyStringFuture("")
-                  : fetchFileAsync(rule_url, proxy, settings.cacheRuleset, true,
-                                   settings.asyncFetchRuleset, context),
+                  ? makeReadyRulesetFuture("")
+                  : fetchRulesetAsync(rule_url, proxy, settings.cacheRuleset,
+                                      true, settings.asyncFetchRuleset,
+                                      context),
               x.Interval,
               x.Options,
               native_stash_provider ? RulesetDelivery::NativeStashProvider
@@ -997,6 +1023,7 @@ void readYAMLConf(YAML::Node &node,
     } else {
       section["overwrite_original_rules"] >> global.overwriteOriginalRules;
       section["update_ruleset_on_request"] >> global.updateRulesetOnRequest;
+      section["compact_rules"] >> global.compactRules;
     }
     const char *ruleset_title =
         section["rulesets"].IsDefined() ? "rulesets" : "surge_ruleset";
@@ -1075,6 +1102,7 @@ void readYAMLConf(YAML::Node &node,
     node["advanced"]["max_allowed_rules"] >> global.maxAllowedRules;
     node["advanced"]["max_allowed_download_size"] >>
         global.maxAllowedDownloadSize;
+    node["advanced"]["mihomo_memory_limit"] >> global.mihomoMemoryLimit;
     if (node["advanced"]["enable_cache"].IsDefined()) {
       if (safe_as<bool>(node["advanced"]["enable_cache"])) {
         node["advanced"]["cache_subscription"] >> global.cacheSubscription;
@@ -1316,7 +1344,8 @@ void readTOMLConf(toml::value &root,
 
   find_if_exist(section_ruleset, "enabled", global.enableRuleGen,
                 "overwrite_original_rules", global.overwriteOriginalRules,
-                "update_ruleset_on_request", global.updateRulesetOnRequest);
+                "update_ruleset_on_request", global.updateRulesetOnRequest,
+                "compact_rules", global.compactRules);
 
   auto rulesets = toml::find_or<std::vector<toml::value>>(root, "rulesets", {});
   importItems(rulesets, "rulesets", false);
@@ -1362,6 +1391,7 @@ void readTOMLConf(toml::value &root,
       "max_server_threads", global.maxServerThreads, "max_allowed_rulesets",
       global.maxAllowedRulesets, "max_allowed_rules", global.maxAllowedRules,
       "max_allowed_download_size", global.maxAllowedDownloadSize,
+      "mihomo_memory_limit", global.mihomoMemoryLimit,
       "enable_cache", enable_cache, "cache_subscription", cache_subscription,
       "cache_config", cache_config, "cache_ruleset", cache_ruleset,
       "script_clean_context", global.scriptCleanContext, "async_fetch_ruleset",
@@ -1760,6 +1790,7 @@ bool readConf() {
                           global.overwriteOriginalRules);
     ini.get_bool_if_exist("update_ruleset_on_request",
                           global.updateRulesetOnRequest);
+    ini.get_bool_if_exist("compact_rules", global.compactRules);
     if (ini.item_prefix_exist("ruleset")) {
       string_array vArray;
       ini.get_all("ruleset", vArray);
@@ -1830,6 +1861,7 @@ bool readConf() {
   ini.get_number_if_exist("max_allowed_rules", global.maxAllowedRules);
   ini.get_number_if_exist("max_allowed_download_size",
                           global.maxAllowedDownloadSize);
+  ini.get_number_if_exist("mihomo_memory_limit", global.mihomoMemoryLimit);
   if (ini.item_exist("enable_cache")) {
     if (ini.get_bool("enable_cache")) {
       ini.get_int_if_exist("cache_subscription", global.cacheSubscription);
@@ -2197,7 +2229,7 @@ ConcurrentLruCache<std::string, CachedExternalConfig> external_config_cache(
 static std::string buildExternalConfigCacheKey(
     const std::string &base_content, FetchContext context,
     unsigned long long config_generation) {
-  return getMD5(base_content) + ":" +
+  return getContentDigest(base_content) + ":" +
          std::to_string(static_cast<int>(context)) + ":" +
          std::to_string(config_generation) + ":" +
          kExternalConfigParserIdentity;
@@ -49,7 +49,8 @@ struct Settings {
   bool customOpenClashRulesSourceSwitch = false;
   static constexpr bool APIMode = true; // Hardcoded for security
   bool writeManagedConfig = false, enableRuleGen = true,
-       updateRulesetOnRequest = false, overwriteOriginalRules = true;
+       updateRulesetOnRequest = false, overwriteOriginalRules = true,
+       compactRules = false;
   bool printDbgInfo = false, CFWChildProcess = false, appendUserinfo = true,
        asyncFetchRuleset = false, surgeResolveHostname = true;
   // accessToken removed - token authentication is disabled
@@ -57,6 +58,9 @@ struct Settings {
   std::string custom_group;
   LogLevel logLevel = LOG_LEVEL_INFO;
   long maxAllowedDownloadSize = 1048576L;
+  // Soft memory limit for the embedded Mihomo Go runtime in MiB; 0 keeps the
+  // Go default (no limit).
+  long mihomoMemoryLimit = 0L;
   string_map aliases;
   std::string serveFileRoot;
 
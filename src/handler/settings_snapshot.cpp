@@ -93,6 +93,7 @@ std::string sanitizedSettingsSnapshot(const Settings &settings) {
            {"enabled", settings.enableRuleGen},
            {"overwrite_original", settings.overwriteOriginalRules},
            {"update_on_request", settings.updateRulesetOnRequest},
+           {"compact", settings.compactRules},
            {"ruleset_count", settings.customRulesets.size()},
            {"proxy_group_count", settings.customProxyGroups.size()},
        }},
@@ -110,6 +111,7 @@ std::string sanitizedSettingsSnapshot(const Settings &settings) {
            {"max_allowed_rulesets", settings.maxAllowedRulesets},
            {"max_allowed_rules", settings.maxAllowedRules},
            {"max_allowed_download_size", settings.maxAllowedDownloadSize},
+           {"mihomo_memory_limit", settings.mihomoMemoryLimit},
            {"cache_subscription", settings.cacheSubscription},
            {"cache_config", settings.cacheConfig},
            {"cache_ruleset", settings.cacheRuleset},
@@ -14,6 +14,7 @@
 
 #include <curl/curl.h>
 
+#include "config/ruleset.h"
 #include "handler/cocr_source_url.h"
 #include "handler/cache_storage.h"
 #include "handler/curl_handle_pool.h"
@@ -21,6 +22,8 @@
 #include "handler/settings_view.h"
 #include "server/client_ip.h"
 #include "utils/base64/base64.h"
+#include "utils/concurrent_lru_cache.h"
+#include "utils/content_digest.h"
 #include "utils/defer.h"
 #include "utils/file_extra.h"
 #include "utils/lock.h"
@@ -45,6 +48,42 @@ std::mutex cache_rw_lock;
 
 RWLock cache_rw_lock;
 
+// Ruleset bodies of cache files and their getContentDigest(), keyed by cache
+// path and modification time. A TTL hit on a file whose version is already
+// here shares that buffer and digest instead of reading and hashing the file
+// again; a rewritten file gets a new key and the old version ages out.
+constexpr size_t kCachedBodyEntries = 256;
+constexpr size_t kCachedBodyBytes = 64 * 1024 * 1024;
+static ConcurrentLruCache<std::string, RulesetBody> cached_bodies(
+    kCachedBodyEntries, kCachedBodyBytes);
+
+static RulesetBody makeRulesetBody(std::string content)
+{
+    RulesetBody body;
+    body.digest = getContentDigest(content);
+    body.content = std::make_shared<const std::string>(std::move(content));
+    return body;
+}
+
+static std::string cachedBodyKey(const std::string &path, time_t mtime)
+{
+    return path + ":" + std::to_string(static_cast<long long>(mtime));
+}
+
+// Returns the in-memory body of `path` at `mtime`, calling load() for it
+// the first time that version is asked for.
+template <class Load>
+static RulesetBody cachedBody(const std::string &path, time_t mtime, Load &&load)
+{
+    return cached_bodies.getOrCompute(
+        cachedBodyKey(path, mtime), true,
+        [&] { return makeRulesetBody(load()); },
+        [](const RulesetBody &value)
+            -> ConcurrentLruCache<std::string, RulesetBody>::CacheSize {
+            return value.content->size() + value.digest.size();
+        });
+}
+
 //std::string user_agent_str = "Mozilla/5.0 (Windows NT 10.0; Win64; x64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/74.0.3729.169 Safari/537.36";
 static auto user_agent_str = "clash.meta";
 
@@ -736,6 +775,8 @@ static void clear_fetch_output(FetchResult &result)
         result.response_headers->clear();
     if(result.cookies)
         result.cookies->clear();
+    if(result.body_sink)
+        result.body_sink->reset();
 }
 
 static int writer(char *data, size_t size, size_t nmemb, std::string *writerData)
@@ -748,6 +789,29 @@ static int writer(char *data, size_t size, size_t nmemb, std::string *writerData
     return static_cast<int>(size * nmemb);
 }
 
+struct body_writer_data
+{
+    std::string *content;
+    BodyChunkSink *sink;
+};
+
+static int body_writer(char *data, size_t size, size_t nmemb, body_writer_data *writerData)
+{
+    // Exceptions must not unwind through libcurl. Without the whole body the
+    // transfer is useless, so a failed append aborts it; sinks do not throw.
+    try
+    {
+        writerData->content->append(data, size*nmemb);
+        writerData->sink->consume(std::string_view(data, size*nmemb));
+    }
+    catch(...)
+    {
+        return 0;
+    }
+
+    return static_cast<int>(size * nmemb);
+}
+
 static int dummy_writer(char *, size_t size, size_t nmemb, void *)
 {
     /// dummy writer, do not save anything
@@ -1095,7 +1159,13 @@ static int curlGet(const FetchArgument &argument,
     if(header_list)
         curl_easy_setopt(curl_handle, CURLOPT_HTTPHEADER, header_list);
 
-    if(result.content)
+    body_writer_data body_data {result.content, result.body_sink};
+    if(result.content && result.body_sink)
+    {
+        curl_easy_setopt(curl_handle, CURLOPT_WRITEFUNCTION, body_writer);
+        curl_easy_setopt(curl_handle, CURLOPT_WRITEDATA, &body_data);
+    }
+    else if(result.content)
     {
         curl_easy_setopt(curl_handle, CURLOPT_WRITEFUNCTION, writer);
         curl_easy_setopt(curl_handle, CURLOPT_WRITEDATA, result.content);
@@ -1153,6 +1223,8 @@ static int curlGet(const FetchArgument &argument,
             result.content->clear();
         if(result.response_headers)
             result.response_headers->clear();
+        if(result.body_sink)
+            result.body_sink->reset();
         sleepMs(200);
         if(outbound_fetch_shutdown_requested.load(std::memory_order_relaxed))
             retVal = CURLE_ABORTED_BY_CALLBACK;
@@ -1211,7 +1283,11 @@ static int curlGet(const FetchArgument &argument,
     if(data && !argument.keep_resp_on_fail)
     {
         if(retVal != CURLE_OK || *result.status_code != 200)
+        {
             data->clear();
+            if(result.body_sink)
+                result.body_sink->reset();
+        }
     }
 
     return *result.status_code;
@@ -1320,7 +1396,10 @@ std::string buildSocks5ProxyString(const std::string &addr, int port, const std:
     return proxystr;
 }
 
-std::string webGet(const std::string &url, const ProxyPolicy &proxy, unsigned int cache_ttl, std::string *response_headers, string_icase_map *request_headers, FetchContext context)
+// webGet(). When `shared` is given, a body that comes from or goes into the
+// disk cache is handed back through it with its digest, shared with
+// cachedBody(), and the returned string is empty.
+static std::string webGetCached(const std::string &url, const ProxyPolicy &proxy, unsigned int cache_ttl, std::string *response_headers, string_icase_map *request_headers, FetchContext context, BodyChunkSink *body_sink, RulesetBody *shared)
 {
     int return_code = 0;
     std::string content;
@@ -1339,7 +1418,8 @@ std::string webGet(const std::string &url, const ProxyPolicy &proxy, unsigned in
     FetchArgument argument {HTTP_GET, effective_url, proxy, nullptr,
                             request_headers, nullptr, cache_ttl, false,
                             context};
-    FetchResult fetch_res {&return_code, &content, response_headers, nullptr};
+    FetchResult fetch_res {&return_code, &content, response_headers, nullptr,
+                           body_sink};
 
     if (startsWith(effective_url, "data:"))
         return dataGet(effective_url);
@@ -1371,6 +1451,13 @@ std::string webGet(const std::string &url, const ProxyPolicy &proxy, unsigned in
                 if(response_headers)
                     *response_headers =
                         readCachedResponseHeaders(path_header);
+                if(shared)
+                {
+                    *shared = cachedBody(path, mtime, [&path] {
+                        return fileGet(path, true);
+                    });
+                    return {};
+                }
                 return fileGet(path, true);
             }
             if(shouldLog(LOG_LEVEL_VERBOSE))
@@ -1410,9 +1497,11 @@ std::string webGet(const std::string &url, const ProxyPolicy &proxy, unsigned in
             try
             {
                 CacheFetchResult result;
+                // Only the owner of a shared fetch sees the bytes arrive;
+                // callers that join it get the finished body alone.
                 FetchResult fetch_result {
                     &result.status_code, &result.content,
-                    &result.response_headers, nullptr};
+                    &result.response_headers, nullptr, body_sink};
                 curlGetWithGitHubFallback(argument, proxy_snapshot,
                                           initial_route, fetch_result);
                 fetch_promise->set_value(std::move(result));
@@ -1459,6 +1548,22 @@ std::string webGet(const std::string &url, const ProxyPolicy &proxy, unsigned in
                              "CACHE_BODY_COMMITTED durability=confirmed "
                              "headers=invalidated; 本次已获取内容仍将直接返回。");
                 }
+                // The new file version starts out with this very buffer. It
+                // replaces rather than joins an entry, since a rewrite within
+                // the same second keeps the modification time.
+                struct stat written {};
+                if(shared && cache_update != CacheUpdateResult::Unchanged &&
+                   cache_update !=
+                       CacheUpdateResult::UnchangedHeadersInvalidated &&
+                   stat(path.data(), &written) == 0)
+                {
+                    *shared = makeRulesetBody(std::move(content));
+                    cached_bodies.put(cachedBodyKey(path, written.st_mtime),
+                                      *shared,
+                                      shared->content->size() +
+                                          shared->digest.size());
+                    return {};
+                }
             }
         }
         else
@@ -1491,12 +1596,29 @@ std::string webGet(const std::string &url, const ProxyPolicy &proxy, unsigned in
     return content;
 }
 
+std::string webGet(const std::string &url, const ProxyPolicy &proxy, unsigned int cache_ttl, std::string *response_headers, string_icase_map *request_headers, FetchContext context, BodyChunkSink *body_sink)
+{
+    return webGetCached(url, proxy, cache_ttl, response_headers,
+                        request_headers, context, body_sink, nullptr);
+}
+
+RulesetBody webGetRuleset(const std::string &url, const ProxyPolicy &proxy, unsigned int cache_ttl, FetchContext context)
+{
+    RulesetBody body;
+    std::string content = webGetCached(url, proxy, cache_ttl, nullptr, nullptr,
+                                       context, nullptr, &body);
+    if(!body.content)
+        body = makeRulesetBody(std::move(content));
+    return body;
+}
+
 void flushCache()
 {
     //guarded_mutex guard(cache_rw_lock);
     cache_rw_lock.writeLock();
     defer(cache_rw_lock.writeUnlock();)
     operateFiles("cache", [](const std::string &file){ remove(("cache/" + file).data()); return 0; });
+    cached_bodies.clear();
 }
 
 int webPost(const std::string &url, const std::string &data, const ProxyPolicy &proxy, const string_icase_map &request_headers, std::string *retData)
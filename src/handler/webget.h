@@ -2,6 +2,7 @@
 #define WEBGET_H_INCLUDED
 
 #include <string>
+#include <string_view>
 #include <map>
 
 #include "handler/fetch_context.h"
@@ -17,6 +18,8 @@ enum http_method
     HTTP_PATCH
 };
 
+struct RulesetBody;
+
 struct FetchArgument
 {
     const http_method method;
@@ -30,12 +33,24 @@ struct FetchArgument
     const FetchContext context = FetchContext::TrustedConfig;
 };
 
+// Observes a GET body while it is downloaded. The body is still collected
+// into FetchResult::content; reset() is called whenever the bytes delivered so
+// far are discarded (retry, fallback source or a failed transfer). consume()
+// runs inside libcurl's write callback and must not throw.
+struct BodyChunkSink
+{
+    virtual ~BodyChunkSink() = default;
+    virtual void consume(std::string_view chunk) = 0;
+    virtual void reset() = 0;
+};
+
 struct FetchResult
 {
     int *status_code;
     std::string *content = nullptr;
     std::string *response_headers = nullptr;
     std::string *cookies = nullptr;
+    BodyChunkSink *body_sink = nullptr;
 };
 
 int webGet(const FetchArgument& argument, FetchResult &result);
@@ -43,7 +58,15 @@ std::string webGet(const std::string &url, const ProxyPolicy &proxy,
                    unsigned int cache_ttl = 0,
                    std::string *response_headers = nullptr,
                    string_icase_map *request_headers = nullptr,
-                   FetchContext context = FetchContext::TrustedConfig);
+                   FetchContext context = FetchContext::TrustedConfig,
+                   BodyChunkSink *body_sink = nullptr);
+// webGet() for ruleset sources, with the body's getContentDigest(). Bodies
+// served from the disk cache are kept in memory with their digest per cache
+// file version, so a TTL hit shares one buffer and neither reads nor hashes
+// the file again.
+RulesetBody webGetRuleset(const std::string &url, const ProxyPolicy &proxy,
+                          unsigned int cache_ttl,
+                          FetchContext context = FetchContext::TrustedConfig);
 bool isFetchUrlAllowed(const std::string &url, FetchContext context);
 void requestOutboundFetchShutdown() noexcept;
 void flushCache();
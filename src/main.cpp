@@ -22,11 +22,13 @@
 #include "handler/statistics.h"
 #include "handler/version_page.h"
 #include "script/cron.h"
+#include "script/script_quickjs.h"
 #include "server/socket.h"
 #include "server/webserver.h"
 #include "utils/defer.h"
 #include "utils/logger.h"
 #include "utils/rapidjson_extra.h"
+#include "utils/regexp.h"
 #include "utils/system.h"
 #include "version.h"
 
@@ -180,7 +182,13 @@ void cron_tick_caller() {
 }
 
 void shutdown_runtime() {
+  const RegexCacheStats regex_stats = regexCacheStats();
+  writeLog(LOG_LEVEL_INFO,
+           "正则缓存统计：hits=" + std::to_string(regex_stats.hits) +
+               " misses=" + std::to_string(regex_stats.misses) +
+               " entries=" + std::to_string(regex_stats.entries) + "。");
   shutdownRulesetExecutor();
+  script_runtime_pool_shutdown();
   statistics::shutdown();
   shutdownGlobalCurlHandlePool();
 }
@@ -264,12 +272,26 @@ int main(int argc, char *argv[]) {
           std::to_string(externalConfigCacheMaxBytes()) + " bytes" +
           ", ruleset conversion cache=" +
           std::to_string(rulesetConversionCacheMaxEntries()) + " entries/" +
-          std::to_string(rulesetConversionCacheMaxBytes()) + " bytes。");
+          std::to_string(rulesetConversionCacheMaxBytes()) + " bytes" +
+          ", rendered ruleset cache=" +
+          std::to_string(renderedRulesetCacheMaxEntries()) + " entries/" +
+          std::to_string(renderedRulesetCacheMaxBytes()) + " bytes" +
+          ", /getruleset response cache=" +
+          std::to_string(rulesetResponseCacheMaxEntries()) + " entries/" +
+          std::to_string(rulesetResponseCacheMaxBytes()) + " bytes" +
+          ", regex cache=" + std::to_string(regexCacheMaxEntries()) +
+          " entries/" + std::to_string(regexCacheMaxBytes()) + " bytes" +
+          ", script runtime pool=" +
+          std::to_string(script_runtime_pool_capacity()) + "。");
   // Register cleanup before any background refresh starts. The HTTP backend
   // drains accepted requests before returning, so only then may the executor
   // cancel unobserved work and release its curl leases before the pool stops.
   defer(shutdown_runtime();)
   statistics::initialize();
+  // Isolated script runs and cron tasks take their runtimes from the pool;
+  // warm a couple so the first requests do not start QuickJS cold.
+  if (global.scriptCleanContext || global.enableCron)
+    script_runtime_pool_warm(2);
   // vfs::vfs_read("vfs.ini");
   if (!global.updateRulesetOnRequest)
     refreshRulesets(global.customRulesets, global.rulesetsContent);
@@ -0,0 +1,128 @@
+#include "clash_proxy_stream.h"
+
+#include <cstddef>
+
+#include "utils/request_arena.h"
+
+namespace {
+
+struct Line {
+  std::string_view text;
+  size_t indent = 0;
+  bool blank = false;
+};
+
+Line makeLine(std::string_view raw) {
+  if (!raw.empty() && raw.back() == '\r')
+    raw.remove_suffix(1);
+  Line line;
+  line.text = raw;
+  while (line.indent < raw.size() && raw[line.indent] == ' ')
+    line.indent++;
+  line.blank = line.indent == raw.size() || raw[line.indent] == '#';
+  return line;
+}
+
+bool isSequenceEntry(const Line &line) {
+  const std::string_view rest = line.text.substr(line.indent);
+  return !rest.empty() && rest.front() == '-' &&
+         (rest.size() == 1 || rest[1] == ' ' || rest[1] == '\t');
+}
+
+bool isDocumentMarker(std::string_view text) {
+  return text.substr(0, 3) == "---" || text.substr(0, 3) == "...";
+}
+
+// Matches `proxies:` / `Proxy:` (optionally quoted) at column 0 with nothing
+// but whitespace or a comment after the colon.
+bool isSectionHeader(std::string_view text, bool &inline_value) {
+  inline_value = false;
+  std::string_view key = text;
+  for (std::string_view name : {"proxies", "Proxy"}) {
+    for (std::string_view quote : {"", "\"", "'"}) {
+      const size_t key_len = name.size() + quote.size() * 2;
+      if (key.size() <= key_len || key[key_len] != ':')
+        continue;
+      if (key.substr(0, quote.size()) != quote ||
+          key.substr(quote.size(), name.size()) != name ||
+          key.substr(quote.size() + name.size(), quote.size()) != quote)
+        continue;
+      std::string_view rest = key.substr(key_len + 1);
+      if (!rest.empty() && rest.front() != ' ' && rest.front() != '\t')
+        continue;
+      size_t pos = rest.find_first_not_of(" \t");
+      inline_value = pos != std::string_view::npos && rest[pos] != '#';
+      return true;
+    }
+  }
+  return false;
+}
+
+} // namespace
+
+bool forEachClashProxyItem(
+    std::string_view content,
+    const std::function<void(const std::pmr::string &item)> &on_item) {
+  size_t pos = 0;
+  auto nextLine = [&](Line &line) {
+    if (pos >= content.size())
+      return false;
+    size_t end = content.find('\n', pos);
+    if (end == std::string_view::npos)
+      end = content.size();
+    line = makeLine(content.substr(pos, end - pos));
+    pos = end + 1;
+    return true;
+  };
+
+  Line line;
+  bool found = false;
+  while (nextLine(line)) {
+    if (line.indent != 0 || line.blank)
+      continue;
+    bool inline_value = false;
+    if (isSectionHeader(line.text, inline_value)) {
+      if (inline_value)
+        return false;
+      found = true;
+      break;
+    }
+  }
+  if (!found)
+    return false;
+
+  std::pmr::string item(requestMemoryResource());
+  size_t sequence_indent = std::string_view::npos;
+  auto flush = [&]() {
+    if (item.empty())
+      return;
+    on_item(item);
+    item.clear();
+  };
+
+  while (nextLine(line)) {
+    if (line.blank) {
+      if (!item.empty())
+        item += '\n';
+      continue;
+    }
+    if (line.indent == 0 && isDocumentMarker(line.text))
+      break;
+    if (sequence_indent == std::string_view::npos) {
+      if (!isSequenceEntry(line))
+        break;
+      sequence_indent = line.indent;
+    }
+    if (line.indent < sequence_indent)
+      break;
+    if (line.indent == sequence_indent) {
+      if (!isSequenceEntry(line))
+        break;
+      flush();
+    }
+    item.append(line.text.substr(sequence_indent));
+    item += '\n';
+  }
+  flush();
+  return true;
+}
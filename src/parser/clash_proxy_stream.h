@@ -0,0 +1,23 @@
+#ifndef CLASH_PROXY_STREAM_H_INCLUDED
+#define CLASH_PROXY_STREAM_H_INCLUDED
+
+#include <functional>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+
+// Locates the top-level block-style `proxies:` or `Proxy:` sequence of a Clash
+// document and hands every item to `on_item` as a standalone YAML snippet
+// ("- key: value" at column 0), one at a time and in document order. Nothing
+// outside the section is parsed, so rules and other large sections cost only
+// one line scan. The item buffer is request-local scratch taken from
+// requestMemoryResource() and reused between items.
+//
+// Returns false when no such section exists or it is written in flow style
+// (`proxies: [...]`); callers then fall back to loading the whole document.
+// A section that is present but empty still returns true.
+bool forEachClashProxyItem(
+    std::string_view content,
+    const std::function<void(const std::pmr::string &item)> &on_item);
+
+#endif // CLASH_PROXY_STREAM_H_INCLUDED
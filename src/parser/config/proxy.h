@@ -5,6 +5,7 @@
 #include <utility>
 #include <vector>
 
+#include "utils/interned_string.h"
 #include "utils/tribool.h"
 
 using String = std::string;
@@ -79,15 +80,31 @@ inline String getProxyTypeName(ProxyType type) {
   }
 }
 
+// Shared defaults, so constructing a Proxy does not allocate them.
+inline const InternedString &defaultAllowedIPs() {
+  static const InternedString value("0.0.0.0/0, ::/0");
+  return value;
+}
+
+inline const InternedString &defaultUdpRelayMode() {
+  static const InternedString value("native");
+  return value;
+}
+
+// Group and the protocol-specific fields that most nodes leave empty are
+// InternedString, so they cost one pointer and repeated values share a
+// buffer. Fields the generators bind to a mutable std::string & (Remark,
+// Hostname, credentials, cipher, plugin, transport, Host, Path, ...) stay
+// plain strings.
 struct Proxy {
   ProxyType Type = ProxyType::Unknown;
   uint32_t Id = 0;
   uint32_t GroupId = 0;
-  String Group;
+  InternedString Group;
   String Remark;
   String Hostname;
   uint16_t Port = 0;
-  String CongestionControl;
+  InternedString CongestionControl;
   String Username;
   String Password;
   String EncryptMethod;
@@ -101,7 +118,7 @@ struct Proxy {
   uint16_t AlterId = 0;
   String TransferProtocol;
   String FakeType;
-  String AuthStr;
+  InternedString AuthStr;
   uint16_t IdleSessionCheckInterval = 30;
   uint16_t IdleSessionTimeout = 30;
   uint16_t MinIdleSession = 0;
@@ -126,52 +143,52 @@ struct Proxy {
 
   uint16_t SnellVersion = 0;
   tribool SnellReuse;
-  String SnellUserKey;
+  InternedString SnellUserKey;
   // Empty means both TCP and UDP; otherwise sing-box accepts tcp or udp.
-  String SnellNetwork;
-  String SnellMode;
+  InternedString SnellNetwork;
+  InternedString SnellMode;
   uint16_t SnellUDPPort = 0;
-  String ShadowTLSPassword;
+  InternedString ShadowTLSPassword;
   String ShadowTLSSNI;
   uint16_t ShadowTLSVersion = 0;
   String ServerName;
 
-  String SelfIP;
-  String SelfIPv6;
+  InternedString SelfIP;
+  InternedString SelfIPv6;
   String PublicKey;
-  String PrivateKey;
-  String PreSharedKey;
+  InternedString PrivateKey;
+  InternedString PreSharedKey;
   StringArray DnsServers;
   uint16_t Mtu = 0;
-  String AllowedIPs = "0.0.0.0/0, ::/0";
+  InternedString AllowedIPs = defaultAllowedIPs();
   uint16_t KeepAlive = 0;
-  String TestUrl;
-  String ClientId;
+  InternedString TestUrl;
+  InternedString ClientId;
   // WireGuard historically projected only one peer into the fields above.
   // Keep that projection for existing scripts and generators, while retaining
   // the complete structured configuration for multi-peer targets.
   std::vector<WireGuardPeer> WireGuardPeers;
   StringArray WireGuardLocalAddresses;
-  String WireGuardInterfaceName;
+  InternedString WireGuardInterfaceName;
   tribool WireGuardSystem;
   uint16_t WireGuardListenPort = 0;
   uint16_t WireGuardWorkers = 0;
-  String Ports;
-  String Auth;
-  String Alpn;
-  String UpMbps;
-  String DownMbps;
-  String HysteriaHopInterval;
-  String Insecure;
+  InternedString Ports;
+  InternedString Auth;
+  InternedString Alpn;
+  InternedString UpMbps;
+  InternedString DownMbps;
+  InternedString HysteriaHopInterval;
+  InternedString Insecure;
   String Fingerprint;
   String OBFSPassword;
-  String Hysteria2RealmUrl;
-  String Hysteria2GeckoMinPacketSize;
-  String Hysteria2GeckoMaxPacketSize;
+  InternedString Hysteria2RealmUrl;
+  InternedString Hysteria2GeckoMinPacketSize;
+  InternedString Hysteria2GeckoMaxPacketSize;
   // Hysteria 2 URI-only ECH config. It is preserved for standards-compliant
   // single-link round trips and is not projected into clients whose legacy
   // generators cannot represent it safely.
-  String Hysteria2ECH;
+  InternedString Hysteria2ECH;
   // URI port hopping stores the first port in Port and the remaining ranges in
   // Ports. Native config imports generally store the complete range in Ports.
   bool Hysteria2PortsAreAdditional = false;
@@ -179,30 +196,30 @@ struct Proxy {
   String GRPCMode;
   String ShortId;
   String Flow;
-  String Encryption;
+  InternedString Encryption;
   bool FlowShow = false;
   tribool DisableSni;
   uint32_t UpSpeed;
   uint32_t DownSpeed;
-  String SNI;
+  InternedString SNI;
   tribool ReduceRtt;
-  String UdpRelayMode = "native";
+  InternedString UdpRelayMode = defaultUdpRelayMode();
   uint16_t RequestTimeout = 15000;
-  String token;
+  InternedString token;
   String UnderlyingProxy;
   std::vector<String> AlpnList;
   String PacketEncoding;
-  String Multiplexing;
+  InternedString Multiplexing;
   // Metadata from one official mierus:// resource. Legacy parsing expands
   // every port/protocol binding into a Proxy, while Shadowrocket needs the
   // original resource boundary to emit one lossless sharing link again.
-  String MieruProfile;
-  String MieruSourceId;
-  String MieruSourceRemark;
+  InternedString MieruProfile;
+  InternedString MieruSourceId;
+  InternedString MieruSourceRemark;
   uint32_t MieruBindingIndex = 0;
   bool MieruHasUnknownParameters = false;
-  String MieruHandshakeMode;
-  String MieruTrafficPattern;
+  InternedString MieruHandshakeMode;
+  InternedString MieruTrafficPattern;
   tribool V2rayHttpUpgrade;
 
   // Recognized Xray share-link options that do not yet have a portable field
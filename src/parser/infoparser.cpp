@@ -1,9 +1,11 @@
+#include <memory>
 #include <string>
 #include <vector>
 #include <cmath>
 #include <ctime>
 
 #include "config/regmatch.h"
+#include "parser/infoparser.h"
 #include "parser/config/proxy.h"
 #include "utils/base64/base64.h"
 #include "utils/rapidjson_extra.h"
@@ -85,50 +87,54 @@ bool getSubInfoFromHeader(const std::string &header, std::string &result)
     return false;
 }
 
+static std::vector<SubInfoRules::Rule> compileRules(const RegexMatchConfigs &configs)
+{
+    std::vector<SubInfoRules::Rule> rules;
+    rules.reserve(configs.size());
+    for(const RegexMatchConfig &x : configs)
+    {
+        FullMatchRegex match(x.Match);
+        if(match.valid())
+            rules.push_back({std::move(match), x.Replace});
+    }
+    return rules;
+}
+
+std::shared_ptr<const SubInfoRules> compileSubInfoRules(const RegexMatchConfigs &stream_rules, const RegexMatchConfigs &time_rules)
+{
+    auto rules = std::make_shared<SubInfoRules>();
+    rules->stream = compileRules(stream_rules);
+    rules->time = compileRules(time_rules);
+    return rules;
+}
+
+// First rule whose whole-remark match rewrites `remark` into something else.
+static bool applyFirstRule(const std::vector<SubInfoRules::Rule> &rules, const std::string &remark, std::string &info)
+{
+    for(const SubInfoRules::Rule &x : rules)
+    {
+        if(x.match.replace(remark, x.replace, info) && info != remark)
+            return true;
+    }
+    info.clear();
+    return false;
+}
+
 bool getSubInfoFromNodes(const std::vector<Proxy> &nodes, const RegexMatchConfigs &stream_rules, const RegexMatchConfigs &time_rules, std::string &result)
 {
-    std::string remarks, stream_info, time_info, retStr;
+    return getSubInfoFromNodes(nodes, *compileSubInfoRules(stream_rules, time_rules), result);
+}
+
+bool getSubInfoFromNodes(const std::vector<Proxy> &nodes, const SubInfoRules &rules, std::string &result)
+{
+    std::string stream_info, time_info;
 
     for(const Proxy &x : nodes)
     {
-        remarks = x.Remark;
         if(stream_info.empty())
-        {
-            for(const RegexMatchConfig &y : stream_rules)
-            {
-                if(regMatch(remarks, y.Match))
-                {
-                    retStr = regReplace(remarks, y.Match, y.Replace);
-                    if(retStr != remarks)
-                    {
-                        stream_info = retStr;
-                        break;
-                    }
-                }
-                else
-                    continue;
-            }
-        }
-
-        remarks = x.Remark;
+            applyFirstRule(rules.stream, x.Remark, stream_info);
         if(time_info.empty())
-        {
-            for(const RegexMatchConfig &y : time_rules)
-            {
-                if(regMatch(remarks, y.Match))
-                {
-                    retStr = regReplace(remarks, y.Match, y.Replace);
-                    if(retStr != remarks)
-                    {
-                        time_info = retStr;
-                        break;
-                    }
-                }
-                else
-                    continue;
-            }
-        }
-
+            applyFirstRule(rules.time, x.Remark, time_info);
         if(!stream_info.empty() && !time_info.empty())
             break;
     }
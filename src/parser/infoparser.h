@@ -1,13 +1,33 @@
 #ifndef INFOPARSER_H_INCLUDED
 #define INFOPARSER_H_INCLUDED
 
+#include <memory>
 #include <string>
+#include <vector>
 
+#include "utils/regexp.h"
 #include "utils/string.h"
 #include "config/proxy.h"
 #include "config/regmatch.h"
 
+// Stream and time rules compiled once, so extracting subscription info from a
+// node list costs one anchored match per rule and remark.
+struct SubInfoRules
+{
+    struct Rule
+    {
+        FullMatchRegex match;
+        std::string replace;
+    };
+
+    std::vector<Rule> stream;
+    std::vector<Rule> time;
+};
+
+std::shared_ptr<const SubInfoRules> compileSubInfoRules(const RegexMatchConfigs &stream_rules, const RegexMatchConfigs &time_rules);
+
 bool getSubInfoFromHeader(const std::string &header, std::string &result);
+bool getSubInfoFromNodes(const std::vector<Proxy> &nodes, const SubInfoRules &rules, std::string &result);
 bool getSubInfoFromNodes(const std::vector<Proxy> &nodes, const RegexMatchConfigs &stream_rules, const RegexMatchConfigs &time_rules, std::string &result);
 bool getSubInfoFromSSD(const std::string &sub, std::string &result);
 unsigned long long streamToInt(const std::string &stream);
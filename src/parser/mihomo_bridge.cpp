@@ -1,71 +1,60 @@
 #include "mihomo_bridge.h"
 #include <nlohmann/json.hpp>
-#include <chrono>
+#include <algorithm>
 #include <memory>
-#include <mutex>
 #include <stdexcept>
+#include <string_view>
 #include <utility>
 
 // Go library functions (generated from libconvert.h)
 extern "C" {
 char *ConvertSubscription(char *data);
+char *ConvertSubscriptions(char *data);
+char *ConvertRulesetToMrs(char *data, char *behavior, long long *length);
 char *ResolveAgeRecipient(char *key);
 char *EncryptAgeArmored(char *data, char *recipient);
-void ReleaseUnusedMemory();
+long long SetMemoryLimit(long long limit);
 void FreeString(char *s);
 }
 
 namespace {
 
-constexpr size_t kLargeSubscriptionThreshold = 256 * 1024;
-constexpr auto kGoMemoryReleaseInterval = std::chrono::seconds(30);
-
-void releaseGoMemoryAfterLargeParse(size_t subscription_size) noexcept {
-  if (subscription_size < kLargeSubscriptionThreshold)
-    return;
-
-  try {
-    static std::mutex release_mutex;
-    static std::chrono::steady_clock::time_point last_release;
-    static bool released_once = false;
-
-    std::unique_lock<std::mutex> lock(release_mutex, std::try_to_lock);
-    if (!lock.owns_lock())
-      return;
-
-    auto now = std::chrono::steady_clock::now();
-    if (released_once && now - last_release < kGoMemoryReleaseInterval)
-      return;
-
-    ReleaseUnusedMemory();
-    last_release = now;
-    released_once = true;
-  } catch (...) {
-    // Memory reclamation is opportunistic and must never fail a conversion.
+int parsePort(const nlohmann::json &item) {
+  if (!item.contains("port"))
+    return 0;
+  const auto &port = item["port"];
+  if (port.is_number())
+    return port.get<int>();
+  if (port.is_string()) {
+    try {
+      return std::stoi(port.get<std::string>());
+    } catch (...) {
+      return 0;
+    }
   }
+  return 0;
 }
 
-class LargeParseMemoryGuard {
-public:
-  explicit LargeParseMemoryGuard(size_t subscription_size)
-      : subscription_size_(subscription_size) {}
-
-  ~LargeParseMemoryGuard() {
-    releaseGoMemoryAfterLargeParse(subscription_size_);
+std::vector<mihomo::ProxyNode> nodesFromJson(const nlohmann::json &proxies) {
+  std::vector<mihomo::ProxyNode> nodes;
+  nodes.reserve(proxies.size());
+  for (const auto &item : proxies) {
+    mihomo::ProxyNode node;
+    node.name = item.value("name", "");
+    node.type = item.value("type", "");
+    node.server = item.value("server", "");
+    node.port = parsePort(item);
+    node.canonical_json = item.dump();
+    nodes.emplace_back(std::move(node));
   }
-
-private:
-  size_t subscription_size_;
-};
+  return nodes;
+}
 
 } // namespace
 
 namespace mihomo {
 
 std::vector<ProxyNode> parseSubscription(const std::string &subscription) {
-  std::vector<ProxyNode> nodes;
-  LargeParseMemoryGuard memory_guard(subscription.size());
-
   // Call Go function
   char *raw_result =
       ConvertSubscription(const_cast<char *>(subscription.c_str()));
@@ -84,40 +73,54 @@ std::vector<ProxyNode> parseSubscription(const std::string &subscription) {
       throw std::runtime_error("Mihomo 解析器错误：" + error);
     }
 
-    // Parse proxy array
-    nodes.reserve(json_result.size());
-    for (const auto &item : json_result) {
-      ProxyNode node;
-      node.name = item.value("name", "");
-      node.type = item.value("type", "");
-      node.server = item.value("server", "");
-      node.canonical_json = item.dump();
-
-      // Port: handle both number and string
-      if (item.contains("port")) {
-        if (item["port"].is_number()) {
-          node.port = item["port"].get<int>();
-        } else if (item["port"].is_string()) {
-          try {
-            node.port = std::stoi(item["port"].get<std::string>());
-          } catch (...) {
-            node.port = 0;
-          }
-        } else {
-          node.port = 0;
-        }
-      } else {
-        node.port = 0;
-      }
+    return nodesFromJson(json_result);
+  } catch (const nlohmann::json::exception &e) {
+    throw std::runtime_error(std::string("JSON 解析错误：") + e.what());
+  }
+}
 
-      nodes.emplace_back(std::move(node));
-    }
+std::vector<SubscriptionResult>
+parseSubscriptions(const std::vector<std::string> &subscriptions) {
+  std::vector<SubscriptionResult> results(subscriptions.size());
+  if (subscriptions.empty())
+    return results;
 
+  const std::string payload = nlohmann::json(subscriptions).dump(
+      -1, ' ', false, nlohmann::json::error_handler_t::replace);
+  char *raw_result = ConvertSubscriptions(const_cast<char *>(payload.c_str()));
+  if (!raw_result) {
+    throw std::runtime_error("调用 Go ConvertSubscriptions 函数失败");
+  }
+  std::unique_ptr<char, decltype(&FreeString)> result(raw_result, &FreeString);
+
+  try {
+    auto json_result = nlohmann::json::parse(result.get());
+    if (json_result.is_object() && json_result.contains("error")) {
+      std::string error = json_result["error"];
+      throw std::runtime_error("Mihomo 解析器错误：" + error);
+    }
+    if (!json_result.is_array() || json_result.size() != subscriptions.size())
+      throw std::runtime_error("Mihomo 批量解析结果数量不匹配");
+
+    for (size_t i = 0; i < results.size(); ++i) {
+      const auto &item = json_result[i];
+      if (item.contains("error")) {
+        results[i].error =
+            "Mihomo 解析器错误：" + item.value("error", std::string());
+        continue;
+      }
+      auto proxies = item.find("proxies");
+      if (proxies != item.end() && proxies->is_array())
+        results[i].nodes = nodesFromJson(*proxies);
+    }
   } catch (const nlohmann::json::exception &e) {
     throw std::runtime_error(std::string("JSON 解析错误：") + e.what());
   }
+  return results;
+}
 
-  return nodes;
+long long setMemoryLimit(long long limit_bytes) noexcept {
+  return SetMemoryLimit(limit_bytes > 0 ? limit_bytes : 0);
 }
 
 bool isMihomoParserAvailable() {
@@ -156,6 +159,27 @@ AgeRecipient resolveAgeRecipient(const std::string &key) {
   return resolved;
 }
 
+std::string convertRulesetToMrs(const std::string &payload,
+                                const std::string &behavior) {
+  long long length = 0;
+  char *raw_result =
+      ConvertRulesetToMrs(const_cast<char *>(payload.c_str()),
+                          const_cast<char *>(behavior.c_str()), &length);
+  if (!raw_result)
+    throw std::runtime_error("调用 Go ConvertRulesetToMrs 函数失败");
+  std::unique_ptr<char, decltype(&FreeString)> result(raw_result, &FreeString);
+
+  const std::string_view output(result.get(), static_cast<size_t>(length));
+  if (output == "EMPTY\n")
+    return {};
+  if (output.rfind("OK\n", 0) != 0) {
+    const std::string_view error = output.substr(std::min<size_t>(
+        output.size(), std::string_view("ERROR\n").size()));
+    throw std::runtime_error("mrs 规则集转换失败：" + std::string(error));
+  }
+  return std::string(output.substr(3));
+}
+
 std::string encryptAgeArmored(const std::string &data,
                               const std::string &recipient) {
   char *result = EncryptAgeArmored(const_cast<char *>(data.c_str()),
@@ -29,6 +29,49 @@ struct ProxyNode {
  */
 std::vector<ProxyNode> parseSubscription(const std::string &subscription);
 
+/**
+ * @brief Per-body result of a batched parse
+ *
+ * A non-empty error means the body failed; the other bodies in the batch are
+ * unaffected.
+ */
+struct SubscriptionResult {
+  std::vector<ProxyNode> nodes;
+  std::string error;
+};
+
+/**
+ * @brief Parse several subscription bodies in one bridge call
+ *
+ * The Go side parses the bodies concurrently and the results keep the input
+ * order.
+ *
+ * @param subscriptions Subscription bodies, same formats as parseSubscription
+ * @return One result per input body
+ * @throws std::runtime_error if the bridge call itself fails
+ */
+std::vector<SubscriptionResult>
+parseSubscriptions(const std::vector<std::string> &subscriptions);
+
+/**
+ * @brief Encode a rule-provider YAML payload in Mihomo's binary mrs format
+ *
+ * @param payload "payload:" YAML of a domain or ipcidr rule-provider
+ * @param behavior "domain" or "ipcidr"
+ * @return The mrs file contents, or an empty string when no rule of the
+ *         payload is valid for `behavior`
+ * @throws std::runtime_error if the payload cannot be converted
+ */
+std::string convertRulesetToMrs(const std::string &payload,
+                                const std::string &behavior);
+
+/**
+ * @brief Set the soft memory limit of the embedded Go runtime
+ * @param limit_bytes Limit in bytes; 0 or less removes the limit
+ * @return The limit that was in effect before the call
+ */
+long long setMemoryLimit(long long limit_bytes) noexcept;
+
 /**
  * @brief Check if mihomo parser is available
  * @return true if the Go library is properly linked
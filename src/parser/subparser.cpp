@@ -17,6 +17,7 @@
 #include "utils/urlencode.h"
 #include "utils/yamlcpp_extra.h"
 #include "config/proxy.h"
+#include "clash_proxy_stream.h"
 #include "mieru_uri.h"
 #include "subparser.h"
 #include "utils/logger.h"
@@ -2776,6 +2777,25 @@ void explodeClash(Node yamlnode, std::vector<Proxy> &nodes) {
     }
 }
 
+static bool explodeClashStream(const std::string &content, std::vector<Proxy> &nodes) {
+    // Load one sequence item at a time so only a single proxy mapping is ever
+    // held as a yaml-cpp tree; each item goes through explodeClash() as a
+    // one-entry proxies section. Anchors shared between items cannot resolve
+    // in isolation; such documents fall back to the whole-section loader.
+    const size_t before = nodes.size();
+    try {
+        return forEachClashProxyItem(content, [&](const std::pmr::string &item) {
+            Node section;
+            section["proxies"] = Load(item.c_str());
+            if (section["proxies"].IsSequence() && section["proxies"].size() == 1)
+                explodeClash(section, nodes);
+        });
+    } catch (const YAML::Exception &) {
+        nodes.erase(nodes.begin() + static_cast<std::ptrdiff_t>(before), nodes.end());
+        return false;
+    }
+}
+
 void explodeStdVMess(std::string vmess, Proxy &node) {
     ParsedShareUri parsed;
     if (parseShareUri(vmess, "vmess", parsed) && isXrayUuid(parsed.user)) {
@@ -5908,7 +5928,11 @@ void explodeSub(std::string sub, std::vector<Proxy> &nodes) {
 
     //try to parse as clash configuration
     try {
-        if (!processed && regFind(sub, "\"?(Proxy|proxies)\"?:")) {
+        const bool has_proxy_section =
+            !processed && regFind(sub, "\"?(Proxy|proxies)\"?:");
+        if (has_proxy_section)
+            processed = explodeClashStream(sub, nodes);
+        if (has_proxy_section && !processed) {
             regGetMatch(sub, R"(^(?:Proxy|proxies):$\s(?:(?:^ +?.*$| *?-.*$|)\s?)+)", 1, &sub);
             Node yamlnode = Load(sub);
             if (yamlnode.size() && (yamlnode["Proxy"].IsDefined() || yamlnode["proxies"].IsDefined())) {
@@ -5952,27 +5976,33 @@ void explodeSub(std::string sub, std::vector<Proxy> &nodes) {
     //try to parse as normal subscription
     if (!processed) {
         sub = urlSafeBase64Decode(sub);
-        if (sub.find("[Proxy]") != std::string::npos ||
-            regFind(sub, "(?i)(vmess|vless|shadowsocks|hysteria2|anytls|http|trojan)\\s*?=")) {
+        if (looksLikeSurgeProxyList(sub)) {
             if (explodeSurge(sub, nodes))
                 return;
         }
         strstream << sub;
         char delimiter =
                 count(sub.begin(), sub.end(), '\n') < 1 ? count(sub.begin(), sub.end(), '\r') < 1 ? ' ' : '\r' : '\n';
-        while (getline(strstream, strLink, delimiter)) {
-            if (strLink.rfind('\r') != std::string::npos)
-                strLink.erase(strLink.size() - 1);
-            if (startsWith(strLink, "mierus://")) {
-                explodeMierusNodes(strLink, nodes);
-                continue;
-            }
-            Proxy node;
-            explode(strLink, node);
-            if (strLink.empty() || node.Type == ProxyType::Unknown) {
-                continue;
-            }
-            nodes.emplace_back(std::move(node));
-        }
+        while (getline(strstream, strLink, delimiter))
+            explodeSubLine(strLink, nodes);
     }
 }
+
+bool looksLikeSurgeProxyList(const std::string &decoded) {
+    return decoded.find("[Proxy]") != std::string::npos ||
+           regFind(decoded, "(?i)(vmess|vless|shadowsocks|hysteria2|anytls|http|trojan)\\s*?=");
+}
+
+void explodeSubLine(std::string &line, std::vector<Proxy> &nodes) {
+    if (line.rfind('\r') != std::string::npos)
+        line.erase(line.size() - 1);
+    if (startsWith(line, "mierus://")) {
+        explodeMierusNodes(line, nodes);
+        return;
+    }
+    Proxy node;
+    explode(line, node);
+    if (line.empty() || node.Type == ProxyType::Unknown)
+        return;
+    nodes.emplace_back(std::move(node));
+}
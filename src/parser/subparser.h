@@ -5,6 +5,10 @@
 
 #include "config/proxy.h"
 
+namespace YAML {
+class Node;
+}
+
 enum class ConfType {
     Unknow,
     SS,
@@ -153,8 +157,16 @@ void explode(const std::string &link, Proxy &node);
 
 void explodeSSD(std::string link, std::vector<Proxy> &nodes);
 
+void explodeClash(YAML::Node yamlnode, std::vector<Proxy> &nodes);
+
 void explodeSub(std::string sub, std::vector<Proxy> &nodes);
 
+/// True when decoded subscription text has to go through explodeSurge()
+bool looksLikeSurgeProxyList(const std::string &decoded);
+
+/// Parse one line of a decoded link-list subscription
+void explodeSubLine(std::string &line, std::vector<Proxy> &nodes);
+
 int explodeConf(const std::string &filepath, std::vector<Proxy> &nodes);
 
 int explodeConfContent(const std::string &content, std::vector<Proxy> &nodes);
@@ -0,0 +1,114 @@
+#include "subscription_stream.h"
+
+#include <utility>
+
+namespace {
+
+// Decoded value of a url-safe base64 symbol, or -1 for any other byte.
+int base64Value(unsigned char ch) {
+  if (ch >= 'A' && ch <= 'Z')
+    return ch - 'A';
+  if (ch >= 'a' && ch <= 'z')
+    return ch - 'a' + 26;
+  if (ch >= '0' && ch <= '9')
+    return ch - '0' + 52;
+  if (ch == '+' || ch == '-')
+    return 62;
+  if (ch == '/' || ch == '_')
+    return 63;
+  return -1;
+}
+
+bool isLineSpace(unsigned char ch) {
+  return ch == '\n' || ch == '\r' || ch == ' ' || ch == '\t';
+}
+
+} // namespace
+
+Base64LineStream::Base64LineStream(LineHandler on_line)
+    : on_line_(std::move(on_line)) {}
+
+void Base64LineStream::emit(char ch) {
+  if (ch != '\n') {
+    line_ += ch;
+    return;
+  }
+  saw_newline_ = true;
+  if (!on_line_(line_))
+    abandoned_ = true;
+  line_.clear();
+}
+
+void Base64LineStream::flushQuad() {
+  if (!quad_size_)
+    return;
+  // Same tail handling as base64Decode(): missing symbols count as zero and
+  // a group of n symbols yields n - 1 bytes.
+  for (size_t i = quad_size_; i < 4; i++)
+    quad_[i] = 0;
+  const char bytes[3] = {
+      static_cast<char>((quad_[0] << 2) + ((quad_[1] & 0x30) >> 4)),
+      static_cast<char>(((quad_[1] & 0xf) << 4) + ((quad_[2] & 0x3c) >> 2)),
+      static_cast<char>(((quad_[2] & 0x3) << 6) + quad_[3])};
+  const size_t count = quad_size_ == 4 ? 3 : quad_size_ - 1;
+  quad_size_ = 0;
+  for (size_t i = 0; i < count && !abandoned_; i++)
+    emit(bytes[i]);
+}
+
+void Base64LineStream::feed(std::string_view chunk) {
+  consumed_ += chunk.size();
+  for (const char raw : chunk) {
+    if (abandoned_)
+      return;
+    const auto ch = static_cast<unsigned char>(raw);
+    const int value = base64Value(ch);
+    if (value < 0 && ch != '=' && !isLineSpace(ch)) {
+      abandoned_ = true;
+      return;
+    }
+    // base64Decode() stops at the first '=' and ignores the remainder, which
+    // is still checked above so the buffered format detection cannot differ.
+    if (padded_)
+      continue;
+    if (ch == '=') {
+      flushQuad();
+      padded_ = true;
+    } else if (value < 0) {
+      // Separators are copied through and drop an incomplete group.
+      quad_size_ = 0;
+      emit(raw);
+    } else {
+      quad_[quad_size_++] = static_cast<unsigned char>(value);
+      if (quad_size_ == 4)
+        flushQuad();
+    }
+  }
+}
+
+bool Base64LineStream::finish() {
+  if (abandoned_)
+    return false;
+  if (!padded_)
+    flushQuad();
+  if (abandoned_ || !saw_newline_)
+    return false;
+  if (!line_.empty() && !on_line_(line_))
+    abandoned_ = true;
+  line_.clear();
+  return !abandoned_;
+}
+
+void Base64LineStream::abandon() {
+  abandoned_ = true;
+  std::string().swap(line_);
+}
+
+void Base64LineStream::reset() {
+  line_.clear();
+  quad_size_ = 0;
+  consumed_ = 0;
+  padded_ = false;
+  saw_newline_ = false;
+  abandoned_ = false;
+}
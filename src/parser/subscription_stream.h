@@ -0,0 +1,52 @@
+#ifndef SUBSCRIPTION_STREAM_H_INCLUDED
+#define SUBSCRIPTION_STREAM_H_INCLUDED
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <string_view>
+
+// Incremental decoder for base64-encoded link-list subscriptions. Bytes are
+// fed as they arrive from the network; decoded text is split on '\n' and every
+// complete line is handed to `on_line` without waiting for the rest of the
+// body. Decoding matches urlSafeBase64Decode() byte for byte, so the lines are
+// exactly those the buffered parser would see.
+//
+// The stream gives up (abandoned() becomes true) as soon as the body cannot be
+// a plain base64 link list: a byte outside the url-safe base64 alphabet and
+// whitespace, or `on_line` returning false. finish() also reports false when
+// the decoded text never contained '\n', because the buffered parser would pick
+// a different delimiter. Callers then discard what the handler produced and
+// parse the buffered body instead.
+class Base64LineStream {
+public:
+  using LineHandler = std::function<bool(std::string &line)>;
+
+  explicit Base64LineStream(LineHandler on_line);
+
+  void feed(std::string_view chunk);
+  bool finish();
+  // Forgets everything fed so far, for transfers that are retried.
+  void reset();
+  // Gives up on the stream from outside, e.g. when the line handler failed.
+  // Later chunks are still counted but no longer decoded.
+  void abandon();
+
+  size_t consumed() const { return consumed_; }
+  bool abandoned() const { return abandoned_; }
+
+private:
+  void emit(char ch);
+  void flushQuad();
+
+  LineHandler on_line_;
+  std::string line_;
+  unsigned char quad_[4] = {};
+  size_t quad_size_ = 0;
+  size_t consumed_ = 0;
+  bool padded_ = false;
+  bool saw_newline_ = false;
+  bool abandoned_ = false;
+};
+
+#endif // SUBSCRIPTION_STREAM_H_INCLUDED
@@ -39,12 +39,11 @@ void refresh_schedule() {
   cron.clear_schedules();
   for (const CronTaskConfig &x : global.cronTasks) {
     cron.add_schedule(x.Name, x.CronExp, [=](auto &) {
-      qjs::Runtime runtime;
-      qjs::Context context(runtime);
+      ScriptRuntimeLease lease;
+      qjs::Context &context = lease.context();
+      script_info info;
       try {
-        script_runtime_init(runtime);
-        script_context_init(context);
-        defer(script_cleanup(context);) ProxyPolicy proxy =
+        defer(lease.runPendingJobs();) ProxyPolicy proxy =
             parseProxy(global.proxyConfig, global.proxyBypass);
         std::string script = fetchFile(x.Path, proxy, global.cacheConfig);
         if (script.empty()) {
@@ -52,7 +51,6 @@ void refresh_schedule() {
                    "脚本 '" + x.Name + "' 运行失败：文件为空或不存在！");
           return;
         }
-        script_info info;
         if (x.Timeout > 0) {
           info.begin_time = time(NULL);
           info.timeout = x.Timeout;
@@ -60,7 +58,7 @@ void refresh_schedule() {
           JS_SetInterruptHandler(JS_GetRuntime(context.ctx), timeout_checker,
                                  &info);
         }
-        context.eval(script);
+        script_eval_cached(context, script);
       } catch (qjs::exception) {
         script_print_stack(context);
       }
@@ -1,8 +1,13 @@
+#include <algorithm>
 #include <string>
 #include <cstring>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <quickjspp.hpp>
+#include <thread>
 #include <utility>
+#include <vector>
 #include <quickjs/quickjs-libc.h>
 
 #ifdef _WIN32
@@ -14,7 +19,9 @@
 #include "handler/settings.h"
 #include "handler/settings_view.h"
 #include "parser/config/proxy.h"
+#include "utils/concurrent_lru_cache.h"
 #include "utils/map_extra.h"
+#include "utils/content_digest.h"
 #include "utils/logger.h"
 #include "utils/system.h"
 #include "script_quickjs.h"
@@ -615,3 +622,223 @@ void script_print_stack(qjs::Context &context)
                  "SCRIPT_STACK detail=" +
                      static_cast<std::string>(exc["stack"]));
 }
+
+namespace
+{
+
+// A runtime is recycled a bounded number of times, so heap fragmentation and
+// anything a script managed to leave in the runtime cannot pile up forever.
+constexpr size_t kScriptRuntimeMaxUses = 64;
+// JS_DEFAULT_STACK_SIZE; only used where JS_UpdateStackTop is missing.
+constexpr size_t kScriptMaxStackSize = 256 * 1024;
+constexpr size_t kScriptBytecodeCacheEntries = 256;
+constexpr size_t kScriptBytecodeCacheBytes = 16 * 1024 * 1024;
+
+// The cache is keyed by a digest of the source, so each entry keeps the
+// source it was compiled from and a hit is only used when it matches.
+struct CompiledScript
+{
+    std::string source;
+    std::string bytecode;
+};
+
+using ScriptBytecode = std::shared_ptr<const CompiledScript>;
+
+ConcurrentLruCache<std::string, ScriptBytecode> script_bytecode_cache(
+    kScriptBytecodeCacheEntries, kScriptBytecodeCacheBytes);
+
+struct IdleScriptRuntime
+{
+    std::unique_ptr<qjs::Runtime> runtime;
+    std::unique_ptr<qjs::Context> context;
+    size_t uses = 0;
+};
+
+std::mutex script_pool_mutex;
+std::vector<IdleScriptRuntime> script_pool_idle;
+bool script_pool_stopped = false;
+
+std::unique_ptr<qjs::Context> new_script_context(qjs::Runtime &runtime)
+{
+    script_runtime_init(runtime);
+    auto context = std::make_unique<qjs::Context>(runtime);
+    script_context_init(*context);
+    return context;
+}
+
+IdleScriptRuntime new_script_runtime()
+{
+    IdleScriptRuntime slot;
+    slot.runtime = std::make_unique<qjs::Runtime>();
+    slot.context = new_script_context(*slot.runtime);
+    return slot;
+}
+
+void free_script_runtime(std::unique_ptr<qjs::Runtime> &runtime, std::unique_ptr<qjs::Context> &context)
+{
+    if(context)
+    {
+        js_std_free_handlers(runtime->rt);
+        context.reset();
+    }
+    runtime.reset();
+}
+
+ScriptBytecode compile_script(qjs::Context &context, const std::string &script)
+{
+    JSValue function = JS_Eval(context.ctx, script.data(), script.size(), "<eval>",
+                               JS_EVAL_TYPE_GLOBAL | JS_EVAL_FLAG_COMPILE_ONLY);
+    if(JS_IsException(function))
+    {
+        // Not cached: the caller evaluates the source again so the syntax
+        // error is raised in its own context.
+        JS_FreeValue(context.ctx, JS_GetException(context.ctx));
+        return nullptr;
+    }
+    size_t size = 0;
+    uint8_t *buffer = JS_WriteObject(context.ctx, &size, function, JS_WRITE_OBJ_BYTECODE);
+    JS_FreeValue(context.ctx, function);
+    if(!buffer)
+    {
+        JS_FreeValue(context.ctx, JS_GetException(context.ctx));
+        return nullptr;
+    }
+    auto compiled = std::make_shared<const CompiledScript>(
+        CompiledScript{script, std::string(reinterpret_cast<const char*>(buffer), size)});
+    js_free(context.ctx, buffer);
+    return compiled;
+}
+
+} // namespace
+
+ScriptRuntimeLease::ScriptRuntimeLease()
+{
+    {
+        std::lock_guard<std::mutex> lock(script_pool_mutex);
+        if(!script_pool_idle.empty())
+        {
+            IdleScriptRuntime &slot = script_pool_idle.back();
+            runtime_ = std::move(slot.runtime);
+            context_ = std::move(slot.context);
+            uses_ = slot.uses;
+            script_pool_idle.pop_back();
+        }
+    }
+    if(!runtime_)
+    {
+        IdleScriptRuntime slot = new_script_runtime();
+        runtime_ = std::move(slot.runtime);
+        context_ = std::move(slot.context);
+    }
+    // QuickJS checks for stack overflow against the stack top recorded when
+    // the runtime was created, but pooled runtimes are warmed and recycled on
+    // other threads. Measure from this thread's stack instead.
+#ifdef QUICKJS_HAS_UPDATE_STACK_TOP
+    JS_UpdateStackTop(runtime_->rt);
+#else
+    // Older releases take the stack top from the caller of JS_SetMaxStackSize.
+    JS_SetMaxStackSize(runtime_->rt, kScriptMaxStackSize);
+#endif // QUICKJS_HAS_UPDATE_STACK_TOP
+}
+
+ScriptRuntimeLease::~ScriptRuntimeLease()
+{
+    JS_SetInterruptHandler(runtime_->rt, nullptr, nullptr);
+    bool recycle = ++uses_ < kScriptRuntimeMaxUses && !runtime_->isJobPending();
+    if(recycle)
+    {
+        std::lock_guard<std::mutex> lock(script_pool_mutex);
+        recycle = !script_pool_stopped && script_pool_idle.size() < script_runtime_pool_capacity();
+    }
+    if(!recycle)
+    {
+        free_script_runtime(runtime_, context_);
+        return;
+    }
+    try
+    {
+        js_std_free_handlers(runtime_->rt);
+        context_.reset();
+        JS_RunGC(runtime_->rt);
+        context_ = new_script_context(*runtime_);
+    }
+    catch(...)
+    {
+        writeLog(LOG_LEVEL_WARNING, "SCRIPT_RUNTIME_RECYCLE_FAILED action=discard");
+        free_script_runtime(runtime_, context_);
+        return;
+    }
+    std::lock_guard<std::mutex> lock(script_pool_mutex);
+    if(script_pool_stopped || script_pool_idle.size() >= script_runtime_pool_capacity())
+    {
+        free_script_runtime(runtime_, context_);
+        return;
+    }
+    script_pool_idle.push_back({std::move(runtime_), std::move(context_), uses_});
+}
+
+void ScriptRuntimeLease::runPendingJobs()
+{
+    js_std_loop(context_->ctx);
+}
+
+void script_runtime_pool_warm(size_t count)
+{
+    count = std::min(count, script_runtime_pool_capacity());
+    while(true)
+    {
+        {
+            std::lock_guard<std::mutex> lock(script_pool_mutex);
+            if(script_pool_stopped || script_pool_idle.size() >= count)
+                return;
+        }
+        IdleScriptRuntime slot = new_script_runtime();
+        std::lock_guard<std::mutex> lock(script_pool_mutex);
+        if(script_pool_stopped || script_pool_idle.size() >= count)
+        {
+            free_script_runtime(slot.runtime, slot.context);
+            return;
+        }
+        script_pool_idle.push_back(std::move(slot));
+    }
+}
+
+size_t script_runtime_pool_capacity()
+{
+    static const size_t capacity = std::clamp<size_t>(std::thread::hardware_concurrency(), 2, 16);
+    return capacity;
+}
+
+void script_runtime_pool_shutdown()
+{
+    std::vector<IdleScriptRuntime> idle;
+    {
+        std::lock_guard<std::mutex> lock(script_pool_mutex);
+        script_pool_stopped = true;
+        idle.swap(script_pool_idle);
+    }
+    for(IdleScriptRuntime &slot : idle)
+        free_script_runtime(slot.runtime, slot.context);
+}
+
+qjs::Value script_eval_cached(qjs::Context &context, const std::string &script)
+{
+    ScriptBytecode compiled = script_bytecode_cache.getOrCompute(
+        getContentDigest(script), true, [&] { return compile_script(context, script); },
+        [](const ScriptBytecode &value)
+            -> ConcurrentLruCache<std::string, ScriptBytecode>::CacheSize {
+            if(!value)
+                return std::nullopt;
+            return value->source.size() + value->bytecode.size();
+        });
+    // A digest collision must never run another script's bytecode.
+    if(compiled && compiled->source != script)
+        compiled = compile_script(context, script);
+    if(!compiled)
+        return context.eval(script);
+    JSValue function = JS_ReadObject(context.ctx, reinterpret_cast<const uint8_t*>(compiled->bytecode.data()),
+                                     compiled->bytecode.size(), JS_READ_OBJ_BYTECODE);
+    if(JS_IsException(function))
+        throw qjs::exception{context.ctx};
+    return context.newValue(JS_EvalFunction(context.ctx, function));
+}
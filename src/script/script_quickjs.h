@@ -6,6 +6,9 @@
 
 #ifndef NO_JS_RUNTIME
 
+#include <cstddef>
+#include <memory>
+#include <string>
 #include <quickjspp.hpp>
 
 void script_runtime_init(qjs::Runtime &runtime);
@@ -63,6 +66,20 @@ namespace qjs
         }
     };
 
+    template<>
+    struct js_traits<InternedString>
+    {
+        static InternedString unwrap(JSContext *ctx, JSValueConst v)
+        {
+            return InternedString(js_traits<std::string_view>::unwrap(ctx, v));
+        }
+
+        static JSValue wrap(JSContext *ctx, const InternedString &str) noexcept
+        {
+            return JS_NewStringLen(ctx, str.data(), str.size());
+        }
+    };
+
     template<>
     struct js_traits<StringArray>
     {
@@ -253,21 +270,49 @@ namespace qjs
     };
 }
 
+/// Exclusive use of a pooled runtime whose context has already been through
+/// script_context_init(). When the lease ends the context is dropped, so no
+/// script state reaches the next user; the runtime itself goes back to the pool
+/// with a fresh context, ready for the next isolated run.
+class ScriptRuntimeLease
+{
+public:
+    ScriptRuntimeLease();
+    ~ScriptRuntimeLease();
+    ScriptRuntimeLease(const ScriptRuntimeLease &) = delete;
+    ScriptRuntimeLease &operator=(const ScriptRuntimeLease &) = delete;
+
+    qjs::Runtime &runtime() { return *runtime_; }
+    qjs::Context &context() { return *context_; }
+    /// Runs timers and promise jobs left by the script, as script_cleanup() does.
+    void runPendingJobs();
+
+private:
+    std::unique_ptr<qjs::Runtime> runtime_;
+    std::unique_ptr<qjs::Context> context_;
+    size_t uses_ = 0;
+};
+
+void script_runtime_pool_warm(size_t count);
+size_t script_runtime_pool_capacity();
+void script_runtime_pool_shutdown();
+
+/// Same as context.eval(script), but the compiled bytecode is shared by every
+/// runtime. Entries are looked up by a digest of the script text and only
+/// used when their stored source equals the script.
+qjs::Value script_eval_cached(qjs::Context &context, const std::string &script);
+
 template <typename Fn>
 void script_safe_runner(qjs::Runtime *runtime, qjs::Context *context, Fn runnable, bool clean_context = false)
 {
-    qjs::Runtime *internal_runtime = runtime;
-    qjs::Context *internal_context = context;
-    defer(if(clean_context) {delete internal_context; delete internal_runtime;} )
     if(clean_context)
     {
-        internal_runtime = new qjs::Runtime();
-        script_runtime_init(*internal_runtime);
-        internal_context = new qjs::Context(*internal_runtime);
-        script_context_init(*internal_context);
+        ScriptRuntimeLease lease;
+        runnable(lease.context());
+        return;
     }
-    if(internal_runtime && internal_context)
-        runnable(*internal_context);
+    if(runtime && context)
+        runnable(*context);
 }
 
 #else
@@ -14,6 +14,9 @@
 #include <utility>
 #include <vector>
 
+// Fixed worker pool over a bounded FIFO queue. Tasks start in submission
+// order; submitting from one of the workers, or into a full queue, runs the
+// task inline.
 class BoundedExecutor {
 public:
   BoundedExecutor(size_t worker_count, size_t queue_capacity)
@@ -76,6 +76,16 @@ public:
     return future.get();
   }
 
+  // Stores `value` under `key`, replacing whatever is cached there; a value
+  // too large for the cache just drops the old entry.
+  void put(const Key &key, const Value &value, size_t bytes) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (bytes <= max_bytes_ && max_entries_ != 0)
+      insert(key, value, bytes);
+    else
+      erase(key);
+  }
+
   size_t size() const {
     std::lock_guard<std::mutex> lock(mutex_);
     return entries_.size();
@@ -107,14 +117,17 @@ private:
     entry->second.lru = lru_.begin();
   }
 
-  void insert(const Key &key, const Value &value, size_t bytes) {
+  void erase(const Key &key) {
     auto existing = entries_.find(key);
     if (existing != entries_.end()) {
       bytes_ -= existing->second.bytes;
       lru_.erase(existing->second.lru);
       entries_.erase(existing);
     }
+  }
 
+  void insert(const Key &key, const Value &value, size_t bytes) {
+    erase(key);
     lru_.push_front(key);
     entries_.emplace(key, Entry{value, bytes, lru_.begin()});
     bytes_ += bytes;
@@ -0,0 +1,31 @@
+#include "content_digest.h"
+
+#include <random>
+
+#define XXH_INLINE_ALL
+#include "xxhash/xxhash.h"
+
+namespace {
+
+uint64_t processSeed() {
+  std::random_device device;
+  return (static_cast<uint64_t>(device()) << 32) ^ device();
+}
+
+} // namespace
+
+uint64_t hashContent(std::string_view data) {
+  static const uint64_t process_seed = processSeed();
+  return XXH3_64bits_withSeed(data.data(), data.size(), process_seed);
+}
+
+std::string getContentDigest(std::string_view data) {
+  static const char digits[] = "0123456789abcdef";
+  std::string digest(16, '0');
+  uint64_t hash = hashContent(data);
+  for (size_t i = 16; i-- > 0; hash >>= 4)
+    digest[i] = digits[hash & 0xf];
+  digest += '-';
+  digest += std::to_string(data.size());
+  return digest;
+}
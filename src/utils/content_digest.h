@@ -0,0 +1,18 @@
+#ifndef CONTENT_DIGEST_H_INCLUDED
+#define CONTENT_DIGEST_H_INCLUDED
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// A fast 64-bit hash of `data` (XXH3, vendored in utils/xxhash) under a seed
+// picked once per process. Several GB/s, against well under 1 GB/s for MD5.
+uint64_t hashContent(std::string_view data);
+
+// hashContent() and the length of `data` as a printable cache key part.
+// Only meant for keying in-memory caches by content: it is not a
+// cryptographic digest and differs between processes, so it must never be
+// persisted or compared across restarts.
+std::string getContentDigest(std::string_view data);
+
+#endif // CONTENT_DIGEST_H_INCLUDED
@@ -0,0 +1,225 @@
+#ifndef INTERNED_STRING_H_INCLUDED
+#define INTERNED_STRING_H_INCLUDED
+
+#include <atomic>
+#include <cstddef>
+#include <memory_resource>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+
+#include "utils/request_arena.h"
+
+class StringInternPool;
+
+// Immutable, reference-counted string for values that are usually empty or
+// repeated across many objects, such as a node's cipher, group or transport.
+// The handle is one pointer wide and an empty value owns no allocation. While
+// a StringInternPool is alive on the current thread, equal values assigned on
+// that thread share one buffer. Reads go through a const std::string &, so
+// code that only reads, compares or reassigns the value compiles unchanged.
+class InternedString {
+public:
+  static constexpr size_t npos = std::string::npos;
+
+  // Only literals convert implicitly, so an expression that mixes a
+  // std::string with an InternedString (a ?: for instance) yields a
+  // std::string; assignment accepts every string type.
+  InternedString() noexcept = default;
+  explicit InternedString(std::string_view value);
+  explicit InternedString(const std::string &value)
+      : InternedString(std::string_view(value)) {}
+  InternedString(const char *value)
+      : InternedString(std::string_view(value)) {}
+  InternedString(const InternedString &other) noexcept : entry_(other.entry_) {
+    retain(entry_);
+  }
+  InternedString(InternedString &&other) noexcept
+      : entry_(std::exchange(other.entry_, nullptr)) {}
+  ~InternedString() { release(entry_); }
+
+  InternedString &operator=(const InternedString &other) noexcept {
+    retain(other.entry_);
+    release(std::exchange(entry_, other.entry_));
+    return *this;
+  }
+  InternedString &operator=(InternedString &&other) noexcept {
+    if (this != &other)
+      release(std::exchange(entry_, std::exchange(other.entry_, nullptr)));
+    return *this;
+  }
+  InternedString &operator=(std::string_view value) {
+    return *this = InternedString(value);
+  }
+  InternedString &operator=(const std::string &value) {
+    return *this = InternedString(value);
+  }
+  InternedString &operator=(const char *value) {
+    return *this = InternedString(value);
+  }
+
+  const std::string &str() const noexcept {
+    static const std::string empty_value;
+    return entry_ ? entry_->value : empty_value;
+  }
+  operator const std::string &() const noexcept { return str(); }
+
+  bool empty() const noexcept { return entry_ == nullptr; }
+  size_t size() const noexcept { return str().size(); }
+  size_t length() const noexcept { return str().size(); }
+  const char *c_str() const noexcept { return str().c_str(); }
+  const char *data() const noexcept { return str().data(); }
+  char operator[](size_t index) const { return str()[index]; }
+  char front() const { return str().front(); }
+  char back() const { return str().back(); }
+  std::string::const_iterator begin() const noexcept { return str().begin(); }
+  std::string::const_iterator end() const noexcept { return str().end(); }
+
+  template <typename... Args> size_t find(Args &&...args) const {
+    return str().find(std::forward<Args>(args)...);
+  }
+  template <typename... Args> size_t rfind(Args &&...args) const {
+    return str().rfind(std::forward<Args>(args)...);
+  }
+  template <typename... Args> size_t find_first_of(Args &&...args) const {
+    return str().find_first_of(std::forward<Args>(args)...);
+  }
+  template <typename... Args> size_t find_last_of(Args &&...args) const {
+    return str().find_last_of(std::forward<Args>(args)...);
+  }
+  template <typename... Args> int compare(Args &&...args) const {
+    return str().compare(std::forward<Args>(args)...);
+  }
+  std::string substr(size_t pos = 0, size_t count = npos) const {
+    return str().substr(pos, count);
+  }
+
+  void clear() noexcept { release(std::exchange(entry_, nullptr)); }
+  InternedString &operator+=(std::string_view suffix) {
+    return *this = str() + std::string(suffix);
+  }
+
+  friend bool operator==(const InternedString &a, const InternedString &b) {
+    return a.entry_ == b.entry_ || a.str() == b.str();
+  }
+  friend bool operator==(const InternedString &a, const std::string &b) {
+    return a.str() == b;
+  }
+  friend bool operator==(const InternedString &a, std::string_view b) {
+    return std::string_view(a.str()) == b;
+  }
+  friend bool operator==(const InternedString &a, const char *b) {
+    return a.str() == b;
+  }
+  friend bool operator<(const InternedString &a, const InternedString &b) {
+    return a.str() < b.str();
+  }
+
+  friend std::string operator+(const InternedString &a, const InternedString &b) {
+    return a.str() + b.str();
+  }
+  friend std::string operator+(const InternedString &a, const std::string &b) {
+    return a.str() + b;
+  }
+  friend std::string operator+(const std::string &a, const InternedString &b) {
+    return a + b.str();
+  }
+  friend std::string operator+(std::string &&a, const InternedString &b) {
+    return std::move(a.append(b.str()));
+  }
+  friend std::string operator+(const InternedString &a, const char *b) {
+    return a.str() + b;
+  }
+  friend std::string operator+(const char *a, const InternedString &b) {
+    return a + b.str();
+  }
+  friend std::string operator+(const InternedString &a, char b) {
+    return a.str() + b;
+  }
+  friend std::string operator+(char a, const InternedString &b) {
+    return a + b.str();
+  }
+
+  friend std::ostream &operator<<(std::ostream &out, const InternedString &s) {
+    return out << s.str();
+  }
+
+private:
+  friend class StringInternPool;
+
+  struct Entry {
+    explicit Entry(std::string_view text) : value(text) {}
+    std::atomic<size_t> refs{1};
+    const std::string value;
+  };
+
+  static void retain(Entry *entry) noexcept {
+    if (entry)
+      entry->refs.fetch_add(1, std::memory_order_relaxed);
+  }
+  static void release(Entry *entry) noexcept {
+    if (entry && entry->refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+      delete entry;
+  }
+
+  Entry *entry_ = nullptr;
+};
+
+// Interning scope for one request. Values assigned to InternedString on the
+// thread that owns the pool are looked up here first, so a subscription's
+// repeated groups, ciphers and hosts are stored once. Entries are reference
+// counted: a value that outlives the pool, for example in a cache, keeps its
+// buffer, and the pool only drops its own references when the scope ends.
+// The lookup table itself dies with the pool, so it draws on the request
+// arena when one is active; open the pool inside the RequestArena scope.
+class StringInternPool {
+public:
+  StringInternPool()
+      : entries_(requestMemoryResource()), previous_(current()) {
+    current() = this;
+  }
+  StringInternPool(const StringInternPool &) = delete;
+  StringInternPool &operator=(const StringInternPool &) = delete;
+  ~StringInternPool() {
+    current() = previous_;
+    for (auto &item : entries_)
+      InternedString::release(item.second);
+  }
+
+  size_t size() const noexcept { return entries_.size(); }
+
+private:
+  friend class InternedString;
+
+  static StringInternPool *&current() noexcept {
+    thread_local StringInternPool *pool = nullptr;
+    return pool;
+  }
+
+  InternedString::Entry *intern(std::string_view value) {
+    auto found = entries_.find(value);
+    if (found == entries_.end()) {
+      auto *entry = new InternedString::Entry(value);
+      found = entries_.emplace(std::string_view(entry->value), entry).first;
+    }
+    InternedString::retain(found->second);
+    return found->second;
+  }
+
+  // Keys view the entries' own immutable buffers.
+  std::pmr::unordered_map<std::string_view, InternedString::Entry *> entries_;
+  StringInternPool *previous_;
+};
+
+inline InternedString::InternedString(std::string_view value) {
+  if (value.empty())
+    return;
+  if (StringInternPool *pool = StringInternPool::current())
+    entry_ = pool->intern(value);
+  else
+    entry_ = new Entry(value);
+}
+
+#endif // INTERNED_STRING_H_INCLUDED
@@ -0,0 +1,241 @@
+#include "pattern_set.h"
+
+#include <algorithm>
+#include <deque>
+#include <utility>
+
+#include "regexp.h"
+
+namespace {
+
+unsigned char foldAscii(unsigned char ch) {
+  return ch >= 'A' && ch <= 'Z' ? static_cast<unsigned char>(ch - 'A' + 'a')
+                                 : ch;
+}
+
+bool isValidUtf8(const std::string &text) {
+  size_t i = 0;
+  while (i < text.size()) {
+    const auto lead = static_cast<unsigned char>(text[i]);
+    size_t length = 0;
+    uint32_t code = 0;
+    if (lead < 0x80) {
+      i++;
+      continue;
+    } else if (lead >= 0xc2 && lead <= 0xdf) {
+      length = 2;
+      code = lead & 0x1f;
+    } else if (lead >= 0xe0 && lead <= 0xef) {
+      length = 3;
+      code = lead & 0x0f;
+    } else if (lead >= 0xf0 && lead <= 0xf4) {
+      length = 4;
+      code = lead & 0x07;
+    } else {
+      return false;
+    }
+    if (i + length > text.size())
+      return false;
+    for (size_t j = 1; j < length; j++) {
+      const auto next = static_cast<unsigned char>(text[i + j]);
+      if ((next & 0xc0) != 0x80)
+        return false;
+      code = (code << 6) | (next & 0x3f);
+    }
+    // Overlong forms, surrogates and values past U+10FFFF are rejected the
+    // same way PCRE2 rejects them in UTF mode.
+    if ((length == 3 && code < 0x800) || (length == 4 && code < 0x10000) ||
+        (code >= 0xd800 && code <= 0xdfff) || code > 0x10ffff)
+      return false;
+    i += length;
+  }
+  return true;
+}
+
+// Splits `pattern` into literal alternatives when it has no regex syntax
+// beyond a top-level `|` and an optional leading `(?i)`. Caseless patterns
+// are only accepted for ASCII text without k or s, whose Unicode case folds
+// (KELVIN SIGN, LONG S) PCRE2 would also match.
+bool parseLiteralAlternation(const std::string &pattern,
+                             std::vector<std::string> &alternatives,
+                             bool &caseless) {
+  static const std::string metacharacters = "\\^$.[]()|?*+{}";
+  std::string body = pattern;
+  caseless = body.compare(0, 4, "(?i)") == 0;
+  if (caseless)
+    body.erase(0, 4);
+  if (body.empty() || !isValidUtf8(body))
+    return false;
+
+  alternatives.clear();
+  std::string current;
+  for (const char ch : body) {
+    if (ch == '|') {
+      if (current.empty())
+        return false;
+      alternatives.push_back(std::move(current));
+      current.clear();
+      continue;
+    }
+    if (metacharacters.find(ch) != std::string::npos)
+      return false;
+    const auto byte = static_cast<unsigned char>(ch);
+    if (caseless) {
+      const unsigned char folded = foldAscii(byte);
+      if (byte >= 0x80 || folded == 'k' || folded == 's')
+        return false;
+      current += static_cast<char>(folded);
+    } else {
+      current += ch;
+    }
+  }
+  if (current.empty())
+    return false;
+  alternatives.push_back(std::move(current));
+  return true;
+}
+
+} // namespace
+
+uint32_t PatternSet::Automaton::child(uint32_t node, unsigned char byte) const {
+  for (const auto &edge : nodes_[node].next)
+    if (edge.first == byte)
+      return edge.second;
+  return 0;
+}
+
+void PatternSet::Automaton::add(const std::string &literal, uint32_t pattern) {
+  uint32_t node = 0;
+  for (const char ch : literal) {
+    const auto byte = static_cast<unsigned char>(ch);
+    uint32_t next = child(node, byte);
+    if (!next) {
+      next = static_cast<uint32_t>(nodes_.size());
+      nodes_[node].next.emplace_back(byte, next);
+      nodes_.emplace_back();
+    }
+    node = next;
+  }
+  nodes_[node].outputs.push_back(pattern);
+}
+
+void PatternSet::Automaton::build() {
+  std::deque<uint32_t> queue;
+  for (const auto &edge : nodes_[0].next)
+    queue.push_back(edge.second);
+  while (!queue.empty()) {
+    const uint32_t node = queue.front();
+    queue.pop_front();
+    for (const auto &edge : nodes_[node].next) {
+      const uint32_t target = edge.second;
+      uint32_t fail = nodes_[node].fail;
+      while (fail && !child(fail, edge.first))
+        fail = nodes_[fail].fail;
+      const uint32_t fallback = child(fail, edge.first);
+      nodes_[target].fail = fallback != target ? fallback : 0;
+      const std::vector<uint32_t> &inherited =
+          nodes_[nodes_[target].fail].outputs;
+      nodes_[target].outputs.insert(nodes_[target].outputs.end(),
+                                    inherited.begin(), inherited.end());
+      queue.push_back(target);
+    }
+  }
+}
+
+template <class OnMatch>
+bool PatternSet::Automaton::scan(const std::string &subject, bool caseless,
+                                 OnMatch &&on_match) const {
+  uint32_t node = 0;
+  for (const char ch : subject) {
+    const auto raw = static_cast<unsigned char>(ch);
+    const unsigned char byte = caseless ? foldAscii(raw) : raw;
+    uint32_t next = child(node, byte);
+    while (!next && node) {
+      node = nodes_[node].fail;
+      next = child(node, byte);
+    }
+    node = next;
+    for (const uint32_t pattern : nodes_[node].outputs)
+      if (on_match(pattern))
+        return true;
+  }
+  return false;
+}
+
+PatternSet::PatternSet(const std::vector<std::string> &patterns)
+    : pattern_count_(patterns.size()) {
+  std::vector<std::string> alternatives;
+  for (uint32_t index = 0; index < patterns.size(); index++) {
+    bool caseless = false;
+    if (!parseLiteralAlternation(patterns[index], alternatives, caseless)) {
+      regex_patterns_.emplace_back(index, patterns[index]);
+      continue;
+    }
+    Automaton &automaton = caseless ? caseless_ : exact_;
+    for (const std::string &literal : alternatives)
+      automaton.add(literal, index);
+    literal_count_++;
+  }
+  exact_.build();
+  caseless_.build();
+}
+
+bool PatternSet::matchAny(const std::string &subject) const {
+  // regFind() never matches a subject that is not valid UTF-8.
+  if (literal_count_ && isValidUtf8(subject)) {
+    const auto found = [](uint32_t) { return true; };
+    if (!exact_.empty() && exact_.scan(subject, false, found))
+      return true;
+    if (!caseless_.empty() && caseless_.scan(subject, true, found))
+      return true;
+  }
+  for (const auto &pattern : regex_patterns_)
+    if (regFind(subject, pattern.second))
+      return true;
+  return false;
+}
+
+void PatternSet::matchAll(const std::string &subject,
+                          std::vector<bool> &matched) const {
+  matched.assign(pattern_count_, false);
+  if (literal_count_ && isValidUtf8(subject)) {
+    const auto record = [&matched](uint32_t pattern) {
+      matched[pattern] = true;
+      return false;
+    };
+    exact_.scan(subject, false, record);
+    caseless_.scan(subject, true, record);
+  }
+  for (const auto &pattern : regex_patterns_)
+    matched[pattern.first] = regFind(subject, pattern.second);
+}
+
+void PatternSet::matchIndices(const std::string &subject,
+                              std::vector<uint32_t> &matched) const {
+  matched.clear();
+  if (literal_count_ && isValidUtf8(subject)) {
+    const auto record = [&matched](uint32_t pattern) {
+      matched.push_back(pattern);
+      return false;
+    };
+    exact_.scan(subject, false, record);
+    caseless_.scan(subject, true, record);
+    // A pattern is reported once per occurrence of each of its alternatives.
+    std::sort(matched.begin(), matched.end());
+    matched.erase(std::unique(matched.begin(), matched.end()), matched.end());
+  }
+  const size_t literal_matches = matched.size();
+  for (const auto &pattern : regex_patterns_)
+    if (regFind(subject, pattern.second))
+      matched.push_back(pattern.first);
+  std::inplace_merge(matched.begin(),
+                     matched.begin() +
+                         static_cast<std::ptrdiff_t>(literal_matches),
+                     matched.end());
+}
+
+bool PatternSet::literal(const std::string &pattern) {
+  std::vector<std::string> alternatives;
+  bool caseless = false;
+  return parseLiteralAlternation(pattern, alternatives, caseless);
+}
@@ -0,0 +1,71 @@
+#ifndef PATTERN_SET_H_INCLUDED
+#define PATTERN_SET_H_INCLUDED
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// A fixed set of regFind() patterns evaluated against one subject at a time.
+//
+// Patterns that are plain literal alternations (`香港|HK`, `(?i)iplc|bgp`) are
+// merged into one Aho-Corasick automaton and found in a single scan of the
+// subject. Every other pattern still goes through regFind(), which reuses the
+// compiled and JIT-ed regex. Results are identical to calling regFind() for
+// each pattern.
+class PatternSet {
+public:
+  PatternSet() = default;
+  explicit PatternSet(const std::vector<std::string> &patterns);
+
+  size_t size() const { return pattern_count_; }
+  bool empty() const { return pattern_count_ == 0; }
+  size_t literalCount() const { return literal_count_; }
+
+  bool matchAny(const std::string &subject) const;
+  // matched[i] is set to whether pattern i matches `subject`.
+  void matchAll(const std::string &subject, std::vector<bool> &matched) const;
+  // `matched` is set to the indices of the patterns that match `subject`, in
+  // ascending order. Only the matches are visited, so a large set of literal
+  // patterns costs one scan of the subject however many there are.
+  void matchIndices(const std::string &subject,
+                    std::vector<uint32_t> &matched) const;
+
+  // Whether `pattern` goes into the automaton rather than through regFind().
+  static bool literal(const std::string &pattern);
+
+private:
+  // Aho-Corasick automaton over bytes. Caseless patterns are stored lowered
+  // and scanned with ASCII folding.
+  class Automaton {
+  public:
+    void add(const std::string &literal, uint32_t pattern);
+    void build();
+    bool empty() const { return nodes_.size() <= 1; }
+    // Calls on_match(pattern) for every pattern found; stops early when it
+    // returns true. Returns whether it stopped early.
+    template <class OnMatch>
+    bool scan(const std::string &subject, bool caseless,
+              OnMatch &&on_match) const;
+
+  private:
+    struct Node {
+      std::vector<std::pair<unsigned char, uint32_t>> next;
+      uint32_t fail = 0;
+      // Patterns ending here, followed by those of the failure chain.
+      std::vector<uint32_t> outputs;
+    };
+
+    uint32_t child(uint32_t node, unsigned char byte) const;
+
+    std::vector<Node> nodes_ = std::vector<Node>(1);
+  };
+
+  size_t pattern_count_ = 0;
+  size_t literal_count_ = 0;
+  Automaton exact_;
+  Automaton caseless_;
+  std::vector<std::pair<uint32_t, std::string>> regex_patterns_;
+};
+
+#endif // PATTERN_SET_H_INCLUDED
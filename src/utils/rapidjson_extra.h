@@ -17,8 +17,12 @@ template <typename T> void exception_thrower(T e, const std::string &cond, const
 #include <rapidjson/document.h>
 #include <rapidjson/writer.h>
 #include <rapidjson/error/en.h>
+#include <cstddef>
+#include <memory_resource>
 #include <string>
 
+#include "utils/request_arena.h"
+
 inline void operator >> (const rapidjson::Value &value, std::string &i)
 {
     if(value.IsNull())
@@ -85,6 +89,41 @@ inline rapidjson::Value buildBooleanValue(bool value)
     return value ? rapidjson::Value(rapidjson::kTrueType) : rapidjson::Value(rapidjson::kFalseType);
 }
 
+// Pool allocator for a request-local rapidjson::Document. The first chunk is
+// carved from requestMemoryResource(), so a typical generated config never
+// touches the heap during a request; larger documents spill into heap chunks
+// as usual. Declare it before the Document that uses it.
+class RequestJsonAllocator
+{
+public:
+    static constexpr size_t initial_buffer_size = 32 * 1024;
+
+    explicit RequestJsonAllocator(size_t size = initial_buffer_size)
+        : buffer_(size), allocator_(buffer_.data, buffer_.size) {}
+
+    RequestJsonAllocator(const RequestJsonAllocator &) = delete;
+    RequestJsonAllocator &operator=(const RequestJsonAllocator &) = delete;
+
+    rapidjson::MemoryPoolAllocator<> *get() noexcept { return &allocator_; }
+
+private:
+    // Outlives allocator_, which keeps its bookkeeping in the buffer.
+    struct Buffer
+    {
+        explicit Buffer(size_t bytes)
+            : resource(requestMemoryResource()), size(bytes),
+              data(resource->allocate(bytes, alignof(std::max_align_t))) {}
+        ~Buffer() { resource->deallocate(data, size, alignof(std::max_align_t)); }
+
+        std::pmr::memory_resource *resource;
+        size_t size;
+        void *data;
+    };
+
+    Buffer buffer_;
+    rapidjson::MemoryPoolAllocator<> allocator_;
+};
+
 namespace rapidjson_ext {
     template <typename ReturnType>
     struct ExtensionFunction {
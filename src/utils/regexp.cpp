@@ -1,5 +1,11 @@
-#include <string>
+#include <array>
+#include <atomic>
 #include <cstdarg>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
 
 /*
 #ifdef USE_STD_REGEX
@@ -10,6 +16,7 @@
 using jp = jpcre2::select<char>;
 //#endif // USE_STD_REGEX
 
+#include "concurrent_lru_cache.h"
 #include "regexp.h"
 
 /*
@@ -131,38 +138,164 @@ int regGetMatch(const std::string &src, const std::string &match, size_t group_c
 
 #else
 */
+namespace
+{
+
+// Every entry point compiles with its own modifier/option set, so the kind is
+// part of the cache key. regFind and regGetAllMatch compile identically.
+enum class RegexKind : char
+{
+    Match = 'M',
+    Find = 'F',
+    Replace = 'R',
+    ReplaceSingleLine = 'r',
+    FullMatch = 'W',
+    Valid = 'V'
+};
+
+using CompiledRegex = std::shared_ptr<const jp::Regex>;
+using RegexCache = ConcurrentLruCache<std::string, CompiledRegex>;
+
+constexpr size_t kRegexCacheEntries = 4096;
+constexpr size_t kRegexCacheBytes = 32 * 1024 * 1024;
+RegexCache regex_cache(kRegexCacheEntries, kRegexCacheBytes);
+std::atomic<uint64_t> regex_cache_hits {0};
+std::atomic<uint64_t> regex_cache_misses {0};
+
+RegexCache::CacheSize compiledRegexSize(const std::string &pattern, const jp::Regex &regex)
+{
+    size_t bytes = pattern.size() + sizeof(jp::Regex);
+    if(const pcre2_code_8 *code = regex.getPcre2Code())
+    {
+        size_t code_size = 0, jit_size = 0;
+        if(pcre2_pattern_info_8(code, PCRE2_INFO_SIZE, &code_size) == 0)
+            bytes += code_size;
+        if(pcre2_pattern_info_8(code, PCRE2_INFO_JITSIZE, &jit_size) == 0)
+            bytes += jit_size;
+    }
+    return bytes;
+}
+
+// Each thread also remembers its recently used patterns, so the common case of
+// one rule applied to every node does not take the shared cache's mutex. The
+// slots are direct-mapped by hash and a collision simply replaces the slot;
+// compiled patterns are immutable, so both levels can hand out the same one.
+struct ThreadRegexSlot
+{
+    RegexKind kind = RegexKind::Match;
+    std::string pattern;
+    CompiledRegex regex;
+};
+
+constexpr size_t kThreadRegexSlots = 64;
+
+// Patterns that fail to compile are cached as well, so an invalid user rule
+// evaluated once per node is still only compiled once.
+CompiledRegex compileCached(const std::string &pattern, RegexKind kind, const char *modifier, uint32_t options)
+{
+    thread_local std::array<ThreadRegexSlot, kThreadRegexSlots> thread_slots;
+    const size_t hash = std::hash<std::string>{}(pattern) * 31 + static_cast<size_t>(kind);
+    ThreadRegexSlot &slot = thread_slots[hash % kThreadRegexSlots];
+    if(slot.regex && slot.kind == kind && slot.pattern == pattern)
+    {
+        regex_cache_hits.fetch_add(1, std::memory_order_relaxed);
+        return slot.regex;
+    }
+
+    bool cache_hit = false;
+    CompiledRegex compiled = regex_cache.getOrCompute(
+        static_cast<char>(kind) + pattern, true,
+        [&]
+        {
+            auto regex = std::make_shared<jp::Regex>();
+            // "S" requests PCRE2 JIT; when JIT is unavailable the interpreted
+            // code is kept and matching still works.
+            regex->setPattern(pattern).addModifier(modifier).addModifier("S").addPcre2Option(options).compile();
+            return CompiledRegex(std::move(regex));
+        },
+        [&](const CompiledRegex &regex) { return compiledRegexSize(pattern, *regex); },
+        &cache_hit);
+    (cache_hit ? regex_cache_hits : regex_cache_misses).fetch_add(1, std::memory_order_relaxed);
+    slot.kind = kind;
+    slot.pattern = pattern;
+    slot.regex = compiled;
+    return compiled;
+}
+
+// Match data blocks are kept per thread, one for each capture count, because
+// cached patterns are shared between threads and must not own match state.
+// jpcre2 reads every ovector pair, so a block must fit its pattern exactly.
+class ThreadMatchData
+{
+public:
+    ThreadMatchData() = default;
+    ThreadMatchData(const ThreadMatchData &) = delete;
+    ThreadMatchData &operator=(const ThreadMatchData &) = delete;
+    ~ThreadMatchData()
+    {
+        for(pcre2_match_data_8 *data : blocks_)
+            if(data)
+                pcre2_match_data_free_8(data);
+    }
+
+    pcre2_match_data_8 *get(const jp::Regex &regex)
+    {
+        uint32_t captures = 0;
+        pcre2_pattern_info_8(regex.getPcre2Code(), PCRE2_INFO_CAPTURECOUNT, &captures);
+        if(blocks_.size() <= captures)
+            blocks_.resize(captures + 1, nullptr);
+        pcre2_match_data_8 *&data = blocks_[captures];
+        if(!data)
+            data = pcre2_match_data_create_8(captures + 1, nullptr);
+        return data;
+    }
+
+private:
+    std::vector<pcre2_match_data_8*> blocks_;
+};
+
+pcre2_match_data_8 *threadMatchData(const jp::Regex &regex)
+{
+    thread_local ThreadMatchData match_data;
+    return match_data.get(regex);
+}
+
+bool matchCached(const std::string &src, const jp::Regex &regex)
+{
+    return jp::RegexMatch(&regex).setSubject(src).setModifier("g").setMatchDataBlock(threadMatchData(regex)).match();
+}
+
+} // namespace
+
 bool regMatch(const std::string &src, const std::string &match)
 {
-    jp::Regex reg;
-    reg.setPattern(match).addModifier("m").addPcre2Option(PCRE2_ANCHORED|PCRE2_ENDANCHORED|PCRE2_UTF).compile();
-    if(!reg)
+    CompiledRegex reg = compileCached(match, RegexKind::Match, "m", PCRE2_ANCHORED|PCRE2_ENDANCHORED|PCRE2_UTF);
+    if(!*reg)
         return false;
-    return reg.match(src, "g");
+    return matchCached(src, *reg);
 }
 
 bool regFind(const std::string &src, const std::string &match)
 {
-    jp::Regex reg;
-    reg.setPattern(match).addModifier("m").addPcre2Option(PCRE2_UTF|PCRE2_ALT_BSUX).compile();
-    if(!reg)
+    CompiledRegex reg = compileCached(match, RegexKind::Find, "m", PCRE2_UTF|PCRE2_ALT_BSUX);
+    if(!*reg)
         return false;
-    return reg.match(src, "g");
+    return matchCached(src, *reg);
 }
 
 std::string regReplace(const std::string &src, const std::string &match, const std::string &rep, bool global, bool multiline)
 {
-    jp::Regex reg;
-    reg.setPattern(match).addModifier(multiline ? "m" : "").addPcre2Option(PCRE2_UTF|PCRE2_MULTILINE|PCRE2_ALT_BSUX).compile();
-    if(!reg)
+    CompiledRegex reg = compileCached(match, multiline ? RegexKind::Replace : RegexKind::ReplaceSingleLine,
+                                      multiline ? "m" : "", PCRE2_UTF|PCRE2_MULTILINE|PCRE2_ALT_BSUX);
+    if(!*reg)
         return src;
-    return reg.replace(src, rep, global ? "gEx" : "Ex");
+    return jp::RegexReplace(reg.get()).setSubject(src).setReplaceWith(rep).setModifier(global ? "gEx" : "Ex")
+        .setMatchDataBlock(threadMatchData(*reg)).replace();
 }
 
 bool regValid(const std::string &reg)
 {
-    jp::Regex r;
-    r.setPattern(reg).addPcre2Option(PCRE2_UTF|PCRE2_ALT_BSUX).compile();
-    return !!r;
+    return !!*compileCached(reg, RegexKind::Valid, "", PCRE2_UTF|PCRE2_ALT_BSUX);
 }
 
 int regGetMatch(const std::string &src, const std::string &match, size_t group_count, ...)
@@ -189,11 +322,11 @@ int regGetMatch(const std::string &src, const std::string &match, size_t group_c
 
 std::vector<std::string> regGetAllMatch(const std::string &src, const std::string &match, bool group_only)
 {
-    jp::Regex reg;
-    reg.setPattern(match).addModifier("m").addPcre2Option(PCRE2_UTF|PCRE2_ALT_BSUX).compile();
+    CompiledRegex reg = compileCached(match, RegexKind::Find, "m", PCRE2_UTF|PCRE2_ALT_BSUX);
     jp::VecNum vec_num;
     jp::RegexMatch rm;
-    size_t count = rm.setRegexObject(&reg).setSubject(src).setNumberedSubstringVector(&vec_num).setModifier("gm").match();
+    size_t count = rm.setRegexObject(reg.get()).setSubject(src).setNumberedSubstringVector(&vec_num).setModifier("gm")
+        .setMatchDataBlock(*reg ? threadMatchData(*reg) : nullptr).match();
     std::vector<std::string> result;
     if(!count)
         return result;
@@ -217,6 +350,55 @@ std::vector<std::string> regGetAllMatch(const std::string &src, const std::strin
     return result;
 }
 
+struct FullMatchRegex::Compiled
+{
+    CompiledRegex regex;
+};
+
+FullMatchRegex::FullMatchRegex(const std::string &pattern)
+    : compiled_(std::make_shared<const Compiled>(Compiled{
+          compileCached(pattern, RegexKind::FullMatch, "m",
+                        PCRE2_UTF|PCRE2_MULTILINE|PCRE2_ALT_BSUX|PCRE2_ANCHORED|PCRE2_ENDANCHORED)}))
+{
+}
+
+bool FullMatchRegex::valid() const
+{
+    return compiled_ && *compiled_->regex;
+}
+
+bool FullMatchRegex::replace(const std::string &src, const std::string &rep, std::string &result) const
+{
+    if(!valid())
+        return false;
+    const jp::Regex &regex = *compiled_->regex;
+    // Anchored at both ends, so a single substitution replaces all of `src`.
+    jp::RegexReplace replacer(&regex);
+    std::string replaced = replacer.setSubject(src).setReplaceWith(rep).setModifier("Ex")
+        .setMatchDataBlock(threadMatchData(regex)).replace();
+    if(!replacer.getLastReplaceCount())
+        return false;
+    result = std::move(replaced);
+    return true;
+}
+
+RegexCacheStats regexCacheStats()
+{
+    return {regex_cache_hits.load(std::memory_order_relaxed),
+            regex_cache_misses.load(std::memory_order_relaxed),
+            regex_cache.size()};
+}
+
+size_t regexCacheMaxEntries()
+{
+    return kRegexCacheEntries;
+}
+
+size_t regexCacheMaxBytes()
+{
+    return kRegexCacheBytes;
+}
+
 //#endif // USE_STD_REGEX
 
 std::string regTrim(const std::string &src)
@@ -1,7 +1,11 @@
 #ifndef REGEXP_H_INCLUDED
 #define REGEXP_H_INCLUDED
 
+#include <cstddef>
+#include <cstdint>
+#include <memory>
 #include <string>
+#include <vector>
 
 bool regValid(const std::string &reg);
 bool regFind(const std::string &src, const std::string &match);
@@ -11,4 +15,35 @@ int regGetMatch(const std::string &src, const std::string &match, size_t group_c
 std::vector<std::string> regGetAllMatch(const std::string &src, const std::string &match, bool group_only = false);
 std::string regTrim(const std::string &src);
 
+/// A pattern compiled once for rules that must match a whole subject, such as
+/// the userinfo stream and time rules. replace() matches once and, when the
+/// match covers all of `src`, writes `rep` expanded with its groups (same
+/// syntax as regReplace()) to `result`.
+class FullMatchRegex
+{
+public:
+    FullMatchRegex() = default;
+    explicit FullMatchRegex(const std::string &pattern);
+
+    bool valid() const;
+    bool replace(const std::string &src, const std::string &rep, std::string &result) const;
+
+private:
+    struct Compiled;
+    std::shared_ptr<const Compiled> compiled_;
+};
+
+/// Compiled patterns are cached per (pattern, entry point) and JIT-compiled,
+/// so repeated calls with the same pattern only pay for matching.
+struct RegexCacheStats
+{
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    size_t entries = 0;
+};
+
+RegexCacheStats regexCacheStats();
+size_t regexCacheMaxEntries();
+size_t regexCacheMaxBytes();
+
 #endif // REGEXP_H_INCLUDED
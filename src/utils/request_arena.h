@@ -0,0 +1,63 @@
+#ifndef REQUEST_ARENA_H_INCLUDED
+#define REQUEST_ARENA_H_INCLUDED
+
+#include <cstddef>
+#include <memory_resource>
+
+// Linear allocation scope for one conversion request. While a RequestArena is
+// alive, requestMemoryResource() on the same thread hands out its monotonic
+// buffer; everything allocated from it is released together when the scope
+// ends instead of being freed piecemeal. Containers allocated from the arena
+// must not outlive it, so only request-local temporaries use it: the
+// generators' RemarkSet, the string_view_array fields split() fills while
+// rules are converted, the Surge-family rule list rulesetToSurge() collects
+// before handing it to the INI writer, the per-item scratch buffer of
+// forEachClashProxyItem(), the StringInternPool lookup table, and the first
+// pool chunk of the sing-box and SS JSON documents (RequestJsonAllocator).
+//
+// Proxy fields, string_array, yaml-cpp nodes and interned values are fixed
+// to the default allocator and many of them end up in the cross-request
+// caches, so they stay on the heap, as do JSON documents that outgrow their
+// first chunk. The parallel stages run on executor threads that do not see
+// this thread's arena; there the same code falls back to the heap.
+class RequestArena {
+public:
+  static constexpr size_t initial_buffer_size = 64 * 1024;
+
+  explicit RequestArena(
+      size_t initial_size = initial_buffer_size,
+      std::pmr::memory_resource *upstream = std::pmr::new_delete_resource())
+      : resource_(initial_size, upstream),
+        previous_(current()) {
+    current() = &resource_;
+  }
+
+  RequestArena(const RequestArena &) = delete;
+  RequestArena &operator=(const RequestArena &) = delete;
+
+  ~RequestArena() { current() = previous_; }
+
+  std::pmr::memory_resource *resource() noexcept { return &resource_; }
+
+  static std::pmr::memory_resource *active() noexcept {
+    std::pmr::memory_resource *resource = current();
+    return resource ? resource : std::pmr::get_default_resource();
+  }
+
+private:
+  static std::pmr::memory_resource *&current() noexcept {
+    thread_local std::pmr::memory_resource *resource = nullptr;
+    return resource;
+  }
+
+  std::pmr::monotonic_buffer_resource resource_;
+  std::pmr::memory_resource *previous_;
+};
+
+// Memory resource for request-local temporaries: the innermost RequestArena
+// on this thread, or the default heap resource outside of a request.
+inline std::pmr::memory_resource *requestMemoryResource() noexcept {
+  return RequestArena::active();
+}
+
+#endif // REQUEST_ARENA_H_INCLUDED
@@ -25,7 +25,8 @@ std::vector<std::string> split(const std::string &s, const std::string &separato
     return result;
 }
 
-void split(std::vector<std::string_view> &result, std::string_view s, char separator)
+template <typename Container>
+static void splitViews(Container &result, std::string_view s, char separator)
 {
     string_size bpos = 0, epos = s.find(separator);
     while(bpos < s.size())
@@ -38,10 +39,15 @@ void split(std::vector<std::string_view> &result, std::string_view s, char separ
     }
 }
 
+void split(string_view_array &result, std::string_view s, char separator)
+{
+    splitViews(result, s, separator);
+}
+
 std::vector<std::string_view> split(std::string_view s, char separator)
 {
     std::vector<std::string_view> result;
-    split(result, s, separator);
+    splitViews(result, s, separator);
     return result;
 }
 
@@ -1,6 +1,7 @@
 #ifndef STRING_H_INCLUDED
 #define STRING_H_INCLUDED
 
+#include <memory_resource>
 #include <numeric>
 #include <string>
 #include <sstream>
@@ -10,14 +11,14 @@
 using string = std::string;
 using string_size = std::string::size_type;
 using string_array = std::vector<std::string>;
-using string_view_array = std::vector<std::string_view>;
+using string_view_array = std::pmr::vector<std::string_view>;
 using string_map = std::map<std::string, std::string>;
 using string_multimap = std::multimap<std::string, std::string>;
 using string_pair_array = std::vector<std::pair<std::string, std::string>>;
 
 std::vector<std::string> split(const std::string &s, const std::string &separator);
 std::vector<std::string_view> split(std::string_view s, char separator);
-void split(std::vector<std::string_view> &result, std::string_view s, char separator);
+void split(string_view_array &result, std::string_view s, char separator);
 std::string join(const string_array &arr, const std::string &delimiter);
 
 template <typename InputIt>
@@ -5,6 +5,28 @@
 #include <string>
 #include <vector>
 
+#include "interned_string.h"
+
+namespace YAML
+{
+template <> struct convert<InternedString>
+{
+    static Node encode(const InternedString &rhs)
+    {
+        return Node(rhs.str());
+    }
+
+    static bool decode(const Node &node, InternedString &rhs)
+    {
+        std::string value;
+        if(!convert<std::string>::decode(node, value))
+            return false;
+        rhs = value;
+        return true;
+    }
+};
+}
+
 template <typename T> void operator >> (const YAML::Node& node, T& i)
 {
     if(node.IsDefined() && !node.IsNull()) //fail-safe
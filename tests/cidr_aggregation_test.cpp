@@ -0,0 +1,90 @@
+#ifdef NDEBUG
+#undef NDEBUG
+#endif
+#include <cassert>
+#include <string>
+
+#include "generator/config/cidr_aggregation.h"
+
+static void testMerging() {
+  // Contained, overlapping and adjacent ranges collapse; the result takes
+  // the place of the first range rule.
+  assert(aggregateCidrRules("DOMAIN,a.com\n"
+                            "IP-CIDR,10.0.1.0/24\n"
+                            "DOMAIN-SUFFIX,b.com\n"
+                            "IP-CIDR,10.0.0.0/24\n"
+                            "IP-CIDR,10.0.0.128/25\n"
+                            "IP-CIDR,10.0.2.0/23\n"
+                            "IP-CIDR,192.168.0.1/32\n") ==
+         "DOMAIN,a.com\n"
+         "IP-CIDR,10.0.0.0/22\n"
+         "IP-CIDR,192.168.0.1/32\n"
+         "DOMAIN-SUFFIX,b.com\n");
+
+  // Unaligned unions split into the fewest prefixes, host bits are masked.
+  assert(aggregateCidrRules("IP-CIDR,10.0.0.1/24\n"
+                            "IP-CIDR,10.0.1.0/24\n"
+                            "IP-CIDR,10.0.2.0/24\n") ==
+         "IP-CIDR,10.0.0.0/23\n"
+         "IP-CIDR,10.0.2.0/24\n");
+  assert(aggregateCidrRules("IP-CIDR,0.0.0.0/1\nIP-CIDR,128.0.0.0/1\n") ==
+         "IP-CIDR,0.0.0.0/0\n");
+
+  // Families and no-resolve flags are merged separately.
+  assert(aggregateCidrRules("IP-CIDR6,2001:db8::/33,no-resolve\n"
+                            "IP-CIDR,1.0.0.0/9,no-resolve\n"
+                            "IP6-CIDR,2001:db8:8000::/33,NO-RESOLVE\n"
+                            "IP-CIDR,1.128.0.0/9\n"
+                            "IP-CIDR6,ffff:ffff:ffff:ffff::/64\n"
+                            "IP-CIDR6,ffff:ffff:ffff:ffff:8000::/65\n") ==
+         "IP-CIDR,1.128.0.0/9\n"
+         "IP-CIDR,1.0.0.0/9,no-resolve\n"
+         "IP-CIDR6,ffff:ffff:ffff:ffff::/64\n"
+         "IP-CIDR6,2001:db8::/32,no-resolve\n");
+}
+
+static void testKeptAsIs() {
+  const std::string untouched = "DOMAIN,a.com\r\nDOMAIN-KEYWORD,b";
+  assert(aggregateCidrRules(untouched) == untouched);
+
+  assert(aggregateCidrRules("IP-CIDR,10.0.0.0/8,src\n"
+                            "IP-CIDR,10.0.0.0/33\n"
+                            "IP-CIDR,::ffff:10.0.0.0/104\n"
+                            "IP-CIDR,10.1.0.0/16\n"
+                            "# IP-CIDR,10.2.0.0/16\n") ==
+         "IP-CIDR,10.0.0.0/8,src\n"
+         "IP-CIDR,10.0.0.0/33\n"
+         "IP-CIDR,::ffff:10.0.0.0/104\n"
+         "IP-CIDR,10.1.0.0/16\n"
+         "# IP-CIDR,10.2.0.0/16\n");
+}
+
+static void testLineEndings() {
+  // CRLF bodies stay CRLF throughout, merged lines included.
+  assert(aggregateCidrRules("DOMAIN,a.com\r\n"
+                            "IP-CIDR,10.0.0.0/24\r\n"
+                            "IP-CIDR,10.0.1.0/24\r\n"
+                            "DOMAIN,b.com\r\n") ==
+         "DOMAIN,a.com\r\n"
+         "IP-CIDR,10.0.0.0/23\r\n"
+         "DOMAIN,b.com\r\n");
+  assert(aggregateCidrRules("IP-CIDR,10.0.0.0/24\rIP-CIDR,10.0.1.0/24\r") ==
+         "IP-CIDR,10.0.0.0/23\r");
+
+  // A body without a final line break does not gain one, whether it ends
+  // with a kept line or with a merged range.
+  assert(aggregateCidrRules("IP-CIDR,10.0.0.0/24\nIP-CIDR,10.0.1.0/24") ==
+         "IP-CIDR,10.0.0.0/23");
+  assert(aggregateCidrRules("IP-CIDR,10.0.0.0/24\r\n"
+                            "IP-CIDR,10.0.1.0/24\r\n"
+                            "DOMAIN,a.com") ==
+         "IP-CIDR,10.0.0.0/23\r\nDOMAIN,a.com");
+  assert(aggregateCidrRules("IP-CIDR,10.0.0.1/32") == "IP-CIDR,10.0.0.1/32");
+}
+
+int main() {
+  testMerging();
+  testKeptAsIs();
+  testLineEndings();
+  return 0;
+}
@@ -0,0 +1,88 @@
+#include <cassert>
+#include <string>
+#include <vector>
+
+#include "parser/clash_proxy_stream.h"
+
+namespace {
+
+std::vector<std::string> collect(const std::string &content, bool &found) {
+  std::vector<std::string> items;
+  found = forEachClashProxyItem(
+      content,
+      [&](const std::pmr::string &item) { items.emplace_back(item); });
+  return items;
+}
+
+void testExtractsOnlyProxyItems() {
+  const std::string content = "port: 7890\n"
+                              "proxies:\n"
+                              "  - name: a\n"
+                              "    type: ss\n"
+                              "\n"
+                              "    # comment inside an item\n"
+                              "  - {name: b, type: trojan}\n"
+                              "  -\n"
+                              "    name: c\n"
+                              "rules:\n"
+                              "  - MATCH,DIRECT\n";
+  bool found = false;
+  auto items = collect(content, found);
+  assert(found);
+  assert(items.size() == 3);
+  assert(items[0] == "- name: a\n  type: ss\n\n\n");
+  assert(items[1] == "- {name: b, type: trojan}\n");
+  assert(items[2] == "-\n  name: c\n");
+}
+
+void testZeroIndentSequenceAndCrLf() {
+  const std::string content = "Proxy:\r\n"
+                              "- name: a\r\n"
+                              "  port: 1\r\n"
+                              "- name: b\r\n"
+                              "proxy-groups:\r\n"
+                              "- name: g\r\n";
+  bool found = false;
+  auto items = collect(content, found);
+  assert(found);
+  assert(items.size() == 2);
+  assert(items[0] == "- name: a\n  port: 1\n");
+  assert(items[1] == "- name: b\n");
+}
+
+void testQuotedHeaderAndDocumentEnd() {
+  bool found = false;
+  auto items = collect("\"proxies\": # list\n  - name: a\n---\n- name: b\n",
+                       found);
+  assert(found);
+  assert(items.size() == 1);
+  assert(items[0] == "- name: a\n");
+}
+
+void testFallsBackWhenNotBlockStyle() {
+  bool found = true;
+  collect("proxies: [{name: a}]\n", found);
+  assert(!found);
+  collect("  proxies:\n    - name: nested\n", found);
+  assert(!found);
+  collect("proxy-groups:\n  - name: g\n", found);
+  assert(!found);
+}
+
+void testEmptySection() {
+  bool found = false;
+  auto items = collect("proxies:\nrules:\n  - MATCH,DIRECT\n", found);
+  assert(found);
+  assert(items.empty());
+}
+
+} // namespace
+
+int main() {
+  testExtractsOnlyProxyItems();
+  testZeroIndentSequenceAndCrLf();
+  testQuotedHeaderAndDocumentEnd();
+  testFallsBackWhenNotBlockStyle();
+  testEmptySection();
+  return 0;
+}
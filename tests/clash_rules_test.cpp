@@ -0,0 +1,91 @@
+#ifdef NDEBUG
+#undef NDEBUG
+#endif
+#include <cassert>
+#include <string>
+#include <vector>
+
+#include "config/ruleset.h"
+#include "generator/config/clash_rules.h"
+
+static std::string target(std::string_view rule, std::string_view group,
+                          bool no_resolve_only = false) {
+  std::string output;
+  emitClashRuleTarget(output, rule, group, no_resolve_only);
+  return output;
+}
+
+static void testPrefixTrie() {
+  const RuleTypePrefixTrie types({"DOMAIN", "DOMAIN-SUFFIX", "IP-CIDR",
+                                  "IP-CIDR6", "MATCH"});
+  assert(types.matchesPrefix("DOMAIN,example.com"));
+  assert(types.matchesPrefix("DOMAIN-SUFFIX,example.com"));
+  // Prefix matching, the same as the startsWith() scan it replaces.
+  assert(types.matchesPrefix("DOMAIN-KEYWORD,example"));
+  assert(types.matchesPrefix("IP-CIDR6,2001:db8::/32"));
+  assert(types.matchesPrefix("MATCH"));
+  assert(!types.matchesPrefix("domain,example.com"));
+  assert(!types.matchesPrefix("DOMAI"));
+  assert(!types.matchesPrefix("GEOIP,CN"));
+  assert(!types.matchesPrefix(""));
+
+  assert(RuleTypePrefixTrie({""}).matchesPrefix("anything"));
+  assert(!RuleTypePrefixTrie({}).matchesPrefix("DOMAIN"));
+}
+
+static void testRuleTarget() {
+  assert(target("DOMAIN,example.com", "Proxy") == "DOMAIN,example.com,Proxy");
+  assert(target(" FINAL ", "Proxy") == "MATCH,Proxy");
+  assert(target("match,DIRECT", "Proxy") == "MATCH,Proxy");
+  assert(target("IP-CIDR,1.1.1.0/24, no-resolve ,extra", "Proxy") ==
+         "IP-CIDR,1.1.1.0/24,Proxy,no-resolve");
+  assert(target("GEOIP,CN,DIRECT", "Proxy", true) == "GEOIP,CN,Proxy");
+  assert(target("AND,((DOMAIN,a),(DOMAIN,b))", "Proxy") ==
+         "AND,((DOMAIN,a),(DOMAIN,b)),Proxy");
+  assert(target("DOMAIN,", "Proxy") == "DOMAIN,,Proxy");
+  assert(target("DOMAIN,a,", "Proxy") == "DOMAIN,a,Proxy");
+  assert(target("DOMAIN,a,,", "Proxy") == "DOMAIN,a,Proxy,");
+}
+
+static void testRuleLine() {
+  const RuleTypePrefixTrie types({"DOMAIN", "IP-CIDR", "IP-CIDR6", "MATCH"});
+  RulesetOptions no_resolve;
+  no_resolve.no_resolve = true;
+
+  std::string output = "  - ";
+  assert(!emitClashRuleLine(output, "  # comment", "Proxy",
+                            RULESET_CLASH_DOMAIN, {}, types));
+  assert(!emitClashRuleLine(output, "// comment", "Proxy",
+                            RULESET_CLASH_DOMAIN, {}, types));
+  assert(!emitClashRuleLine(output, "GEOIP,CN", "Proxy", RULESET_CLASH_DOMAIN,
+                            {}, types));
+  assert(!emitClashRuleLine(output, " \r", "Proxy", RULESET_CLASH_DOMAIN, {},
+                            types));
+  assert(output == "  - ");
+
+  assert(emitClashRuleLine(output, " DOMAIN,example.com // note\r", "Proxy",
+                           RULESET_CLASH_DOMAIN, {}, types));
+  assert(output == "  - DOMAIN,example.com,Proxy");
+
+  output.clear();
+  assert(emitClashRuleLine(output, "IP-CIDR6,2001:db8::/32", "Proxy",
+                           RULESET_CLASH_IPCIDR, no_resolve, types));
+  assert(output == "IP-CIDR6,2001:db8::/32,Proxy,no-resolve");
+
+  output.clear();
+  assert(emitClashRuleLine(output, "IP-CIDR,10.0.0.0/8,NO-RESOLVE", "Proxy",
+                           RULESET_CLASH_IPCIDR, no_resolve, types));
+  assert(output == "IP-CIDR,10.0.0.0/8,Proxy,NO-RESOLVE");
+
+  output.clear();
+  assert(emitClashRuleLine(output, "IP-CIDR,10.0.0.0/8", "Proxy",
+                           RULESET_CLASH_CLASSICAL, no_resolve, types));
+  assert(output == "IP-CIDR,10.0.0.0/8,Proxy");
+}
+
+int main() {
+  testPrefixTrie();
+  testRuleTarget();
+  testRuleLine();
+  return 0;
+}
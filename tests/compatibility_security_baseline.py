@@ -2836,6 +2836,21 @@ def conversion_baselines(
         if ruleset_type == "6":
             assert_golden("getruleset.yaml", ruleset_output, update_golden)
 
+    ruleset_params = {"url": encoded_ruleset, "type": "6"}
+    status, body, headers = request(base_url, "/getruleset", ruleset_params)
+    etag = headers.get("etag", "")
+    if status != 200 or etag != f'"{hashlib.md5(body).hexdigest()}"':
+        raise AssertionError(
+            f"/getruleset did not return a content ETag: {status} {etag!r}"
+        )
+    status, body, _ = request(
+        base_url, "/getruleset", ruleset_params, headers={"If-None-Match": etag}
+    )
+    if status != 304 or body:
+        raise AssertionError(
+            f"/getruleset ignored a matching If-None-Match: {status} {body!r}"
+        )
+
     encoded_mixed_ruleset = base64.urlsafe_b64encode(
         (fixture_base + "/rules-with-invalid.list").encode()
     ).decode()
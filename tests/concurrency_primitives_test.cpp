@@ -185,6 +185,36 @@ static void testConcurrentLruCache() {
   assert(exceptional_computations == 1);
 }
 
+static void testConcurrentLruCachePut() {
+  ConcurrentLruCache<std::string, std::string> cache(2, 8);
+  int computations = 0;
+  auto compute = [&](const std::string &key) {
+    return cache.getOrCompute(
+        key, true,
+        [&] {
+          ++computations;
+          return std::string("computed");
+        },
+        [](const std::string &value)
+            -> ConcurrentLruCache<std::string, std::string>::CacheSize {
+          return value.size();
+        });
+  };
+  // A put replaces the entry a key already has and is then served as a hit.
+  assert(compute("file:1") == "computed");
+  cache.put("file:1", "rewrite", 7);
+  assert(compute("file:1") == "rewrite");
+  cache.put("file:2", "fresh", 5);
+  assert(compute("file:2") == "fresh");
+  assert(computations == 1);
+  assert(cache.size() == 1 && cache.bytes() == 5);
+  // Too large to keep: the stale value must not survive either.
+  cache.put("file:2", "123456789", 9);
+  assert(cache.size() == 0 && cache.bytes() == 0);
+  assert(compute("file:2") == "computed");
+  assert(computations == 2);
+}
+
 struct MockExternalConfig {
   std::string parsed;
   std::map<std::string, std::string> local_vars;
@@ -235,6 +265,7 @@ static void testExternalConfigCacheSemantics() {
 int main() {
   testBoundedExecutor();
   testConcurrentLruCache();
+  testConcurrentLruCachePut();
   testExternalConfigCacheSemantics();
   return 0;
 }
@@ -0,0 +1,52 @@
+#ifdef NDEBUG
+#undef NDEBUG
+#endif
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <set>
+#include <string>
+
+#include "utils/content_digest.h"
+
+int main() {
+  const std::string body = "payload:\n  - '+.example.com'\n";
+  assert(getContentDigest(body) == getContentDigest(std::string(body)));
+  assert(getContentDigest(body).size() ==
+         16 + 1 + std::to_string(body.size()).size());
+  assert(getContentDigest("").size() == 18);
+
+  // Every prefix and every single-byte change of a body spanning the short,
+  // 16-byte and 48-byte stripe paths must give a distinct hash.
+  std::string text;
+  for (int i = 0; i < 200; i++)
+    text += static_cast<char>('a' + i * 7 % 26);
+  std::set<uint64_t> hashes;
+  for (size_t length = 0; length <= text.size(); length++)
+    assert(hashes.insert(hashContent(text.substr(0, length))).second);
+  for (size_t i = 0; i < text.size(); i++) {
+    std::string changed = text;
+    changed[i] ^= 1;
+    assert(hashes.insert(hashContent(changed)).second);
+  }
+
+  // The previous multiply-mix hash xored fixed constants into one operand, so
+  // input words equal to such a constant zeroed the product and erased the
+  // other operand, whatever the seed. Bodies that only differ in the erased
+  // bytes must still hash apart.
+  const uint64_t constant = 0x8bb84b93962eacc9ull;
+  for (size_t length : {24, 40, 100, 200}) {
+    std::string base(length, 'x');
+    for (size_t offset = 0; offset + 16 <= length; offset += 16)
+      std::memcpy(&base[offset], &constant, sizeof(constant));
+    std::memcpy(&base[length - 16], &constant, sizeof(constant));
+    std::set<uint64_t> variants;
+    for (size_t i = 0; i < length; i++) {
+      std::string changed = base;
+      changed[i] ^= 0x55;
+      assert(hashContent(changed) != hashContent(base));
+      assert(variants.insert(hashContent(changed)).second);
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,219 @@
+#ifdef NDEBUG
+#undef NDEBUG
+#endif
+#include <cassert>
+#include <string>
+#include <vector>
+
+#include <yaml-cpp/yaml.h>
+
+#include "parser/subparser.h"
+#include "server/webserver.h"
+
+WebServer webServer;
+
+// The pre-streaming path: load the whole document and hand it to
+// explodeClash() in one go.
+static std::vector<Proxy> explodeWhole(const std::string &yaml) {
+  std::vector<Proxy> nodes;
+  explodeClash(YAML::Load(yaml), nodes);
+  return nodes;
+}
+
+static std::vector<Proxy> explodeStreamed(const std::string &yaml) {
+  std::vector<Proxy> nodes;
+  explodeSub(yaml, nodes);
+  return nodes;
+}
+
+static void requireSameNode(const Proxy &a, const Proxy &b) {
+  assert(a.Type == b.Type);
+  assert(a.Id == b.Id);
+  assert(a.Group == b.Group);
+  assert(a.Remark == b.Remark);
+  assert(a.Hostname == b.Hostname);
+  assert(a.Port == b.Port);
+  assert(a.Username == b.Username);
+  assert(a.Password == b.Password);
+  assert(a.EncryptMethod == b.EncryptMethod);
+  assert(a.Plugin == b.Plugin);
+  assert(a.PluginOption == b.PluginOption);
+  assert(a.UserId == b.UserId);
+  assert(a.AlterId == b.AlterId);
+  assert(a.TransferProtocol == b.TransferProtocol);
+  assert(a.Host == b.Host);
+  assert(a.Path == b.Path);
+  assert(a.Edge == b.Edge);
+  assert(a.TLSSecure == b.TLSSecure);
+  assert(a.ServerName == b.ServerName);
+  assert(a.SNI == b.SNI);
+  assert(a.UDP == b.UDP);
+  assert(a.TCPFastOpen == b.TCPFastOpen);
+  assert(a.AllowInsecure == b.AllowInsecure);
+  assert(a.Ports == b.Ports);
+  assert(a.Alpn == b.Alpn);
+  assert(a.AlpnList == b.AlpnList);
+  assert(a.OBFSPassword == b.OBFSPassword);
+  assert(a.UpMbps == b.UpMbps);
+  assert(a.DownMbps == b.DownMbps);
+}
+
+static void requireParity(const std::string &yaml, size_t expected) {
+  const std::vector<Proxy> whole = explodeWhole(yaml);
+  const std::vector<Proxy> streamed = explodeStreamed(yaml);
+  assert(whole.size() == expected);
+  assert(streamed.size() == whole.size());
+  for (size_t i = 0; i < whole.size(); i++)
+    requireSameNode(whole[i], streamed[i]);
+}
+
+static void testBlockSectionMatchesWholeDocument() {
+  const std::string yaml =
+      "port: 7890\n"
+      "proxies:\n"
+      "  - name: ss-obfs\n"
+      "    type: ss\n"
+      "    server: ss.example.com\n"
+      "    port: 8388\n"
+      "    cipher: aes-128-gcm\n"
+      "    password: secret\n"
+      "    udp: true\n"
+      "    plugin: obfs\n"
+      "    plugin-opts:\n"
+      "      mode: tls\n"
+      "      host: bing.com\n"
+      "  - name: vmess-ws\n"
+      "    type: vmess\n"
+      "    server: vmess.example.com\n"
+      "    port: 443\n"
+      "    uuid: 11111111-1111-1111-1111-111111111111\n"
+      "    alterId: 0\n"
+      "    cipher: auto\n"
+      "    tls: true\n"
+      "    servername: cdn.example.com\n"
+      "    network: ws\n"
+      "    ws-opts:\n"
+      "      path: /ws\n"
+      "      headers:\n"
+      "        Host: cdn.example.com\n"
+      "  # not a proxy type explodeClash knows; skipped by both paths\n"
+      "  - name: unknown\n"
+      "    type: carrier-pigeon\n"
+      "    server: coop.example.com\n"
+      "    port: 1\n"
+      "  - {name: trojan, type: trojan, server: trojan.example.com, port: 443,"
+      " password: pw, sni: t.example.com, skip-cert-verify: true}\n"
+      "  - name: socks\n"
+      "    type: socks5\n"
+      "    server: socks.example.com\n"
+      "    port: 1080\n"
+      "    username: user\n"
+      "    password: pass\n"
+      "  - name: http\n"
+      "    type: http\n"
+      "    server: http.example.com\n"
+      "    port: 8080\n"
+      "    tls: true\n"
+      "  - name: hy2\n"
+      "    type: hysteria2\n"
+      "    server: hy2.example.com\n"
+      "    port: 443\n"
+      "    password: hy2pass\n"
+      "    up: 50 Mbps\n"
+      "    down: 200 Mbps\n"
+      "    obfs: salamander\n"
+      "    obfs-password: salt\n"
+      "    alpn:\n"
+      "      - h3\n"
+      "rules:\n"
+      "  - DOMAIN-SUFFIX,example.com,DIRECT\n"
+      "  - MATCH,DIRECT\n";
+  requireParity(yaml, 6);
+
+  const std::vector<Proxy> nodes = explodeStreamed(yaml);
+  assert(nodes[0].Type == ProxyType::Shadowsocks);
+  assert(nodes[0].Plugin == "obfs-local");
+  assert(nodes[1].Type == ProxyType::VMess);
+  assert(nodes[1].Path == "/ws");
+  assert(nodes[2].Type == ProxyType::Trojan);
+  assert(nodes[5].Type == ProxyType::Hysteria2);
+  for (size_t i = 0; i < nodes.size(); i++)
+    assert(nodes[i].Id == i);
+}
+
+static void testLegacyProxyKey() {
+  requireParity("Proxy:\n"
+                "- name: a\n"
+                "  type: ss\n"
+                "  server: a.example.com\n"
+                "  port: 1\n"
+                "  cipher: aes-256-gcm\n"
+                "  password: p\n"
+                "- name: b\n"
+                "  type: trojan\n"
+                "  server: b.example.com\n"
+                "  port: 2\n"
+                "  password: q\n"
+                "Proxy Group: []\n",
+                2);
+}
+
+static void testFlowSectionFallsBack() {
+  requireParity("proxies: [{name: a, type: socks5, server: a.example.com,"
+                " port: 1080}, {name: b, type: http, server: b.example.com,"
+                " port: 8080}]\n",
+                2);
+}
+
+static void testCrossItemAnchorFallsBack() {
+  // The second item's alias only resolves against the first item, so the
+  // per-item loader gives up and the whole section is loaded instead.
+  requireParity("proxies:\n"
+                "  - name: a\n"
+                "    type: trojan\n"
+                "    server: a.example.com\n"
+                "    port: 443\n"
+                "    password: &shared pw\n"
+                "  - name: b\n"
+                "    type: trojan\n"
+                "    server: b.example.com\n"
+                "    port: 443\n"
+                "    password: *shared\n",
+                2);
+  const std::vector<Proxy> nodes = explodeStreamed("proxies:\n"
+                                                   "  - name: a\n"
+                                                   "    type: trojan\n"
+                                                   "    server: a.example.com\n"
+                                                   "    port: 443\n"
+                                                   "    password: &shared pw\n"
+                                                   "  - name: b\n"
+                                                   "    type: trojan\n"
+                                                   "    server: b.example.com\n"
+                                                   "    port: 443\n"
+                                                   "    password: *shared\n");
+  assert(nodes.size() == 2);
+  assert(nodes[1].Password == "pw");
+}
+
+static void testAppendsAfterExistingNodes() {
+  const std::string yaml = "proxies:\n"
+                           "  - name: a\n"
+                           "    type: socks5\n"
+                           "    server: a.example.com\n"
+                           "    port: 1080\n";
+  std::vector<Proxy> whole(2), streamed(2);
+  explodeClash(YAML::Load(yaml), whole);
+  explodeSub(yaml, streamed);
+  assert(whole.size() == 3 && streamed.size() == 3);
+  requireSameNode(whole[2], streamed[2]);
+  assert(streamed[2].Id == 2);
+}
+
+int main() {
+  testBlockSectionMatchesWholeDocument();
+  testLegacyProxyKey();
+  testFlowSectionFallsBack();
+  testCrossItemAnchorFallsBack();
+  testAppendsAfterExistingNodes();
+  return 0;
+}
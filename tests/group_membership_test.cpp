@@ -0,0 +1,153 @@
+#ifdef NDEBUG
+#undef NDEBUG
+#endif
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "generator/config/group_membership.h"
+#include "generator/config/subexport.h"
+#include "generator/config/nodemanip.h"
+#include "server/webserver.h"
+#include "utils/regexp.h"
+
+WebServer webServer;
+
+// The per-group matching GroupMembership replaced: every group evaluated its
+// rule against every node on its own.
+static GroupMembership::Bits referenceMembers(const std::vector<Proxy> &nodes,
+                                              const std::string &rule) {
+  GroupMembership::Bits bits((nodes.size() + 63) / 64, 0);
+  std::string real_rule;
+  for (size_t i = 0; i < nodes.size(); i++) {
+    if (applyMatcher(rule, real_rule, nodes[i]) &&
+        (real_rule.empty() || regFind(nodes[i].Remark, real_rule)))
+      bits[i / 64] |= uint64_t(1) << (i % 64);
+  }
+  return bits;
+}
+
+static std::vector<Proxy> makeNodes(size_t count) {
+  static const char *regions[] = {"香港 HK", "日本 JP", "美国 US",
+                                  "Singapore SG", "台湾 TW"};
+  static const ProxyType types[] = {ProxyType::Shadowsocks, ProxyType::VMess,
+                                    ProxyType::Trojan, ProxyType::Hysteria2};
+  std::vector<Proxy> nodes(count);
+  for (size_t i = 0; i < count; i++) {
+    Proxy &node = nodes[i];
+    node.Type = types[i % 4];
+    node.Group = i % 3 ? "Provider A" : "Provider B";
+    node.GroupId = static_cast<uint32_t>(i % 3);
+    node.Port = static_cast<uint16_t>(i % 7 ? 10000 + i % 100 : 443);
+    node.Hostname = std::string(i % 5 == 1 ? "jp" : "edge") +
+                    std::to_string(i) + ".example.net";
+    node.Remark = std::string(regions[i % 5]) + " " + std::to_string(i) +
+                  (i % 6 == 0 ? " IPLC" : "") + (i % 4 == 3 ? " x2" : "");
+  }
+  return nodes;
+}
+
+static ProxyGroupConfigs makeGroups() {
+  const std::vector<string_array> rules = {
+      {"香港|HK", "(?i)japan|JP", "[]DIRECT"},
+      {"^美国", "IPLC", "x2$"},
+      {".*", "香港|HK"},
+      {"!!GROUP=Provider A", "!!GROUP=B!!香港", "script:filter.js"},
+      {"!!GROUPID=1", "!!GROUPID=0-1!!JP", "!!GROUPID=!2"},
+      {"!!TYPE=SS|VMESS", "!!TYPE=TROJAN!!SG", "!!TYPE=HYSTERIA2"},
+      {"!!PORT=443", "!!PORT=10000-10050", "!!SERVER=^jp"},
+      {"(?i)japan|JP", "!!PORT=443"}};
+  ProxyGroupConfigs groups;
+  for (const string_array &proxies : rules) {
+    ProxyGroupConfig group;
+    group.Name = "group-" + std::to_string(groups.size());
+    group.Proxies = proxies;
+    groups.push_back(group);
+  }
+  return groups;
+}
+
+static void checkAgainstReference(size_t node_count, bool expect_parallel) {
+  const std::vector<Proxy> nodes = makeNodes(node_count);
+  const ProxyGroupConfigs groups = makeGroups();
+
+  std::atomic<size_t> parallel_calls{0};
+  const ParallelFor parallel_for =
+      [&](size_t count, size_t min_chunk,
+          const std::function<void(size_t, size_t)> &body) {
+        parallel_calls++;
+        std::vector<std::thread> workers;
+        for (size_t begin = 0; begin < count; begin += min_chunk)
+          workers.emplace_back(body, begin, std::min(count, begin + min_chunk));
+        for (std::thread &worker : workers)
+          worker.join();
+      };
+  GroupMembership membership(nodes, groups, parallel_for);
+  assert((parallel_calls > 0) == expect_parallel);
+
+  // Rules repeated across groups are evaluated once; `[]` and `script:`
+  // rules are left to groupGenerate.
+  assert(membership.ruleCount() == 17);
+  assert(!GroupMembership::precomputable("[]DIRECT"));
+  assert(!GroupMembership::precomputable("script:filter.js"));
+
+  for (const ProxyGroupConfig &group : groups) {
+    for (const std::string &rule : group.Proxies) {
+      if (GroupMembership::precomputable(rule))
+        assert(membership.members(rule) == referenceMembers(nodes, rule));
+    }
+  }
+  // groupGenerate falls back to a remark match for `[]` rules when DIRECT
+  // is not added, and rules outside the groups are evaluated on demand.
+  assert(membership.members("[]DIRECT") == referenceMembers(nodes, "[]DIRECT"));
+  assert(membership.members("!!GROUP=Provider B!!IPLC") ==
+         referenceMembers(nodes, "!!GROUP=Provider B!!IPLC"));
+  assert(membership.ruleCount() == 19);
+}
+
+// Literal remark rules share one scan of each remark; workers then get whole
+// 64-node words rather than rules.
+static void checkLiteralRules() {
+  const std::vector<Proxy> nodes = makeNodes(2000);
+  ProxyGroupConfig group;
+  group.Name = "literals";
+  group.Proxies = {"香港|HK", "日本", "JP|Japan", "(?i)iplc", "IPLC",
+                   "x2",      "美国", "US",       "SG",       "台湾|TW",
+                   "0",       "99",   "(?i)none", "香港 HK 1", "^美国"};
+  const ProxyGroupConfigs groups = {group};
+
+  std::vector<size_t> counts;
+  const ParallelFor parallel_for =
+      [&](size_t count, size_t min_chunk,
+          const std::function<void(size_t, size_t)> &body) {
+        counts.push_back(count);
+        for (size_t begin = 0; begin < count; begin += min_chunk)
+          body(begin, std::min(count, begin + min_chunk));
+      };
+  GroupMembership membership(nodes, groups, parallel_for);
+  // 14 literal rules x 2000 nodes go over the 32 words of the node list; the
+  // lone regex rule stays inline.
+  assert((counts == std::vector<size_t>{(nodes.size() + 63) / 64}));
+  for (const std::string &rule : group.Proxies)
+    assert(membership.members(rule) == referenceMembers(nodes, rule));
+  assert(membership.ruleCount() == group.Proxies.size());
+}
+
+int main() {
+  // 17 rules x 60 nodes stays inline; 17 x 2000 is past the 16384 cells
+  // that justify the executor, and spans many 64-bit words.
+  checkAgainstReference(60, false);
+  checkAgainstReference(2000, true);
+
+  // Without an executor the large matrix is built inline all the same.
+  const std::vector<Proxy> nodes = makeNodes(2000);
+  GroupMembership inline_membership(nodes, makeGroups(), ParallelFor());
+  assert(inline_membership.members("!!TYPE=TROJAN!!SG") ==
+         referenceMembers(nodes, "!!TYPE=TROJAN!!SG"));
+
+  checkLiteralRules();
+  return 0;
+}
@@ -0,0 +1,67 @@
+#include <cassert>
+#include <string>
+#include <vector>
+
+#include "utils/pattern_set.h"
+#include "utils/regexp.h"
+
+static const std::vector<std::string> kPatterns = {
+    "香港|HK",      "(?i)iplc|bgp", "日本|JP|Japan", "^US",   "(?i)hong kong",
+    "(?i)sg",       "剩余|到期",     "x2|X3",          "",      "(unclosed",
+    "台湾|TW|",     "\\d{2}",        "(?i)美国|US",    "Korea", "K"};
+
+static const std::vector<std::string> kSubjects = {
+    "香港 IPLC 01",  "HK-BGP 02",  "日本 Tokyo",  "US West",   "Hong Kong 03",
+    "hong kong",     "SG 01",      "ſg 01",  "剩余流量：10GB", "x2 倍率",
+    "台湾 01",       "",           "Korea 03",    "K 04", "US\xff broken"};
+
+static void testMatchesRegFind() {
+  PatternSet set(kPatterns);
+  assert(set.size() == kPatterns.size());
+  assert(set.literalCount() > 0);
+  std::vector<bool> matched;
+  std::vector<uint32_t> indices;
+  for (const std::string &subject : kSubjects) {
+    bool any = false;
+    set.matchAll(subject, matched);
+    set.matchIndices(subject, indices);
+    std::vector<uint32_t> expected_indices;
+    for (size_t i = 0; i < kPatterns.size(); i++) {
+      const bool expected = regFind(subject, kPatterns[i]);
+      assert(matched[i] == expected);
+      if (expected)
+        expected_indices.push_back(static_cast<uint32_t>(i));
+      any = any || expected;
+      assert(PatternSet::literal(kPatterns[i]) ==
+             (PatternSet({kPatterns[i]}).literalCount() == 1));
+
+      PatternSet single({kPatterns[i]});
+      assert(single.matchAny(subject) == expected);
+    }
+    assert(set.matchAny(subject) == any);
+    assert(indices == expected_indices);
+  }
+}
+
+static void testOverlappingLiterals() {
+  PatternSet set({"he", "she", "his", "hers"});
+  assert(set.literalCount() == 4);
+  std::vector<bool> matched;
+  set.matchAll("ushers", matched);
+  assert((matched == std::vector<bool>{true, true, false, true}));
+  // "he" occurs twice and is still reported once.
+  std::vector<uint32_t> indices;
+  set.matchIndices("ushers hers", indices);
+  assert((indices == std::vector<uint32_t>{0, 1, 3}));
+  assert(PatternSet::literal("香港|HK") && PatternSet::literal("(?i)iplc"));
+  assert(!PatternSet::literal("^US") && !PatternSet::literal("(?i)sg") &&
+         !PatternSet::literal("a||b") && !PatternSet::literal(""));
+  assert(!PatternSet({"abc"}).matchAny("ab"));
+  assert(!PatternSet().matchAny("anything"));
+}
+
+int main() {
+  testMatchesRegFind();
+  testOverlappingLiterals();
+  return 0;
+}
@@ -0,0 +1,403 @@
+#ifdef NDEBUG
+#undef NDEBUG
+#endif
+#include <algorithm>
+#include <cassert>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "generator/config/subexport.h"
+#include "generator/config/nodemanip.h"
+#include "handler/multithread.h"
+#include "handler/settings.h"
+#include "handler/settings_view.h"
+#include "script/script_quickjs.h"
+#include "server/webserver.h"
+
+WebServer webServer;
+
+static Proxy makeNode(const std::string &remark, const std::string &group) {
+  Proxy node;
+  node.Type = ProxyType::Shadowsocks;
+  node.Remark = remark;
+  node.Group = group;
+  node.Hostname = "edge.example.net";
+  node.Port = 443;
+  return node;
+}
+
+// Everything the final remark depends on is part of the fingerprint, and
+// rules that look past the remark turn the memo off.
+static void testRemarkMemoFingerprint() {
+  extra_settings ext;
+  ext.rename_array = {{"HK", "Hong Kong", ""}};
+  ext.emoji_array = {{"Hong Kong", "🇭🇰", ""}};
+  ext.add_emoji = true;
+  const std::string base = remarkMemoFingerprint(ext, false);
+  assert(!base.empty());
+  assert(remarkMemoFingerprint(ext, false) == base);
+  assert(remarkMemoFingerprint(ext, true).empty());
+
+  ext.remove_emoji = true;
+  assert(remarkMemoFingerprint(ext, false) != base);
+  ext.remove_emoji = false;
+  ext.add_emoji = false;
+  assert(remarkMemoFingerprint(ext, false) != base);
+  ext.add_emoji = true;
+  ext.rename_array[0].Replace = "HongKong";
+  assert(remarkMemoFingerprint(ext, false) != base);
+  ext.rename_array[0].Replace = "Hong Kong";
+  ext.rename_array[0].Match = "(?i)hk";
+  assert(remarkMemoFingerprint(ext, false) != base);
+  ext.rename_array[0].Match = "HK";
+  ext.emoji_array[0].Replace = "🏳️";
+  assert(remarkMemoFingerprint(ext, false) != base);
+  ext.emoji_array[0].Replace = "🇭🇰";
+  ext.emoji_array.push_back({"Japan", "🇯🇵", ""});
+  assert(remarkMemoFingerprint(ext, false) != base);
+  ext.emoji_array.pop_back();
+  assert(remarkMemoFingerprint(ext, false) == base);
+
+  // A rule cannot pass for one in the other list.
+  extra_settings moved;
+  moved.rename_array = {{"HK", "Hong Kong", ""}, {"Hong Kong", "🇭🇰", ""}};
+  moved.add_emoji = true;
+  assert(remarkMemoFingerprint(moved, false) != base);
+
+  ext.rename_array.push_back({"!!GROUP=Alpha!!HK", "Alpha HK", ""});
+  assert(remarkMemoFingerprint(ext, false).empty());
+  ext.rename_array.pop_back();
+  ext.emoji_array.push_back({"!!TYPE=SS", "🧦", ""});
+  assert(remarkMemoFingerprint(ext, false).empty());
+  // Emoji rules only count while emojis are added.
+  ext.add_emoji = false;
+  assert(!remarkMemoFingerprint(ext, false).empty());
+}
+
+static void testRemarkMemoInPreprocess() {
+  // Equal remarks from different groups: a memoized result for one would be
+  // handed to the other, in either order and on every later request.
+  extra_settings grouped;
+  grouped.rename_array = {{"!!GROUP=Alpha!!HK", "Alpha HK", ""}};
+  for (int round = 0; round < 2; round++) {
+    std::vector<Proxy> nodes = {makeNode("HK 01", "Beta"),
+                                makeNode("HK 01", "Alpha"),
+                                makeNode("HK 01", "Beta")};
+    preprocessNodes(nodes, grouped);
+    assert(nodes[0].Remark == "HK 01");
+    assert(nodes[1].Remark == "Alpha HK 01");
+    assert(nodes[2].Remark == "HK 01");
+  }
+
+  // Memoized remarks follow the rules they were computed with.
+  extra_settings ext;
+  ext.rename_array = {{"HK", "Hong Kong", ""}};
+  ext.emoji_array = {{"Hong Kong", "🇭🇰", ""}};
+  for (int round = 0; round < 2; round++) {
+    std::vector<Proxy> nodes = {makeNode("HK 01", "Alpha")};
+    preprocessNodes(nodes, ext);
+    assert(nodes[0].Remark == "Hong Kong 01");
+  }
+  ext.add_emoji = true;
+  std::vector<Proxy> nodes = {makeNode("HK 01", "Alpha")};
+  preprocessNodes(nodes, ext);
+  assert(nodes[0].Remark == "🇭🇰 Hong Kong 01");
+  ext.rename_array[0].Replace = "HongKong";
+  ext.emoji_array[0].Match = "HongKong";
+  nodes = {makeNode("HK 01", "Alpha")};
+  preprocessNodes(nodes, ext);
+  assert(nodes[0].Remark == "🇭🇰 HongKong 01");
+  ext.remove_emoji = true;
+  ext.add_emoji = false;
+  nodes = {makeNode("🇭🇰 HK 01", "Alpha")};
+  preprocessNodes(nodes, ext);
+  assert(nodes[0].Remark == "HongKong 01");
+}
+
+static std::vector<Proxy> makeNodeList(size_t count) {
+  static const char *regions[] = {"🇭🇰 HK", "JP", "US", "🇸🇬 SG", "HK IPLC"};
+  std::vector<Proxy> nodes;
+  nodes.reserve(count);
+  for (size_t i = 0; i < count; i++) {
+    // Every remark appears several times, spread across chunks.
+    Proxy node = makeNode(std::string(regions[i % 5]) + " " +
+                              std::to_string(i % 700),
+                          i % 3 ? "Alpha" : "Beta");
+    node.Hostname = "node" + std::to_string(i) + ".example.net";
+    nodes.push_back(std::move(node));
+  }
+  return nodes;
+}
+
+// preprocessNodes on each slice of at most 500 nodes, below the parallel
+// threshold, then the same final sort as preprocessNodes.
+static std::vector<Proxy> preprocessSerially(std::vector<Proxy> nodes,
+                                             extra_settings &ext) {
+  const size_t kSlice = 500;
+  const bool sort = ext.sort_flag;
+  ext.sort_flag = false;
+  std::vector<Proxy> result;
+  for (size_t begin = 0; begin < nodes.size(); begin += kSlice) {
+    std::span<Proxy> slice = std::span<Proxy>(nodes).subspan(
+        begin, std::min(kSlice, nodes.size() - begin));
+    std::vector<Proxy> part(std::make_move_iterator(slice.begin()),
+                            std::make_move_iterator(slice.end()));
+    preprocessNodes(part, ext);
+    std::move(part.begin(), part.end(), std::back_inserter(result));
+  }
+  ext.sort_flag = sort;
+  if (sort)
+    std::stable_sort(
+        result.begin(), result.end(),
+        [](const Proxy &a, const Proxy &b) { return a.Remark < b.Remark; });
+  return result;
+}
+
+static void requireSameNodes(const std::vector<Proxy> &a,
+                             const std::vector<Proxy> &b) {
+  assert(a.size() == b.size());
+  for (size_t i = 0; i < a.size(); i++) {
+    assert(a[i].Remark == b[i].Remark);
+    assert(a[i].Hostname == b[i].Hostname);
+  }
+}
+
+static void testParallelMatchesSerial() {
+  // 3000 nodes split into several chunks of at least 256 on the executor.
+  assert(rulesetExecutorWorkerCount() > 0);
+  const std::vector<Proxy> input = makeNodeList(3000);
+
+  for (bool group_rule : {false, true}) {
+    for (bool sort : {false, true}) {
+      extra_settings ext;
+      ext.remove_emoji = true;
+      ext.add_emoji = true;
+      ext.sort_flag = sort;
+      ext.rename_array = {{"IPLC", "专线", ""}, {"^HK", "Hong Kong", ""}};
+      // A `!!` rule turns the remark memo off, so chunks run the rules.
+      if (group_rule)
+        ext.rename_array.push_back({"!!GROUP=Beta!!^US", "US Beta", ""});
+      ext.emoji_array = {{"Hong Kong", "🇭🇰", ""}, {"SG", "🇸🇬", ""},
+                         {"JP", "🇯🇵", ""}};
+
+      std::vector<Proxy> parallel = input;
+      preprocessNodes(parallel, ext);
+      // A second run answers from the memo filled by the first.
+      std::vector<Proxy> memoized = input;
+      preprocessNodes(memoized, ext);
+
+      // A rule that never matches gives the serial runs their own memo
+      // entries, so they do not just read back the parallel results.
+      extra_settings serial_ext;
+      serial_ext.remove_emoji = ext.remove_emoji;
+      serial_ext.add_emoji = ext.add_emoji;
+      serial_ext.sort_flag = ext.sort_flag;
+      serial_ext.rename_array = ext.rename_array;
+      serial_ext.rename_array.push_back({"^never matches$", "", ""});
+      serial_ext.emoji_array = ext.emoji_array;
+      const std::vector<Proxy> serial = preprocessSerially(input, serial_ext);
+
+      requireSameNodes(parallel, serial);
+      requireSameNodes(memoized, serial);
+      assert(std::count_if(serial.begin(), serial.end(), [](const Proxy &x) {
+               return x.Remark == "🇭🇰 Hong Kong 专线 4";
+             }) == 5);
+      if (group_rule)
+        assert(std::any_of(serial.begin(), serial.end(), [](const Proxy &x) {
+          return x.Remark == "US Beta 2";
+        }));
+    }
+  }
+}
+
+// extra_settings owns no runtime in these tests, so node scripts run in a
+// leased context, as they do with scriptCleanContext.
+class CleanScriptContext {
+public:
+  CleanScriptContext() : view_(snapshot()) {}
+
+private:
+  static SettingsSnapshot snapshot() {
+    Settings settings = global;
+    settings.scriptCleanContext = true;
+    return std::make_shared<const Settings>(std::move(settings));
+  }
+
+  ScopedSettingsView view_;
+};
+
+static std::vector<Proxy> sortWithScript(std::vector<Proxy> nodes,
+                                         const std::string &script) {
+  CleanScriptContext clean;
+  extra_settings ext;
+  ext.authorized = true;
+  ext.sort_flag = true;
+  ext.sort_script = script;
+  preprocessNodes(nodes, ext);
+  return nodes;
+}
+
+static std::string remarks(const std::vector<Proxy> &nodes) {
+  std::string joined;
+  for (const Proxy &node : nodes)
+    joined += node.Remark + " ";
+  return joined;
+}
+
+// Every node still carries its own fields after a sort or a fallback.
+static void requireIntact(const std::vector<Proxy> &nodes) {
+  for (const Proxy &node : nodes)
+    assert(node.Hostname == node.Remark + ".example.net");
+}
+
+static Proxy makeSortNode(const std::string &remark, uint16_t port = 443) {
+  Proxy node = makeNode(remark, "Alpha");
+  node.Hostname = remark + ".example.net";
+  node.Port = port;
+  return node;
+}
+
+static void testSortKeyOrdering() {
+  std::vector<Proxy> nodes;
+  for (const char *remark : {"a", "b", "u", "c", "d", "e", "f", "g", "h"})
+    nodes.push_back(makeSortNode(remark));
+  nodes[2].Type = ProxyType::Unknown;
+
+  // Numbers ascending, NaN after every number in input order, then strings
+  // (numeric-looking ones included) in byte order. Nodes of unknown type are
+  // never passed to the script and go first.
+  const std::vector<Proxy> sorted =
+      sortWithScript(nodes, "var keys = {a: 3, b: NaN, c: 1, d: 'zeta',"
+                            "  e: 'alpha', f: 2, g: NaN, h: '10'};"
+                            "function sortKey(node) {"
+                            "  if (node.Remark === 'u') throw new Error('u');"
+                            "  return keys[node.Remark];"
+                            "}");
+  assert(remarks(sorted) == "u c f a b g h e d ");
+  requireIntact(sorted);
+}
+
+static void testSortKeyRunsOncePerNode() {
+  std::vector<Proxy> nodes;
+  for (const char *remark : {"A", "B", "C", "D", "U"})
+    nodes.push_back(makeSortNode(remark));
+  nodes[4].Type = ProxyType::Unknown;
+
+  // A second call for any node throws, which would fall back to the remark
+  // order; called once per node in list order, the keys reverse the list.
+  const std::vector<Proxy> sorted =
+      sortWithScript(nodes, "var calls = 0;"
+                            "function sortKey(node) {"
+                            "  if (++calls > 4) throw new Error('again');"
+                            "  return -calls;"
+                            "}");
+  assert(remarks(sorted) == "U D C B A ");
+  requireIntact(sorted);
+}
+
+static void testSortScriptErrorsFallBackToRemarks() {
+  std::vector<Proxy> nodes = {makeSortNode("D", 1), makeSortNode("B", 4),
+                              makeSortNode("C", 2), makeSortNode("A", 3)};
+
+  // compare() without errors still orders the nodes.
+  std::vector<Proxy> sorted = sortWithScript(
+      nodes, "function compare(a, b) { return a.Port > b.Port; }");
+  assert(remarks(sorted) == "B A C D ");
+  requireIntact(sorted);
+
+  // A compare() error halfway through the sort leaves the list untouched for
+  // the remark order fallback.
+  sorted = sortWithScript(nodes, "function compare(a, b) {"
+                                 "  if (a.Remark === 'C' || b.Remark === 'C')"
+                                 "    throw new Error('C');"
+                                 "  return a.Remark < b.Remark;"
+                                 "}");
+  assert(remarks(sorted) == "A B C D ");
+  requireIntact(sorted);
+
+  // So does a failing sortKey() call, and a script that does not load.
+  sorted = sortWithScript(nodes, "function sortKey(node) {"
+                                 "  if (node.Port === 2) throw new Error('2');"
+                                 "  return -node.Port;"
+                                 "}");
+  assert(remarks(sorted) == "A B C D ");
+  requireIntact(sorted);
+  sorted = sortWithScript(nodes, "function sortKey(node) {");
+  assert(remarks(sorted) == "A B C D ");
+  requireIntact(sorted);
+}
+
+static std::string remarkScriptPass(std::vector<Proxy> nodes,
+                                    RegexMatchConfigs rename_array,
+                                    RegexMatchConfigs emoji_array = {}) {
+  CleanScriptContext clean;
+  extra_settings ext;
+  ext.authorized = true;
+  ext.rename_array = std::move(rename_array);
+  ext.emoji_array = std::move(emoji_array);
+  ext.add_emoji = !ext.emoji_array.empty();
+  preprocessNodes(nodes, ext);
+  std::string joined;
+  for (const Proxy &node : nodes)
+    joined += node.Remark + "|";
+  return joined;
+}
+
+static std::vector<Proxy> makeRemarkNodes() {
+  return {makeNode("HK 01", "Alpha"), makeNode("JP 01", "Alpha"),
+          makeNode("US 01", "Alpha"), makeNode("HK 02", "Alpha")};
+}
+
+// Rename and emoji scripts are evaluated once per rule and their function is
+// called once per node, with the same per-node results as before.
+static void testRemarkScriptsRunOncePerPass() {
+  // A stateless script gives what per-node evaluation gave; an empty result
+  // keeps the remark and a throw only skips its node.
+  assert(remarkScriptPass(
+             makeRemarkNodes(),
+             {{"", "",
+               "function rename(node) {"
+               "  if (node.Remark === 'US 01') throw new Error('US');"
+               "  if (node.Remark.startsWith('JP')) return '';"
+               "  return node.Remark.replace('HK', 'Hong Kong');"
+               "}"}}) == "Hong Kong 01|JP 01|US 01|Hong Kong 02|");
+
+  // State kept across calls shows one evaluation per rule and one call per
+  // node, in list order; the next rule starts from a fresh evaluation.
+  const std::string counting_rename = "var calls = 0;"
+                                      "function rename(node) {"
+                                      "  return node.Remark + ' #' + ++calls;"
+                                      "}";
+  assert(remarkScriptPass(makeRemarkNodes(), {{"", "", counting_rename},
+                                              {"", "", counting_rename}}) ==
+         "HK 01 #1 #1|JP 01 #2 #2|US 01 #3 #3|HK 02 #4 #4|");
+
+  // Emoji scripts only see the nodes no earlier emoji rule has decided, and
+  // the first rule that returns an emoji wins.
+  assert(remarkScriptPass(
+             makeRemarkNodes(), {},
+             {{"", "",
+               "var calls = 0;"
+               "function getEmoji(node) {"
+               "  ++calls;"
+               "  return node.Remark.startsWith('HK') ? 'HK' + calls : '';"
+               "}"},
+              {"JP", "🇯🇵", ""},
+              {"", "",
+               "var calls = 0;"
+               "function getEmoji(node) { return 'E' + ++calls; }"}}) ==
+         "HK1 HK 01|🇯🇵 JP 01|E1 US 01|HK4 HK 02|");
+}
+
+int main() {
+  testRemarkMemoFingerprint();
+  testRemarkMemoInPreprocess();
+  testParallelMatchesSerial();
+  testSortKeyOrdering();
+  testSortKeyRunsOncePerNode();
+  testSortScriptErrorsFallBackToRemarks();
+  testRemarkScriptsRunOncePerPass();
+  script_runtime_pool_shutdown();
+  return 0;
+}
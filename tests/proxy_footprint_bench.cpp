@@ -0,0 +1,145 @@
+#include <cassert>
+#include <cstddef>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "parser/config/proxy.h"
+
+// Reports the heap bytes allocated per parsed node, with and without a
+// request's string intern pool, and per node added to a generator's emission
+// list. Counting every allocation is enough here: the benchmark is
+// single-threaded and only measures deltas around the code under test.
+
+static std::size_t g_allocated_bytes = 0;
+
+// Every replaceable form is defined, so the scalar and array operators pair
+// up with the same malloc/free and GCC sees no mismatched new/delete.
+static void *countedAlloc(std::size_t size) {
+  g_allocated_bytes += size;
+  if (void *ptr = std::malloc(size ? size : 1))
+    return ptr;
+  throw std::bad_alloc();
+}
+
+void *operator new(std::size_t size) { return countedAlloc(size); }
+
+void *operator new[](std::size_t size) { return countedAlloc(size); }
+
+void operator delete(void *ptr) noexcept { std::free(ptr); }
+
+void operator delete(void *ptr, std::size_t) noexcept { std::free(ptr); }
+
+void operator delete[](void *ptr) noexcept { std::free(ptr); }
+
+void operator delete[](void *ptr, std::size_t) noexcept { std::free(ptr); }
+
+static Proxy makeNode(std::size_t index) {
+  Proxy node;
+  const std::string suffix = std::to_string(index);
+  node.Id = static_cast<uint32_t>(index);
+  node.Remark = "香港 HK-" + suffix + " | IPLC 专线 x1.5";
+  node.Hostname = "hk" + suffix + ".edge.example-provider.net";
+  node.Port = static_cast<uint16_t>(10000 + index % 5000);
+  switch (index % 20 == 19 ? 3 : index % 3) {
+  case 0:
+    node.Type = ProxyType::Shadowsocks;
+    node.Group = SS_DEFAULT_GROUP;
+    node.EncryptMethod = "chacha20-ietf-poly1305";
+    node.Password = "0b2f5c1e-9d8a-4f6b-a1c3-7e2d9f8b6a4c";
+    break;
+  case 1:
+    node.Type = ProxyType::VMess;
+    node.Group = V2RAY_DEFAULT_GROUP;
+    node.UserId = "0b2f5c1e-9d8a-4f6b-a1c3-7e2d9f8b6a4c";
+    node.EncryptMethod = "auto";
+    node.TransferProtocol = "ws";
+    node.Path = "/ray-websocket-path";
+    node.Host = "cdn.example-provider.net";
+    node.TLSStr = "tls";
+    break;
+  case 2:
+    node.Type = ProxyType::Trojan;
+    node.Group = TROJAN_DEFAULT_GROUP;
+    node.Password = "0b2f5c1e-9d8a-4f6b-a1c3-7e2d9f8b6a4c";
+    node.ServerName = "sni.example-provider.net";
+    break;
+  default:
+    node.Type = ProxyType::WireGuard;
+    node.Group = WG_DEFAULT_GROUP;
+    node.PublicKey = "Wz5Ulr0pKx2ZyPRGDHV0ePhJ4Vq7kEwLQzQ+f5uTdxw=";
+    node.PrivateKey = "YNXtAzepDqRv9H52osJVDQnznT5AM11eCK3ESpwSt04=";
+    node.SelfIP = "172.16.0.2";
+    node.Mtu = 1280;
+    break;
+  }
+  // Mihomo-parsed nodes also carry their complete canonical mapping.
+  node.CanonicalProxyJson = R"({"name":")" + node.Remark + R"(","server":")" +
+                            node.Hostname + R"(","port":)" +
+                            std::to_string(node.Port) +
+                            R"(,"udp":true,"skip-cert-verify":false})";
+  return node;
+}
+
+static std::size_t parseNodes(std::vector<Proxy> &nodes, std::size_t count) {
+  const std::size_t base = g_allocated_bytes;
+  nodes.reserve(count);
+  for (std::size_t i = 0; i < count; ++i)
+    nodes.emplace_back(makeNode(i));
+  return g_allocated_bytes - base;
+}
+
+int main() {
+  constexpr std::size_t kNodes = 10000;
+
+  // Without a pool every interned field value owns its buffer.
+  std::vector<Proxy> unpooled;
+  const std::size_t unpooled_cost = parseNodes(unpooled, kNodes);
+
+  std::vector<Proxy> nodes;
+  std::size_t parsed = 0, pooled_values = 0;
+  {
+    StringInternPool pool;
+    parsed = parseNodes(nodes, kNodes);
+    pooled_values = pool.size();
+  }
+  // Four groups plus the WireGuard private key and address.
+  assert(pooled_values == 6);
+  assert(parsed < unpooled_cost);
+  assert(nodes[0].Group.str() == SS_DEFAULT_GROUP);
+  assert(nodes[19].PrivateKey == unpooled[19].PrivateKey);
+  assert(nodes[1].AllowedIPs == "0.0.0.0/0, ::/0");
+
+  std::size_t before = g_allocated_bytes;
+  std::vector<Proxy> copied;
+  copied.reserve(nodes.size());
+  for (const Proxy &node : nodes)
+    copied.emplace_back(node);
+  const std::size_t copy_cost = g_allocated_bytes - before;
+
+  before = g_allocated_bytes;
+  std::vector<Proxy> moved;
+  moved.reserve(nodes.size());
+  for (Proxy &node : nodes)
+    moved.emplace_back(std::move(node));
+  const std::size_t move_cost = g_allocated_bytes - before;
+
+  // Moving only adds the vector storage; every string buffer changes owner.
+  assert(move_cost == kNodes * sizeof(Proxy));
+  assert(copy_cost > move_cost);
+
+  std::cout << "sizeof(Proxy): " << sizeof(Proxy) << " bytes, "
+            << "interned fields " << sizeof(InternedString) << " bytes each ("
+            << sizeof(std::string) << " as std::string)\n"
+            << "parsed node: " << parsed / kNodes << " bytes/node ("
+            << unpooled_cost / kNodes << " without an intern pool, "
+            << pooled_values << " pooled values)\n"
+            << "generator list (copy): " << copy_cost / kNodes
+            << " bytes/node\n"
+            << "generator list (move): " << move_cost / kNodes
+            << " bytes/node\n";
+  return 0;
+}
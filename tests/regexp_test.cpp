@@ -0,0 +1,132 @@
+#include <cassert>
+#include <future>
+#include <string>
+#include <vector>
+
+#include "utils/regexp.h"
+
+static void testEntryPoints() {
+  assert(regMatch("HK 01", "HK.*"));
+  assert(!regMatch("xHK 01", "HK.*"));
+  assert(regFind("香港 IPLC 01", "(?i)iplc"));
+  assert(!regFind("Japan 01", "(?i)iplc"));
+  assert(regReplace("a=b=c", "=", "-") == "a-b-c");
+  assert(regReplace("a=b=c", "=", "-", false) == "a-b=c");
+  assert(regReplace("line1\nline2", "^line", "L") == "L1\nL2");
+  assert(regReplace("  padded  ", R"(^\s*([\s\S]*?)\s*$)", "$1", false,
+                    false) == "padded");
+  assert(regTrim("  padded") == "padded");
+  assert(regValid("(a|b)+"));
+  assert(!regValid("(unclosed"));
+
+  std::string host, port;
+  assert(regGetMatch("example.com:443", R"(^(.*):(\d+)$)", 3, nullptr, &host,
+                     &port) == 0);
+  assert(host == "example.com" && port == "443");
+  assert(regGetMatch("no port", R"(^(.*):(\d+)$)", 3, nullptr, &host,
+                     &port) == -1);
+  assert((regGetAllMatch("a1 b2 c3", R"(([a-z])(\d))", true) ==
+          std::vector<std::string>{"a", "1", "b", "2", "c", "3"}));
+  // Patterns with different group counts must each see exactly their own
+  // groups through the reused match data blocks.
+  assert((regGetAllMatch("abcdef", "(a)(b)(c)(d)(e)(f)", true) ==
+          std::vector<std::string>{"a", "b", "c", "d", "e", "f"}));
+  assert((regGetAllMatch("HK 01", "HK", false) ==
+          std::vector<std::string>{"HK"}));
+}
+
+static void testCacheReuse() {
+  const RegexCacheStats before = regexCacheStats();
+  for (int i = 0; i < 100; ++i) {
+    assert(regFind("node " + std::to_string(i), "^node \\d+$"));
+    assert(!regFind("node", "(unclosed"));
+  }
+  const RegexCacheStats after = regexCacheStats();
+  assert(after.misses - before.misses == 2);
+  assert(after.hits - before.hits == 198);
+  assert(after.entries >= 2);
+  assert(after.entries <= regexCacheMaxEntries());
+}
+
+static void testKindsStayApart() {
+  // The same pattern compiles differently per entry point; the per-thread
+  // slots must not hand one kind's pattern to another.
+  for (int i = 0; i < 4; ++i) {
+    assert(!regMatch("xHK", "HK"));
+    assert(regFind("xHK", "HK"));
+    assert(regReplace("HK HK", "HK", "JP", false) == "JP HK");
+    assert(regReplace("HK HK", "HK", "JP") == "JP JP");
+  }
+}
+
+static void testSharedAcrossThreads() {
+  const std::string pattern = "^shared \\d+$";
+  const RegexCacheStats before = regexCacheStats();
+  assert(regFind("shared 0", pattern));
+  std::vector<std::future<bool>> workers;
+  for (int worker = 0; worker < 8; ++worker) {
+    workers.emplace_back(std::async(std::launch::async, [&pattern] {
+      bool ok = true;
+      for (int i = 0; i < 200; ++i)
+        ok = ok && regFind("shared " + std::to_string(i), pattern);
+      return ok;
+    }));
+  }
+  for (auto &worker : workers)
+    assert(worker.get());
+  const RegexCacheStats after = regexCacheStats();
+  // Compiled once; other threads start from the shared cache and then from
+  // their own slot.
+  assert(after.misses - before.misses == 1);
+  assert(after.hits - before.hits == 8 * 200);
+}
+
+static void testConcurrentUse() {
+  std::vector<std::future<bool>> workers;
+  for (int worker = 0; worker < 8; ++worker) {
+    workers.emplace_back(std::async(std::launch::async, [worker] {
+      bool ok = true;
+      for (int i = 0; i < 500; ++i) {
+        const std::string remark = "HK " + std::to_string(worker * 1000 + i);
+        ok = ok && regMatch(remark, "HK \\d+");
+        ok = ok && regReplace(remark, "^HK", "香港") ==
+                       "香港 " + std::to_string(worker * 1000 + i);
+        std::string digits;
+        ok = ok && regGetMatch(remark, "(\\d+)", 2, nullptr, &digits) == 0 &&
+             digits == std::to_string(worker * 1000 + i);
+      }
+      return ok;
+    }));
+  }
+  for (auto &worker : workers)
+    assert(worker.get());
+}
+
+static void testFullMatch() {
+  const FullMatchRegex stream(R"(^剩余流量：(.*?)\|总流量：(.*)$)");
+  assert(stream.valid());
+  std::string info = "unchanged";
+  assert(stream.replace("剩余流量：10GB|总流量：100GB", "total=$2&left=$1",
+                        info));
+  assert(info == "total=100GB&left=10GB");
+  // Only whole-subject matches count, exactly like regMatch().
+  const FullMatchRegex partial("HK");
+  assert(!partial.replace("HK 01", "x", info));
+  assert(info == "total=100GB&left=10GB");
+  assert(partial.replace("HK", "香港", info) && info == "香港");
+  // Unset groups expand to nothing.
+  const FullMatchRegex optional("(a)?b");
+  assert(optional.replace("b", "[$1]", info) && info == "[]");
+  assert(!FullMatchRegex("(unclosed").valid());
+  assert(!FullMatchRegex().replace("x", "y", info));
+}
+
+int main() {
+  testEntryPoints();
+  testFullMatch();
+  testCacheReuse();
+  testKindsStayApart();
+  testSharedAcrossThreads();
+  testConcurrentUse();
+  return 0;
+}
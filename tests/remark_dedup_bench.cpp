@@ -0,0 +1,69 @@
+#include <chrono>
+#include <cstddef>
+#include <iostream>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+#include "generator/config/remark_set.h"
+
+// Renames subscriptions where every node carries the same remark, the worst
+// case for duplicate resolution, and compares the suffix counters with the
+// probe loop they replaced.
+
+static std::vector<std::string> naiveDedup(std::size_t count) {
+  std::vector<std::string> remarks;
+  remarks.reserve(count);
+  std::unordered_set<std::string_view> used;
+  for (std::size_t i = 0; i < count; ++i) {
+    const std::string remark = "香港 IPLC 专线";
+    std::string candidate = remark;
+    int cnt = 2;
+    while (used.count(candidate)) {
+      candidate = remark + " " + std::to_string(cnt);
+      cnt++;
+    }
+    remarks.push_back(std::move(candidate));
+    used.emplace(remarks.back());
+  }
+  return remarks;
+}
+
+static std::vector<std::string> counterDedup(std::size_t count) {
+  std::vector<std::string> remarks;
+  remarks.reserve(count);
+  RemarkSet used(std::pmr::get_default_resource());
+  for (std::size_t i = 0; i < count; ++i) {
+    std::string remark = "香港 IPLC 专线";
+    processRemark(remark, used);
+    remarks.push_back(std::move(remark));
+    used.emplace(remarks.back());
+  }
+  return remarks;
+}
+
+template <class Function>
+static double elapsedMs(Function &&function) {
+  const auto start = std::chrono::steady_clock::now();
+  function();
+  return std::chrono::duration<double, std::milli>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+int main() {
+  for (std::size_t count : {1000, 2000, 5000}) {
+    std::vector<std::string> naive, counted;
+    const double naive_ms = elapsedMs([&] { naive = naiveDedup(count); });
+    const double counter_ms = elapsedMs([&] { counted = counterDedup(count); });
+    if (naive != counted) {
+      std::cerr << "outputs differ for " << count << " nodes\n";
+      return 1;
+    }
+    std::cout << count << " duplicate remarks: probe loop " << naive_ms
+              << " ms, suffix counter " << counter_ms << " ms\n";
+  }
+  return 0;
+}
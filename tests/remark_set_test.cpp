@@ -0,0 +1,83 @@
+#include <cassert>
+#include <memory_resource>
+#include <random>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "generator/config/remark_set.h"
+#include "utils/request_arena.h"
+
+// The probe loop processRemark() used before the suffix counters: the first
+// of remark, "remark 2", "remark 3", ... that is not taken.
+static std::string naiveUnique(const std::string &remark,
+                               const std::unordered_set<std::string> &used) {
+  std::string candidate = remark;
+  int cnt = 2;
+  while (used.count(candidate)) {
+    candidate = remark + " " + std::to_string(cnt);
+    cnt++;
+  }
+  return candidate;
+}
+
+static void testMatchesNaiveProbing() {
+  // Bases that collide with each other's suffixed forms ("HK 2" is both a
+  // base and the second "HK"), and nodes that are renamed but then not
+  // emitted, as generators do for unsupported types.
+  const std::vector<std::string> bases = {"HK", "HK 2", "HK 3", "HK 2 2",
+                                          "JP", "\"US, LA\""};
+  std::mt19937 random(20261018);
+  std::vector<std::string> owned;
+  owned.reserve(4096);
+  std::unordered_set<std::string> expected_used;
+  RemarkSet used(std::pmr::get_default_resource());
+  for (int i = 0; i < 4096; i++) {
+    const std::string &base = bases[random() % bases.size()];
+    const std::string expected = naiveUnique(base, expected_used);
+    assert(used.uniqueRemark(base) == expected);
+    if (random() % 4 == 0)
+      continue;
+    owned.push_back(expected);
+    expected_used.insert(expected);
+    used.emplace(owned.back());
+  }
+}
+
+static void testProcessRemark() {
+  std::vector<std::string> owned = {"a-b", "a-b 2", "\"x,y\""};
+  RemarkSet used(std::pmr::get_default_resource());
+  for (const std::string &remark : owned)
+    used.emplace(remark);
+
+  std::string remark = "a=b";
+  processRemark(remark, used);
+  assert(remark == "a-b 3");
+
+  remark = "x,y";
+  processRemark(remark, used);
+  assert(remark == "\"x,y\" 2");
+
+  remark = "x,y";
+  processRemark(remark, used, false);
+  assert(remark == "x,y");
+}
+
+static void testUsesArena() {
+  RequestArena arena(256);
+  std::vector<std::string> owned(64, "dup");
+  RemarkSet used(requestMemoryResource());
+  used.emplace(owned[0]);
+  for (size_t i = 1; i < owned.size(); i++) {
+    owned[i] = used.uniqueRemark(owned[i]);
+    used.emplace(owned[i]);
+  }
+  assert(owned.back() == "dup 64");
+}
+
+int main() {
+  testMatchesNaiveProbing();
+  testProcessRemark();
+  testUsesArena();
+  return 0;
+}
@@ -0,0 +1,134 @@
+#include <cassert>
+#include <cstddef>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_set>
+
+#include "parser/clash_proxy_stream.h"
+#include "utils/interned_string.h"
+#include "utils/request_arena.h"
+#include "utils/string.h"
+
+namespace {
+
+// Upstream for the arena under test: counts what the arena takes from it and
+// what is still outstanding.
+class CountingResource : public std::pmr::memory_resource {
+public:
+  size_t allocations = 0;
+  size_t outstanding = 0;
+
+private:
+  void *do_allocate(size_t bytes, size_t alignment) override {
+    allocations++;
+    outstanding += bytes;
+    return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+  }
+  void do_deallocate(void *p, size_t bytes, size_t alignment) override {
+    outstanding -= bytes;
+    std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+  }
+  bool do_is_equal(const memory_resource &other) const noexcept override {
+    return this == &other;
+  }
+};
+
+} // namespace
+
+static void testScopeInstallsArena() {
+  std::pmr::memory_resource *heap = std::pmr::get_default_resource();
+  assert(requestMemoryResource() == heap);
+  {
+    RequestArena outer;
+    assert(requestMemoryResource() == outer.resource());
+    {
+      RequestArena inner(256);
+      assert(requestMemoryResource() == inner.resource());
+    }
+    assert(requestMemoryResource() == outer.resource());
+
+    std::pmr::memory_resource *other_thread = nullptr;
+    std::thread([&] { other_thread = requestMemoryResource(); }).join();
+    assert(other_thread == heap);
+  }
+  assert(requestMemoryResource() == heap);
+}
+
+static void testContainersUseArena() {
+  RequestArena arena(128);
+  std::pmr::unordered_set<std::string_view> remarks(requestMemoryResource());
+  for (std::string_view remark : {"HK 01", "JP 01", "US 01", "HK 01"})
+    remarks.emplace(remark);
+  assert(remarks.size() == 3);
+  assert(remarks.count("JP 01") == 1);
+  assert(remarks.get_allocator().resource() == arena.resource());
+}
+
+// The conversion temporaries draw on the request's arena while one is active
+// and all of it goes back upstream when the request ends.
+static void testRequestTemporariesUseArena() {
+  CountingResource upstream;
+  {
+    // Too small for anything below, so every use shows up upstream.
+    RequestArena arena(16, &upstream);
+    const size_t before = upstream.allocations;
+
+    string_view_array fields(requestMemoryResource());
+    split(fields, "DOMAIN-SUFFIX,example.com,Proxy,no-resolve", ',');
+    assert(fields.size() == 4 && fields[1] == "example.com");
+    assert(fields.get_allocator().resource() == arena.resource());
+    assert(upstream.allocations > before);
+
+    const size_t after_split = upstream.allocations;
+    size_t items = 0;
+    const bool found = forEachClashProxyItem(
+        "proxies:\n"
+        "  - name: a-node-with-a-name-longer-than-the-sso-buffer\n"
+        "    type: ss\n"
+        "  - name: b\n",
+        [&](const std::pmr::string &item) {
+          assert(item.get_allocator().resource() == arena.resource());
+          items++;
+        });
+    assert(found && items == 2);
+    assert(upstream.allocations > after_split);
+    assert(upstream.outstanding > 0);
+  }
+  assert(upstream.outstanding == 0);
+
+  // Without a request the same calls stay on the heap.
+  string_view_array fields(requestMemoryResource());
+  split(fields, "GEOIP,CN,DIRECT", ',');
+  assert(fields.get_allocator().resource() ==
+         std::pmr::get_default_resource());
+}
+
+// The intern pool's lookup table lives on the arena; the interned values are
+// refcounted heap entries and survive both scopes.
+static void testInternPoolIndexUsesArena() {
+  CountingResource upstream;
+  InternedString survivor;
+  {
+    RequestArena arena(16, &upstream);
+    const size_t before = upstream.allocations;
+    StringInternPool pool;
+    InternedString a(std::string("chacha20-ietf-poly1305"));
+    InternedString b(std::string("chacha20-ietf-poly1305"));
+    survivor = InternedString(std::string("aes-128-gcm"));
+    assert(pool.size() == 2);
+    assert(a.c_str() == b.c_str());
+    assert(upstream.allocations > before);
+  }
+  assert(upstream.outstanding == 0);
+  assert(survivor == "aes-128-gcm");
+}
+
+int main() {
+  testScopeInstallsArena();
+  testContainersUseArena();
+  testRequestTemporariesUseArena();
+  testInternPoolIndexUsesArena();
+  return 0;
+}
@@ -0,0 +1,101 @@
+#ifdef NDEBUG
+#undef NDEBUG
+#endif
+#include <cassert>
+
+#include "generator/config/rule_compaction.h"
+
+static void testDomains() {
+  RuleCompactor compactor;
+  assert(compactor.admit("DOMAIN,a.b.com,Proxy"));
+  assert(!compactor.admit("DOMAIN,a.b.com,Proxy"));
+  assert(compactor.admit("DOMAIN,a.b.com,DIRECT"));
+  assert(compactor.admit("DOMAIN-SUFFIX,b.com,Proxy"));
+  assert(!compactor.admit("DOMAIN-SUFFIX,b.com,Proxy"));
+  assert(!compactor.admit("DOMAIN,x.y.B.com,Proxy"));
+  assert(!compactor.admit("DOMAIN,b.com,Proxy"));
+  assert(!compactor.admit("HOST-SUFFIX,c.b.com,Proxy"));
+  // Labels are matched whole, and other policies are left alone.
+  assert(compactor.admit("DOMAIN,xb.com,Proxy"));
+  assert(compactor.admit("DOMAIN,a.b.com.cn,Proxy"));
+  assert(compactor.admit("DOMAIN-SUFFIX,b.com,DIRECT"));
+  // A later suffix never removes the earlier, narrower rule it covers, but
+  // does cover what follows.
+  assert(compactor.admit("DOMAIN,z.d.com,Proxy"));
+  assert(compactor.admit("DOMAIN-SUFFIX,d.com,Proxy"));
+  assert(!compactor.admit("DOMAIN,z.d.com,Proxy"));
+  assert(compactor.removed() == 6);
+}
+
+static void testCidrs() {
+  RuleCompactor compactor;
+  assert(compactor.admit("IP-CIDR,10.0.0.0/8,Proxy"));
+  assert(!compactor.admit("IP-CIDR,10.1.0.0/16,Proxy"));
+  assert(!compactor.admit("IP-CIDR,10.1.2.3/32,Proxy,no-resolve"));
+  assert(compactor.admit("IP-CIDR,11.0.0.0/8,Proxy"));
+  assert(compactor.admit("IP-CIDR,10.1.0.0/16,DIRECT"));
+
+  // A no-resolve range does not cover a later range that resolves.
+  assert(compactor.admit("IP-CIDR,172.16.0.0/12,Proxy,no-resolve"));
+  assert(compactor.admit("IP-CIDR,172.16.1.0/24,Proxy"));
+  assert(!compactor.admit("IP-CIDR,172.16.2.0/24,Proxy,NO-RESOLVE"));
+  assert(!compactor.admit("IP-CIDR,172.16.1.128/25,Proxy"));
+
+  assert(compactor.admit("IP-CIDR6,2001:db8::/32,Proxy"));
+  assert(!compactor.admit("IP-CIDR6,2001:db8:1::/48,Proxy"));
+  assert(!compactor.admit("IP6-CIDR,2001:db8::1/128,Proxy"));
+  assert(compactor.admit("IP-CIDR6,2001:db9::/32,Proxy"));
+  assert(compactor.removed() == 6);
+}
+
+static void testExactRepeats() {
+  RuleCompactor compactor;
+  assert(compactor.admit("DOMAIN-KEYWORD,google,Proxy"));
+  assert(!compactor.admit("DOMAIN-KEYWORD,google,Proxy"));
+  assert(!compactor.admit("domain-keyword,google,Proxy"));
+  assert(compactor.admit("DOMAIN-KEYWORD,google,DIRECT"));
+  assert(compactor.admit("DOMAIN-KEYWORD,Google,Proxy"));
+  assert(compactor.admit("GEOIP,CN,DIRECT"));
+  assert(!compactor.admit("GEOIP,CN,DIRECT"));
+  assert(compactor.admit("GEOIP,CN,DIRECT,no-resolve"));
+  assert(!compactor.admit("GEOIP,CN,DIRECT,no-resolve"));
+  assert(compactor.admit("PROCESS-NAME,curl,Proxy"));
+  assert(!compactor.admit("  PROCESS-NAME,curl,Proxy\r"));
+  assert(compactor.admit("IP-CIDR,10.0.0.0/8,Proxy,src"));
+  assert(!compactor.admit("IP-CIDR,10.0.0.0/8,Proxy,src"));
+  assert(compactor.admit("AND,((DOMAIN,a),(DOMAIN,b)),Proxy"));
+  assert(!compactor.admit("AND,((DOMAIN,a),(DOMAIN,b)),Proxy"));
+  assert(compactor.admit("AND,((DOMAIN,a),(DOMAIN,c)),Proxy"));
+  assert(compactor.admit("MATCH,Proxy"));
+  assert(!compactor.admit("MATCH,Proxy"));
+  assert(compactor.removed() == 8);
+}
+
+static void testKeptAsIs() {
+  RuleCompactor compactor;
+  // Values that do not parse as a range or a domain are never compared.
+  assert(compactor.admit("IP-CIDR,10.0.0.0/33,Proxy"));
+  assert(compactor.admit("IP-CIDR,10.0.0.0/33,Proxy"));
+  assert(compactor.admit("IP-CIDR,not-an-ip/8,Proxy"));
+  assert(compactor.admit("IP-CIDR6,::ffff:10.0.0.0/8,Proxy"));
+  assert(compactor.admit("IP-CIDR6,::ffff:10.0.0.0/8,Proxy"));
+  assert(compactor.admit("DOMAIN,a..com,Proxy"));
+  assert(compactor.admit("DOMAIN,a..com,Proxy"));
+  // An exact repeat only covers what it repeats: a keyword or a rule with
+  // other options never covers another value, policy or option set.
+  assert(compactor.admit("DOMAIN-KEYWORD,google,Proxy"));
+  assert(compactor.admit("DOMAIN-KEYWORD,googleapis,Proxy"));
+  assert(compactor.admit("DOMAIN,google.com,Proxy,src"));
+  assert(compactor.admit("DOMAIN,google.com,Proxy"));
+  assert(compactor.admit("DOMAIN-SUFFIX,com,Proxy,src"));
+  assert(compactor.admit("DOMAIN,google.com,Proxy,dst"));
+  assert(compactor.removed() == 0);
+}
+
+int main() {
+  testDomains();
+  testCidrs();
+  testExactRepeats();
+  testKeptAsIs();
+  return 0;
+}
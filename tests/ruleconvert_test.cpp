@@ -0,0 +1,338 @@
+#ifdef NDEBUG
+#undef NDEBUG
+#endif
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "generator/config/ruleconvert.h"
+#include "handler/multithread.h"
+#include "handler/settings.h"
+#include "handler/settings_view.h"
+#include "server/webserver.h"
+
+WebServer webServer;
+
+static RulesetContent makeRuleset(const std::string &group,
+                                  const std::string &body,
+                                  ruleset_type type = RULESET_SURGE,
+                                  RulesetOptions options = {}) {
+  RulesetContent ruleset;
+  ruleset.rule_group = group;
+  ruleset.rule_path = "https://rules.example.com/" + group + ".list";
+  ruleset.rule_path_typed = ruleset.rule_path;
+  ruleset.rule_type = type;
+  ruleset.options = options;
+  ruleset.rule_content = makeReadyRulesetFuture(body);
+  return ruleset;
+}
+
+// Runs one conversion with the given max_allowed_rules. The snapshot is what
+// parallelForChunks() hands to the executor threads as well.
+class RuleLimit {
+public:
+  explicit RuleLimit(size_t limit) : view_(snapshot(limit)) {}
+
+private:
+  static SettingsSnapshot snapshot(size_t limit) {
+    Settings settings = global;
+    settings.maxAllowedRules = limit;
+    settings.compactRules = false;
+    return std::make_shared<const Settings>(std::move(settings));
+  }
+
+  ScopedSettingsView view_;
+};
+
+static std::string clashRules(std::vector<RulesetContent> rulesets,
+                              size_t limit = 0, uint64_t *count = nullptr) {
+  RuleLimit rule_limit(limit);
+  YAML::Node base;
+  RuleConversionStats stats;
+  std::string output = rulesetToClashStr(base, rulesets, true, true, &stats);
+  if (count)
+    *count = stats.rules;
+  return output;
+}
+
+static std::string surgeRules(std::vector<RulesetContent> rulesets,
+                              size_t limit = 0, uint64_t *count = nullptr) {
+  RuleLimit rule_limit(limit);
+  INIReader base;
+  RuleConversionStats stats;
+  rulesetToSurge(base, rulesets, 2, true, "", &stats);
+  if (count)
+    *count = stats.rules;
+  return base.to_string();
+}
+
+static size_t countLines(const std::string &text, const std::string &prefix) {
+  size_t count = 0, begin = 0;
+  while (begin < text.size()) {
+    size_t end = text.find('\n', begin);
+    if (end == std::string::npos)
+      end = text.size();
+    if (text.compare(begin, prefix.size(), prefix) == 0)
+      count++;
+    begin = end + 1;
+  }
+  return count;
+}
+
+// Each body below is used by one test only, so the first conversion of it is
+// rendered from scratch and the repeats are served from the fragment cache.
+static void testCachedFragmentsMatchFreshRender() {
+  const std::string body = "DOMAIN-SUFFIX,cache-test.example.com\n"
+                           "# comment\n"
+                           "DOMAIN-KEYWORD,cache-test-tracker\n"
+                           "IP-CIDR,10.20.0.0/16\n"
+                           "GEOIP,CN\n";
+
+  const std::string clash_proxy = clashRules({makeRuleset("Proxy", body)});
+  assert(clash_proxy == "\nrules:\n"
+                        "  - DOMAIN-SUFFIX,cache-test.example.com,Proxy\n"
+                        "  - DOMAIN-KEYWORD,cache-test-tracker,Proxy\n"
+                        "  - IP-CIDR,10.20.0.0/16,Proxy\n"
+                        "  - GEOIP,CN,Proxy\n");
+  const std::string clash_direct = clashRules({makeRuleset("DIRECT", body)});
+  assert(clash_direct == "\nrules:\n"
+                         "  - DOMAIN-SUFFIX,cache-test.example.com,DIRECT\n"
+                         "  - DOMAIN-KEYWORD,cache-test-tracker,DIRECT\n"
+                         "  - IP-CIDR,10.20.0.0/16,DIRECT\n"
+                         "  - GEOIP,CN,DIRECT\n");
+  assert(clashRules({makeRuleset("Proxy", body)}) == clash_proxy);
+  assert(clashRules({makeRuleset("DIRECT", body)}) == clash_direct);
+
+  const std::string surge_proxy = surgeRules({makeRuleset("Proxy", body)});
+  assert(surge_proxy == "[Rule]\n"
+                        "DOMAIN-SUFFIX,cache-test.example.com,Proxy\n"
+                        "DOMAIN-KEYWORD,cache-test-tracker,Proxy\n"
+                        "IP-CIDR,10.20.0.0/16,Proxy\n"
+                        "GEOIP,CN,Proxy\n"
+                        "\n");
+  const std::string surge_direct = surgeRules({makeRuleset("DIRECT", body)});
+  assert(surge_direct != surge_proxy);
+  assert(surgeRules({makeRuleset("Proxy", body)}) == surge_proxy);
+  assert(surgeRules({makeRuleset("DIRECT", body)}) == surge_direct);
+
+  // The same group in both targets keeps the targets apart.
+  assert(clashRules({makeRuleset("Proxy", body)}) == clash_proxy);
+}
+
+// no-resolve and aggregate-cidr change the rendered rules of one body, so
+// each combination is rendered and cached on its own.
+static void testOptionsKeepSeparateFragments() {
+  const std::string body = "payload:\n"
+                           "  - '172.20.0.0/17'\n"
+                           "  - '172.20.128.0/17'\n"
+                           "  - '2001:db8:cafe::/48'\n";
+  RulesetOptions no_resolve;
+  no_resolve.no_resolve = true;
+  RulesetOptions aggregate;
+  aggregate.aggregate_cidr = true;
+  RulesetOptions both = no_resolve;
+  both.aggregate_cidr = true;
+
+  std::vector<std::string> clash, surge;
+  for (const RulesetOptions &options :
+       {RulesetOptions{}, no_resolve, aggregate, both}) {
+    clash.push_back(clashRules(
+        {makeRuleset("Proxy", body, RULESET_CLASH_IPCIDR, options)}));
+    surge.push_back(surgeRules(
+        {makeRuleset("Proxy", body, RULESET_CLASH_IPCIDR, options)}));
+  }
+  assert(clash[0].find("no-resolve") == std::string::npos);
+  assert(clash[1].find("IP-CIDR,172.20.0.0/17,Proxy,no-resolve") !=
+         std::string::npos);
+  assert(clash[2].find("IP-CIDR,172.20.0.0/16,Proxy\n") != std::string::npos);
+  assert(clash[3].find("IP-CIDR,172.20.0.0/16,Proxy,no-resolve\n") !=
+         std::string::npos);
+  for (size_t i = 0; i < clash.size(); i++)
+    for (size_t j = i + 1; j < clash.size(); j++)
+      assert(clash[i] != clash[j]);
+  // Surge ignores no-resolve, so only aggregation changes its output.
+  assert(surge[0] == surge[1]);
+  assert(surge[2] == surge[3]);
+  assert(surge[0] != surge[2]);
+
+  // Repeats come from the cache, in any order, and match the first render.
+  const RulesetOptions all[] = {both, aggregate, no_resolve, RulesetOptions{}};
+  for (size_t i = 0; i < 4; i++) {
+    const size_t index = 3 - i;
+    assert(clashRules({makeRuleset("Proxy", body, RULESET_CLASH_IPCIDR,
+                                   all[i])}) == clash[index]);
+    assert(surgeRules({makeRuleset("Proxy", body, RULESET_CLASH_IPCIDR,
+                                   all[i])}) == surge[index]);
+  }
+}
+
+// A ruleset stops adding rules once the running total passes
+// max_allowed_rules, so it emits up to limit + 1 rules, cached or not.
+static void testMaxAllowedRulesBoundary() {
+  std::string body;
+  for (int i = 0; i < 10; i++)
+    body += "DOMAIN,limit-" + std::to_string(i) + ".example.com\n";
+
+  for (int pass = 0; pass < 2; pass++) {
+    uint64_t count = 0;
+    std::string clash = clashRules({makeRuleset("Proxy", body)}, 5, &count);
+    assert(count == 6);
+    assert(countLines(clash, "  - ") == 6);
+    assert(clash.find("limit-5.example.com") != std::string::npos);
+    assert(clash.find("limit-6.example.com") == std::string::npos);
+
+    std::string surge = surgeRules({makeRuleset("Proxy", body)}, 5, &count);
+    assert(count == 6);
+    assert(countLines(surge, "DOMAIN,") == 6);
+
+    // The second ruleset starts below the limit and fills it up to limit + 1.
+    clash = clashRules(
+        {makeRuleset("Proxy", body), makeRuleset("DIRECT", body)}, 12,
+        &count);
+    assert(count == 13);
+    assert(countLines(clash, "  - ") == 13);
+    assert(clash.find("limit-2.example.com,DIRECT") != std::string::npos);
+    assert(clash.find("limit-3.example.com,DIRECT") == std::string::npos);
+
+    surge = surgeRules(
+        {makeRuleset("Proxy", body), makeRuleset("DIRECT", body)}, 12,
+        &count);
+    assert(count == 13);
+    assert(countLines(surge, "DOMAIN,") == 13);
+
+    // At exactly the limit the next ruleset adds one more rule, and none
+    // after that.
+    clash = clashRules({makeRuleset("Proxy", body), makeRuleset("DIRECT", body),
+                        makeRuleset("REJECT", body)},
+                       10, &count);
+    assert(count == 11);
+    assert(clash.find(",REJECT") == std::string::npos);
+
+    // Without a limit every rule is emitted.
+    clashRules({makeRuleset("Proxy", body)}, 0, &count);
+    assert(count == 10);
+  }
+}
+
+static RulesetContent makeInlineRule(const std::string &group,
+                                     const std::string &rule) {
+  RulesetContent ruleset = makeRuleset(group, "[]" + rule);
+  ruleset.rule_path.clear();
+  ruleset.rule_path_typed.clear();
+  return ruleset;
+}
+
+// The rule lines of a Clash or Surge rendering, without the section header.
+static std::vector<std::string> ruleLines(const std::string &output) {
+  std::vector<std::string> lines;
+  size_t begin = 0;
+  while (begin < output.size()) {
+    size_t end = output.find('\n', begin);
+    if (end == std::string::npos)
+      end = output.size();
+    const std::string line = output.substr(begin, end - begin);
+    if (!line.empty() && line != "rules:" && line != "[Rule]")
+      lines.push_back(line);
+    begin = end + 1;
+  }
+  return lines;
+}
+
+// Converting the rulesets one call each runs every render on this thread and
+// in order; the first limit + 1 of those rules are what a single call over
+// all of them has to produce.
+template <class Convert>
+static std::vector<std::string>
+serialRuleLines(const std::vector<RulesetContent> &rulesets, size_t limit,
+                Convert &&convert) {
+  std::vector<std::string> lines;
+  for (const RulesetContent &ruleset : rulesets) {
+    const std::vector<std::string> own = ruleLines(convert({ruleset}, 0));
+    lines.insert(lines.end(), own.begin(), own.end());
+  }
+  if (limit && lines.size() > limit + 1)
+    lines.resize(limit + 1);
+  return lines;
+}
+
+// More rulesets than executor workers, mixed with inline rules and empty
+// bodies that the caller handles itself, with a limit that ends partway
+// through one ruleset.
+static void testParallelRenderMatchesSerial() {
+  const size_t count = rulesetExecutorWorkerCount() * 3 + 5;
+  std::vector<RulesetContent> rulesets;
+  std::vector<size_t> sizes;
+  for (size_t i = 0; i < count; i++) {
+    const std::string group = "Group" + std::to_string(i);
+    if (i % 5 == 3) {
+      rulesets.push_back(makeInlineRule(
+          group,
+          "DOMAIN,parallel-inline-" + std::to_string(i) + ".example.com"));
+      sizes.push_back(1);
+      continue;
+    }
+    if (i % 11 == 7) {
+      rulesets.push_back(makeRuleset(group, ""));
+      sizes.push_back(0);
+      continue;
+    }
+    std::string body;
+    const size_t rules = i % 7 + 3;
+    for (size_t j = 0; j < rules; j++)
+      body += "DOMAIN-SUFFIX,parallel-" + std::to_string(i) + "-" +
+              std::to_string(j) + ".example.com\n";
+    rulesets.push_back(makeRuleset(group, body));
+    sizes.push_back(rules);
+  }
+
+  // Cut two rules into the first ruleset of at least three rules past the
+  // middle.
+  size_t middle = count / 2, before = 0;
+  while (sizes[middle] < 3)
+    middle++;
+  for (size_t i = 0; i < middle; i++)
+    before += sizes[i];
+  const size_t limit = before + 1;
+  const std::string cut_group = ",Group" + std::to_string(middle);
+
+  const auto in_cut_group = [&](const std::string &line) {
+    return line.size() >= cut_group.size() &&
+           line.compare(line.size() - cut_group.size(), cut_group.size(),
+                        cut_group) == 0;
+  };
+  const auto clash_serial = [](std::vector<RulesetContent> rulesets,
+                               size_t limit) {
+    return clashRules(std::move(rulesets), limit);
+  };
+  const auto surge_serial = [](std::vector<RulesetContent> rulesets,
+                               size_t limit) {
+    return surgeRules(std::move(rulesets), limit);
+  };
+  for (const size_t rule_limit : {size_t(0), limit}) {
+    for (int pass = 0; pass < 2; pass++) {
+      const std::vector<std::string> clash =
+          ruleLines(clashRules(rulesets, rule_limit));
+      assert(clash == serialRuleLines(rulesets, rule_limit, clash_serial));
+      const std::vector<std::string> surge =
+          ruleLines(surgeRules(rulesets, rule_limit));
+      assert(surge == serialRuleLines(rulesets, rule_limit, surge_serial));
+      if (!rule_limit)
+        continue;
+      assert(clash.size() == limit + 1 && surge.size() == limit + 1);
+      assert(in_cut_group(clash.back()) && in_cut_group(surge.back()));
+      assert(in_cut_group(clash[limit - 1]));
+      assert(!in_cut_group(clash[limit - 2]));
+    }
+  }
+}
+
+int main() {
+  testCachedFragmentsMatchFreshRender();
+  testOptionsKeepSeparateFragments();
+  testMaxAllowedRulesBoundary();
+  testParallelRenderMatchesSerial();
+  return 0;
+}
@@ -4,7 +4,10 @@
 #endif
 #include <cassert>
 #include <cstdlib>
+#include <memory>
 #include <string>
+#include <string_view>
+#include <vector>
 
 #include "config/ruleset.h"
 
@@ -176,11 +179,31 @@ int main()
     assert(yaml_normalized.Interval == 86400);
     assert(yaml_normalized.Options.no_resolve);
     assert(parseRulesetOptions({"no-resolve"}).no_resolve);
+    const RulesetOptions aggregated =
+        parseRulesetOptions({"no-resolve", "AGGREGATE-CIDR"});
+    assert(aggregated.no_resolve && aggregated.aggregate_cidr);
+    assert(!(aggregated == parseRulesetOptions({"no-resolve"})));
     assert(parseRulesetOptions({"stash-format=text"}).stash_format == "text");
     assert(parseRulesetOptions({"STASH-FORMAT=YAML"}).stash_format == "yaml");
     assert(parseRulesetOptions(
                {"stash-format=text", "stash-format=yaml"})
                .stash_format == "invalid");
 
+    // Line splitting matches getline(): no empty line after a trailing
+    // delimiter, but empty lines in between are kept.
+    std::string_view body = "a\n\nb\n", line;
+    std::vector<std::string_view> lines;
+    while(nextRulesetLine(body, '\n', line))
+        lines.push_back(line);
+    assert((lines == std::vector<std::string_view>{"a", "", "b"}));
+    body = "c";
+    assert(nextRulesetLine(body, '\n', line) && line == "c");
+    assert(!nextRulesetLine(body, '\n', line));
+
+    RulesetBody fetched;
+    assert(fetched.text().empty());
+    fetched.content = std::make_shared<const std::string>("DOMAIN,a");
+    assert(&fetched.text() == fetched.content.get());
+
     return 0;
 }
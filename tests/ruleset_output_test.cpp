@@ -66,5 +66,34 @@ int main() {
              "DOMAIN,cr.example,Old\rDOMAIN-SUFFIX,cr-suffix.example,Old\r",
              5, "Converted", catalogs) ==
          "cr.example\n.cr-suffix.example\n");
+
+  // A group that spells out another source list must not share its key; the
+  // first pair collided when fields were only joined with ":".
+  const std::vector<RulesetKeySource> one = {{0, "aaaa"}};
+  const std::vector<RulesetKeySource> two = {{0, "aaaa"}, {1, "bbbb"}};
+  assert(buildRulesetResponseKey(2, false, one, "1,bbbb:G") !=
+         buildRulesetResponseKey(2, false, two, "G"));
+  assert(buildRulesetResponseKey(2, false, one, "1,4:bbbb1:G") !=
+         buildRulesetResponseKey(2, false, two, "G"));
+  assert(buildRulesetResponseKey(2, false, {{0, "aa"}}, "aaG") !=
+         buildRulesetResponseKey(2, false, {{0, "aaaa"}}, "G"));
+  assert(buildRulesetResponseKey(2, false, one, "G") !=
+         buildRulesetResponseKey(2, true, one, "G"));
+  assert(buildRulesetResponseKey(2, false, one, "G") !=
+         buildRulesetResponseKey(3, false, one, "G"));
+  assert(buildRulesetResponseKey(2, false, one, "G") !=
+         buildRulesetResponseKey(2, false, {{1, "aaaa"}}, "G"));
+  assert(buildRulesetResponseKey(2, false, two, "G") ==
+         buildRulesetResponseKey(2, false, two, "G"));
+
+  // getRuleset answers 304 exactly when If-None-Match lists the body's tag.
+  const std::string etag = "\"0123456789abcdef0123456789abcdef\"";
+  assert(matchesIfNoneMatch(etag, etag));
+  assert(matchesIfNoneMatch("W/" + etag, etag));
+  assert(matchesIfNoneMatch("\"stale\", " + etag + " ", etag));
+  assert(matchesIfNoneMatch("*", etag));
+  assert(!matchesIfNoneMatch("", etag));
+  assert(!matchesIfNoneMatch("\"stale\"", etag));
+  assert(!matchesIfNoneMatch("0123456789abcdef0123456789abcdef", etag));
   return 0;
 }
@@ -0,0 +1,123 @@
+#ifdef NDEBUG
+#undef NDEBUG
+#endif
+#include <cassert>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include "config/ruleset.h"
+#include "generator/config/ruleset_source.h"
+
+// Expected outputs are the ones the regex-based converter produced for the
+// same input, so any difference is a behaviour change.
+
+static std::string readFixture(const std::string &name) {
+  std::ifstream file("tests/fixtures/" + name, std::ios::binary);
+  assert(file);
+  std::stringstream content;
+  content << file.rdbuf();
+  return content.str();
+}
+
+static void testFixtures() {
+  const std::string domain = readFixture("no_resolve_domain.yaml");
+  assert(convertRulesetSource(domain, RULESET_CLASH_DOMAIN) ==
+         "\n"
+         "DOMAIN,example.com\n"
+         "DOMAIN-SUFFIX,example.net\n");
+  assert(convertRulesetSource(domain, RULESET_CLASH_CLASSICAL) ==
+         "\n"
+         "example.com\n"
+         "+.example.net\n");
+  assert(convertRulesetSource(readFixture("no_resolve_ipcidr.yaml"),
+                              RULESET_CLASH_IPCIDR) ==
+         "\n"
+         "IP-CIDR,1.1.1.0/24\n"
+         "IP-CIDR6,2001:db8::/32\n");
+}
+
+static void testClashPayloads() {
+  const std::string mixed = "# comment before the list\n"
+                            "payload:\n"
+                            "  # inline comment\n"
+                            "  - '+.example.com'\n"
+                            "  - \"quoted.example.org\"\n"
+                            "\n"
+                            "  - plain.example // trailing\n"
+                            "  - '.google.*'\n"
+                            "  - '192.168.0.0/16'\n"
+                            "  - '2001:db8::/32'\n";
+  assert(convertRulesetSource(mixed, RULESET_CLASH_DOMAIN) ==
+         "# comment before the list\n"
+         "# inline comment\n"
+         "DOMAIN-SUFFIX,example.com\n"
+         "DOMAIN,quoted.example.org\n"
+         "DOMAIN,plain.example\n"
+         "DOMAIN-KEYWORD,google\n"
+         "IP-CIDR,192.168.0.0/16\n"
+         "IP-CIDR6,2001:db8::/32\n");
+
+  // With CRLF line ends the closing quote is not at the end of the line, so
+  // the quotes stay.
+  const std::string crlf = "# NAME: Sample\r\n"
+                           "payload:\r\n"
+                           "  - '+.example.com'\r\n"
+                           "  - 'full.example.net'\r\n"
+                           "\r\n"
+                           "  - '.keyword.example.*'\r\n";
+  assert(convertRulesetSource(crlf, RULESET_CLASH_DOMAIN) ==
+         "# NAME: Sample\n"
+         "DOMAIN,'+.example.com'\n"
+         "DOMAIN,'full.example.net'\n"
+         "DOMAIN,'.keyword.example.*'\n");
+
+  const std::string classical = "payload:\n"
+                                "  - DOMAIN-SUFFIX,example.com\n"
+                                "  - 'IP-CIDR,10.0.0.0/8,no-resolve'\n"
+                                "  - PROCESS-NAME,curl\n";
+  assert(convertRulesetSource(classical, RULESET_CLASH_CLASSICAL) ==
+         "\n"
+         "DOMAIN-SUFFIX,example.com\n"
+         "IP-CIDR,10.0.0.0/8,no-resolve\n"
+         "PROCESS-NAME,curl\n");
+}
+
+static void testQuanXList() {
+  const std::string quanx = "# QuanX list\n"
+                            "HOST,example.com,Proxy\n"
+                            "host-suffix,example.org,Proxy\n"
+                            "HOST-KEYWORD,google,Proxy\n"
+                            "IP-CIDR,10.0.0.0/8,Proxy,no-resolve\n"
+                            "IP6-CIDR,2001:db8::/32,Proxy\n"
+                            "USER-AGENT,curl*,Proxy\r\n"
+                            "GEOIP,CN,DIRECT\n"
+                            "HOST,no-policy.example\n";
+  assert(convertRulesetSource(quanx, RULESET_QUANX) ==
+         "# QuanX list\n"
+         "DOMAIN,example.com\n"
+         "DOMAIN-SUFFIX,example.org\n"
+         "DOMAIN-KEYWORD,google\n"
+         "IP-CIDR,10.0.0.0/8,no-resolve\n"
+         "IP-CIDR6,2001:db8::/32\n"
+         "USER-AGENT,curl*\n"
+         "GEOIP,CN,DIRECT\n"
+         "DOMAIN,no-policy.example\n");
+}
+
+static void testPassThrough() {
+  const std::string surge = "DOMAIN-SUFFIX,example.com\n";
+  assert(convertRulesetSource(surge, RULESET_SURGE) == surge);
+  // Bodies that are not valid UTF-8 were never touched by the regexes.
+  const std::string invalid = "payload:\n  - '+.example.com'\n\xff\n";
+  assert(convertRulesetSource(invalid, RULESET_CLASH_DOMAIN) == invalid);
+  assert(convertRulesetSource("", RULESET_QUANX).empty());
+}
+
+int main() {
+  testFixtures();
+  testClashPayloads();
+  testQuanXList();
+  testPassThrough();
+  return 0;
+}
@@ -0,0 +1,88 @@
+#include <cassert>
+#include <thread>
+
+#include "script/script_quickjs.h"
+#include "server/webserver.h"
+
+WebServer webServer;
+
+// Pooled runtimes are created on whichever thread warms or recycles them. A
+// lease on another thread must still see its own stack: deep but bounded
+// recursion succeeds and runaway recursion ends in a catchable error instead
+// of overrunning the native stack.
+static void testRecursionOnRuntimeWarmedElsewhere() {
+  std::thread warm([] { script_runtime_pool_warm(1); });
+  warm.join();
+
+  ScriptRuntimeLease lease;
+  qjs::Context &context = lease.context();
+  const int depth = context
+                        .eval("function depth(n) {"
+                              "  return n === 0 ? 0 : 1 + depth(n - 1);"
+                              "}"
+                              "depth(200);")
+                        .as<int>();
+  assert(depth == 200);
+  const bool caught = context
+                          .eval("function forever() { return forever() + 1; }"
+                                "let caught = false;"
+                                "try { forever(); } catch (e) { caught = true; }"
+                                "caught;")
+                          .as<bool>();
+  assert(caught);
+}
+
+static void testRecursionOnRuntimeRecycledElsewhere() {
+  std::thread worker([] {
+    ScriptRuntimeLease lease;
+    lease.context().eval("1 + 1;");
+  });
+  worker.join();
+
+  ScriptRuntimeLease lease;
+  const bool caught = lease.context()
+                          .eval("function forever() { return forever() + 1; }"
+                                "let caught = false;"
+                                "try { forever(); } catch (e) { caught = true; }"
+                                "caught;")
+                          .as<bool>();
+  assert(caught);
+}
+
+// Cached bytecode is shared by every runtime; each script still evaluates to
+// its own result, from a cold and from a warm cache, and a syntax error is
+// raised in the caller's context rather than cached.
+static void testCachedEvalMatchesSource() {
+  const char *scripts[] = {"[1, 2, 3].length;", "'a' + 'b' === 'ab' ? 7 : 0;",
+                           "Math.max(4, 9);"};
+  const int expected[] = {3, 7, 9};
+  for (int round = 0; round < 2; ++round) {
+    std::thread worker([&] {
+      ScriptRuntimeLease lease;
+      for (int i = 0; i < 3; ++i)
+        assert(script_eval_cached(lease.context(), scripts[i]).as<int>() ==
+               expected[i]);
+    });
+    worker.join();
+  }
+
+  ScriptRuntimeLease lease;
+  for (int attempt = 0; attempt < 2; ++attempt) {
+    bool thrown = false;
+    try {
+      script_eval_cached(lease.context(), "function (");
+    } catch (qjs::exception &) {
+      lease.context().getException();
+      thrown = true;
+    }
+    assert(thrown);
+  }
+}
+
+int main() {
+  testRecursionOnRuntimeWarmedElsewhere();
+  testRecursionOnRuntimeRecycledElsewhere();
+  testCachedEvalMatchesSource();
+  script_runtime_pool_shutdown();
+  return 0;
+}
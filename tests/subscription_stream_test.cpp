@@ -0,0 +1,120 @@
+#include <cassert>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "parser/subscription_stream.h"
+#include "utils/base64/base64.h"
+
+static std::vector<std::string> bufferedLines(const std::string &body) {
+  std::stringstream stream(urlSafeBase64Decode(body));
+  std::vector<std::string> lines;
+  std::string line;
+  while (std::getline(stream, line, '\n'))
+    lines.push_back(line);
+  return lines;
+}
+
+static std::vector<std::string> streamedLines(const std::string &body,
+                                              size_t chunk_size, bool &ok) {
+  std::vector<std::string> lines;
+  Base64LineStream stream([&](std::string &line) {
+    lines.push_back(line);
+    return true;
+  });
+  for (size_t offset = 0; offset < body.size(); offset += chunk_size)
+    stream.feed(std::string_view(body).substr(offset, chunk_size));
+  ok = stream.finish();
+  assert(stream.consumed() == body.size());
+  return lines;
+}
+
+static void testMatchesBufferedDecode() {
+  const std::string links =
+      "ss://YWVzLTI1Ni1nY206cGFzcw@example.com:8388#HK%2001\r\n"
+      "trojan://secret@example.org:443?sni=example.org#JP\n"
+      "\n"
+      "vless://uuid@example.net:443?type=ws&path=%2F#US";
+  const std::vector<std::string> bodies = {
+      base64Encode(links), urlSafeBase64Encode(links),
+      base64Encode(links + "\n"), base64Encode(links) + "\r\n",
+      // Line-wrapped bodies decode each line separately, exactly as the
+      // buffered decoder does.
+      base64Encode("ss://a@b:1#x\n") + "\n" + base64Encode("ss://c@d:2#y\n")};
+  for (const std::string &body : bodies) {
+    const std::vector<std::string> expected = bufferedLines(body);
+    for (size_t chunk = 1; chunk <= body.size(); chunk++) {
+      bool ok = false;
+      assert(streamedLines(body, chunk, ok) == expected);
+      assert(ok);
+    }
+  }
+}
+
+static void testRejectsOtherFormats() {
+  bool ok = true;
+  (void)streamedLines("proxies:\n  - {name: a}\n", 4, ok);
+  assert(!ok);
+  ok = true;
+  (void)streamedLines("ss://YWVz@example.com:8388#HK\n", 4, ok);
+  assert(!ok);
+  // Without a decoded newline the buffered parser splits on another
+  // delimiter, so the stream must not claim the body.
+  ok = true;
+  (void)streamedLines(base64Encode("ss://a@b:1#x"), 3, ok);
+  assert(!ok);
+  ok = true;
+  (void)streamedLines("", 1, ok);
+  assert(!ok);
+
+  std::vector<std::string> seen;
+  Base64LineStream refusing([&](std::string &line) {
+    seen.push_back(line);
+    return false;
+  });
+  refusing.feed(base64Encode("[Proxy]\nA = ss, a, 1\n"));
+  assert(refusing.abandoned());
+  assert(!refusing.finish());
+  assert(seen.size() == 1);
+}
+
+static void testResetStartsOver() {
+  std::vector<std::string> lines;
+  Base64LineStream stream([&](std::string &line) {
+    lines.push_back(line);
+    return true;
+  });
+  stream.feed("not base64: <html>");
+  assert(stream.abandoned());
+  stream.reset();
+  lines.clear();
+  const std::string body = base64Encode("ss://a@b:1#x\nss://c@d:2#y\n");
+  stream.feed(body);
+  assert(stream.finish());
+  assert(stream.consumed() == body.size());
+  assert((lines == std::vector<std::string>{"ss://a@b:1#x", "ss://c@d:2#y"}));
+}
+
+static void testAbandonStopsDecoding() {
+  std::vector<std::string> lines;
+  Base64LineStream stream([&](std::string &line) {
+    lines.push_back(line);
+    return true;
+  });
+  const std::string body = base64Encode("ss://a@b:1#x\nss://c@d:2#y\n");
+  stream.feed(std::string_view(body).substr(0, 8));
+  stream.abandon();
+  stream.feed(std::string_view(body).substr(8));
+  assert(stream.abandoned());
+  assert(!stream.finish());
+  assert(stream.consumed() == body.size());
+  assert(lines.empty());
+}
+
+int main() {
+  testMatchesBufferedDecode();
+  testRejectsOtherFormats();
+  testResetStartsOver();
+  testAbandonStopsDecoding();
+  return 0;
+}